@@ -0,0 +1,195 @@
+// CallbackDispatcher.cpp
+// Implementation of the callback worker pool
+
+#include "pch.h"
+#include "CallbackDispatcher.h"
+
+// ============================================================================
+// Strand Implementation
+// ============================================================================
+
+void CallbackDispatcher::Strand::Release() {
+    if (InterlockedDecrement(&_refs) == 0) {
+        delete this;
+    }
+}
+
+bool CallbackDispatcher::Strand::BeginRun() {
+    ExclusiveLock guard(_lock);
+    if (_retired) {
+        return false;
+    }
+    _runner = GetCurrentThreadId();
+    return true;
+}
+
+void CallbackDispatcher::Strand::EndRun() {
+    ExclusiveLock guard(_lock);
+    _runner = 0;
+    _ranOut.NotifyAll();
+}
+
+void CallbackDispatcher::Strand::Retire() {
+    {
+        // The owner's reference keeps the strand alive while waiting
+        ExclusiveLock guard(_lock);
+        _retired = true;
+        DWORD self = GetCurrentThreadId();
+        while (_runner != 0 && _runner != self) {
+            _ranOut.Wait(_lock, INFINITE);
+        }
+    }
+    Release();
+}
+
+// ============================================================================
+// CallbackDispatcher Implementation
+// ============================================================================
+
+CallbackDispatcher::CallbackDispatcher()
+    : _next(0)
+    , _queued(0)
+    , _sleepers(0)
+    , _stopping(0)
+{
+}
+
+CallbackDispatcher::~CallbackDispatcher() {
+    Shutdown();
+}
+
+BridgeResult CallbackDispatcher::Start(const CallbackDispatchOptions& options) {
+    if (options.threads < 1 || options.threads > 64) {
+        ProSim_SetLastError("Thread count must be between 1 and 64");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    if (options.priority < THREAD_PRIORITY_IDLE || options.priority > THREAD_PRIORITY_TIME_CRITICAL) {
+        ProSim_SetLastError("Invalid thread priority");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    if (options.affinity_mask != 0) {
+        DWORD_PTR processMask, systemMask;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) ||
+            (static_cast<DWORD_PTR>(options.affinity_mask) & processMask) != options.affinity_mask) {
+            ProSim_SetLastError("Affinity mask includes processors unavailable to this process");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+    }
+
+    for (int32_t i = 0; i < options.threads; ++i) {
+        Worker* worker = new Worker();
+        worker->owner = this;
+        worker->index = _workers.size();
+        _workers.push_back(worker);
+    }
+
+    // Every worker must exist before any of them starts stealing
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        Worker* worker = _workers[i];
+        if (!worker->thread.Start(&CallbackDispatcher::WorkerMain, worker)) {
+            Shutdown();
+            ProSim_SetLastError("Failed to start callback worker thread");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+        HANDLE handle = worker->thread.Handle();
+        if (options.affinity_mask != 0) {
+            SetThreadAffinityMask(handle, static_cast<DWORD_PTR>(options.affinity_mask));
+        }
+        if (options.priority != THREAD_PRIORITY_NORMAL) {
+            SetThreadPriority(handle, options.priority);
+        }
+    }
+    return BRIDGE_OK;
+}
+
+void CallbackDispatcher::Shutdown() {
+    {
+        ExclusiveLock guard(_idleLock);
+        InterlockedExchange(&_stopping, 1);
+        _workAvailable.NotifyAll();
+    }
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i]->thread.Stop();
+    }
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        delete _workers[i];
+    }
+    _workers.clear();
+}
+
+void CallbackDispatcher::Dispatch(Strand& strand) {
+    // Only the dispatch that takes the strand from idle queues it; later ones are
+    // counted and run by whichever worker holds the strand
+    if (InterlockedIncrement(&strand._pending) != 1) {
+        return;
+    }
+    InterlockedIncrement(&strand._refs);    // held until the strand goes idle
+    size_t target = static_cast<size_t>(static_cast<ULONG>(InterlockedIncrement(&_next))) % _workers.size();
+    Enqueue(_workers[target], &strand);
+}
+
+void CallbackDispatcher::Enqueue(Worker* worker, Strand* strand) {
+    {
+        ExclusiveLock guard(worker->lock);
+        worker->queue.push_back(strand);
+    }
+    InterlockedIncrement(&_queued);
+
+    // A worker counts itself as a sleeper before checking _queued, so either it sees
+    // this strand or we see it and wake it
+    if (InterlockedCompareExchange(&_sleepers, 0, 0) != 0) {
+        ExclusiveLock guard(_idleLock);
+        _workAvailable.NotifyOne();
+    }
+}
+
+void CallbackDispatcher::WorkerMain(NativeThread* thread, void* context) {
+    Worker* worker = static_cast<Worker*>(context);
+    worker->owner->Run(worker);
+}
+
+CallbackDispatcher::Strand* CallbackDispatcher::Take(Worker* self) {
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        Worker* victim = _workers[(self->index + i) % _workers.size()];
+        ExclusiveLock guard(victim->lock);
+        if (!victim->queue.empty()) {
+            Strand* strand = victim->queue.front();
+            victim->queue.pop_front();
+            InterlockedDecrement(&_queued);
+            return strand;
+        }
+    }
+    return nullptr;
+}
+
+void CallbackDispatcher::Run(Worker* self) {
+    for (;;) {
+        Strand* strand = Take(self);
+        if (!strand) {
+            ExclusiveLock guard(_idleLock);
+            InterlockedIncrement(&_sleepers);
+            while (InterlockedCompareExchange(&_queued, 0, 0) == 0 && !_stopping) {
+                _workAvailable.Wait(_idleLock, INFINITE);
+            }
+            InterlockedDecrement(&_sleepers);
+            if (InterlockedCompareExchange(&_queued, 0, 0) == 0) {
+                return; // stopping and drained
+            }
+            continue;
+        }
+
+        // A retired strand's context is gone; its remaining dispatches are dropped
+        if (strand->BeginRun()) {
+            strand->_proc(strand->_context);
+            strand->EndRun();
+
+            // More dispatches arrived while it ran: requeue behind other strands rather than
+            // looping, so one busy DataRef cannot hold a worker
+            if (InterlockedDecrement(&strand->_pending) != 0) {
+                Enqueue(self, strand);
+                continue;
+            }
+        }
+        strand->Release();
+    }
+}
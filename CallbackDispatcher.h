@@ -0,0 +1,95 @@
+// CallbackDispatcher.h
+// Worker pool that runs DataRef change callbacks off the SDK event thread
+// Each DataRef owns a Strand. A strand is queued on at most one worker at a time and
+// runs one callback per dispatch, so callbacks for one DataRef never overlap and keep
+// their order, while callbacks for different DataRefs run in parallel. Workers take
+// from their own queue first and steal from the others when it is empty.
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "ProSimBridge.h"
+#include "NativeSupport.h"
+
+class CallbackDispatcher {
+public:
+    typedef void (*StrandProc)(void* context);
+
+    class Strand {
+    private:
+        friend class CallbackDispatcher;
+
+        StrandProc _proc;
+        void* _context;
+        volatile LONG _pending;         // dispatches not yet run; queued while > 0
+        volatile LONG _refs;            // the owner, plus one while queued or running
+
+        SrwLock _lock;                  // guards _runner and _retired
+        ConditionVariable _ranOut;      // signalled when a run of the callback ends
+        DWORD _runner;                  // thread running the callback, 0 when none
+        bool _retired;
+
+        ~Strand() {}
+        void Release();
+
+        // Marks the callback as running on this thread; false once the strand is retired
+        bool BeginRun();
+        void EndRun();
+
+        Strand(const Strand&) = delete;
+        Strand& operator=(const Strand&) = delete;
+
+    public:
+        // Allocate with new; the owner gives it up with Retire
+        Strand(StrandProc proc, void* context)
+            : _proc(proc), _context(context), _pending(0), _refs(1), _runner(0), _retired(false) {}
+
+        // Stops the callback for good: dispatches still queued are dropped, and the strand is
+        // freed once no worker holds it. Only a run in progress on another thread is waited
+        // for, so a callback may retire any strand, its own included, without blocking the
+        // worker it runs on.
+        void Retire();
+    };
+
+private:
+    struct Worker {
+        CallbackDispatcher* owner;
+        size_t index;
+        SrwLock lock;                   // guards queue
+        std::deque<Strand*> queue;
+        NativeThread thread;
+    };
+
+    std::vector<Worker*> _workers;
+    volatile LONG _next;                // round-robin target for new strands
+
+    // Sleeping workers wait on _workAvailable while _queued is 0
+    SrwLock _idleLock;
+    ConditionVariable _workAvailable;
+    volatile LONG _queued;
+    volatile LONG _sleepers;
+    volatile LONG _stopping;
+
+    static void WorkerMain(NativeThread* thread, void* context);
+    void Run(Worker* self);
+    Strand* Take(Worker* self);
+    void Enqueue(Worker* worker, Strand* strand);
+
+    CallbackDispatcher(const CallbackDispatcher&) = delete;
+    CallbackDispatcher& operator=(const CallbackDispatcher&) = delete;
+
+public:
+    CallbackDispatcher();
+    ~CallbackDispatcher();
+
+    // Starts the workers with the given options (see CallbackDispatchOptions)
+    BridgeResult Start(const CallbackDispatchOptions& options);
+
+    // Runs every queued callback, then stops the workers
+    void Shutdown();
+
+    // Schedules one run of the strand's callback
+    void Dispatch(Strand& strand);
+};
@@ -0,0 +1,334 @@
+// ConnectionPool.cpp
+// Implementation of the seat connection pool
+
+#include "pch.h"
+#include "ConnectionPool.h"
+#include "ManagedWrapper.h"
+
+// ============================================================================
+// SeatWorker Implementation
+// ============================================================================
+
+SeatWorker::SeatWorker()
+    : _stopping(false)
+{
+}
+
+SeatWorker::~SeatWorker() {
+    Shutdown();
+}
+
+BridgeResult SeatWorker::Start() {
+    if (!_thread.Start(&SeatWorker::WorkerMain, this)) {
+        ProSim_SetLastError("Failed to start seat worker thread");
+        return BRIDGE_ERR_EXCEPTION;
+    }
+    return BRIDGE_OK;
+}
+
+BridgeResult SeatWorker::Post(TaskProc proc, void* context, BridgeResult* result, Batch* batch) {
+    ExclusiveLock guard(_lock);
+    if (_stopping) {
+        ProSim_SetLastError("Seat is shutting down");
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+
+    Task task;
+    task.proc = proc;
+    task.context = context;
+    task.result = result;
+    task.batch = batch;
+    _queue.push_back(task);
+    _workAvailable.NotifyOne();
+    return BRIDGE_OK;
+}
+
+void SeatWorker::WorkerMain(NativeThread* thread, void* context) {
+    static_cast<SeatWorker*>(context)->Run();
+}
+
+void SeatWorker::Run() {
+    for (;;) {
+        {
+            ExclusiveLock guard(_lock);
+            while (_queue.empty() && !_stopping) {
+                _workAvailable.Wait(_lock, INFINITE);
+            }
+            if (_queue.empty()) {
+                return; // stopping and drained
+            }
+            _running.swap(_queue);
+        }
+
+        for (size_t i = 0; i < _running.size(); ++i) {
+            const Task& task = _running[i];
+            BridgeResult result;
+            try {
+                result = task.proc(task.context);
+            }
+            catch (...) {
+                ProSim_SetLastError("Unknown error in seat task");
+                result = BRIDGE_ERR_EXCEPTION;
+            }
+            if (task.result) {
+                *task.result = result;
+            }
+            if (task.batch) {
+                ExclusiveLock batchGuard(task.batch->lock);
+                if (--task.batch->remaining == 0) {
+                    task.batch->done.NotifyAll();
+                }
+            }
+        }
+        _running.clear();
+    }
+}
+
+void SeatWorker::Shutdown() {
+    {
+        ExclusiveLock guard(_lock);
+        _stopping = true;
+        _workAvailable.NotifyAll();
+    }
+    _thread.Stop();
+}
+
+// ============================================================================
+// ConnectionPool Implementation
+// ============================================================================
+
+namespace {
+
+struct SeatCall {
+    ConnectionPool::SeatProc proc;
+    int32_t seatId;
+    void* instance;
+    void* userData;
+};
+
+BridgeResult RunSeatCall(void* context) {
+    SeatCall* call = static_cast<SeatCall*>(context);
+    return call->proc(call->seatId, call->instance, call->userData);
+}
+
+// Posted calls are not waited for, so they own their SeatCall
+BridgeResult RunPostedSeatCall(void* context) {
+    SeatCall* call = static_cast<SeatCall*>(context);
+    BridgeResult result;
+    try {
+        result = call->proc(call->seatId, call->instance, call->userData);
+    }
+    catch (...) {
+        delete call;
+        throw;
+    }
+    delete call;
+    return result;
+}
+
+struct ConnectCall {
+    ProSimConnectWrapper* wrapper;
+    const char* host;
+    bool synchronous;
+};
+
+BridgeResult RunConnect(void* context) {
+    ConnectCall* call = static_cast<ConnectCall*>(context);
+    return call->wrapper->Connect(call->host, call->synchronous);
+}
+
+} // namespace
+
+ConnectionPool::~ConnectionPool() {
+    ExclusiveLock guard(_lock);
+    for (size_t i = 0; i < _seats.size(); ++i) {
+        DestroySeat(_seats[i]);
+    }
+    _seats.clear();
+}
+
+ConnectionPool::Seat* ConnectionPool::FindSeat(int32_t seatId) {
+    // Caller holds _lock
+    for (size_t i = 0; i < _seats.size(); ++i) {
+        if (_seats[i]->id == seatId) {
+            return _seats[i];
+        }
+    }
+    return nullptr;
+}
+
+void ConnectionPool::DestroySeat(Seat* seat) {
+    if (seat->worker) {
+        seat->worker->Shutdown();
+        delete seat->worker;
+    }
+    delete seat->wrapper;
+    delete seat;
+}
+
+BridgeResult ConnectionPool::AddSeat(int32_t seatId, const char* host, void** outInstance) {
+    ExclusiveLock guard(_lock);
+    if (FindSeat(seatId)) {
+        ProSim_SetLastError("Seat id already in use");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    Seat* seat = new Seat();
+    seat->id = seatId;
+    seat->host = host;
+    seat->wrapper = nullptr;
+    seat->worker = nullptr;
+    try {
+        seat->wrapper = new ProSimConnectWrapper();
+        seat->worker = new SeatWorker();
+    }
+    catch (...) {
+        DestroySeat(seat);
+        ProSim_SetLastError("Unknown error creating seat connection");
+        return BRIDGE_ERR_EXCEPTION;
+    }
+
+    BridgeResult started = seat->worker->Start();
+    if (started != BRIDGE_OK) {
+        DestroySeat(seat);
+        return started;
+    }
+
+    _seats.push_back(seat);
+    if (outInstance) {
+        *outInstance = seat->wrapper;
+    }
+    return BRIDGE_OK;
+}
+
+BridgeResult ConnectionPool::RemoveSeat(int32_t seatId) {
+    Seat* seat = nullptr;
+    {
+        ExclusiveLock guard(_lock);
+        for (size_t i = 0; i < _seats.size(); ++i) {
+            if (_seats[i]->id == seatId) {
+                seat = _seats[i];
+                _seats.erase(_seats.begin() + i);
+                break;
+            }
+        }
+    }
+    if (!seat) {
+        ProSim_SetLastError("Unknown seat id");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    DestroySeat(seat);
+    return BRIDGE_OK;
+}
+
+BridgeResult ConnectionPool::GetSeat(int32_t seatId, void** outInstance) {
+    SharedLock guard(_lock);
+    Seat* seat = FindSeat(seatId);
+    if (!seat) {
+        ProSim_SetLastError("Unknown seat id");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    *outInstance = seat->wrapper;
+    return BRIDGE_OK;
+}
+
+int32_t ConnectionPool::Count() {
+    SharedLock guard(_lock);
+    return static_cast<int32_t>(_seats.size());
+}
+
+BridgeResult ConnectionPool::RunBatch(SeatWorker::TaskProc task, void* const* contexts,
+                                      int32_t* outSeatIds, BridgeResult* outResults, int32_t capacity,
+                                      int32_t* outCount) {
+    // Caller holds _lock shared, so no seat can be removed while its task runs
+    size_t count = _seats.size();
+    std::vector<BridgeResult> results(count, BRIDGE_OK);
+    SeatWorker::Batch batch;
+    batch.remaining = static_cast<int32_t>(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        BridgeResult posted = _seats[i]->worker->Post(task, contexts[i], &results[i], &batch);
+        if (posted != BRIDGE_OK) {
+            results[i] = posted;
+            ExclusiveLock batchGuard(batch.lock);
+            --batch.remaining;
+        }
+    }
+
+    {
+        ExclusiveLock batchGuard(batch.lock);
+        while (batch.remaining > 0) {
+            batch.done.Wait(batch.lock, INFINITE);
+        }
+    }
+
+    BridgeResult first = BRIDGE_OK;
+    for (size_t i = 0; i < count; ++i) {
+        if (static_cast<int32_t>(i) < capacity) {
+            if (outSeatIds) outSeatIds[i] = _seats[i]->id;
+            if (outResults) outResults[i] = results[i];
+        }
+        if (first == BRIDGE_OK && results[i] != BRIDGE_OK) {
+            first = results[i];
+        }
+    }
+    if (outCount) {
+        *outCount = static_cast<int32_t>(count);
+    }
+    if (first != BRIDGE_OK) {
+        ProSim_SetLastError("One or more seats failed; see the per-seat results");
+    }
+    return first;
+}
+
+BridgeResult ConnectionPool::ForEach(SeatProc proc, void* userData,
+                                     int32_t* outSeatIds, BridgeResult* outResults, int32_t capacity,
+                                     int32_t* outCount) {
+    SharedLock guard(_lock);
+    std::vector<SeatCall> calls(_seats.size());
+    std::vector<void*> contexts(_seats.size());
+    for (size_t i = 0; i < _seats.size(); ++i) {
+        calls[i].proc = proc;
+        calls[i].seatId = _seats[i]->id;
+        calls[i].instance = _seats[i]->wrapper;
+        calls[i].userData = userData;
+        contexts[i] = &calls[i];
+    }
+    return RunBatch(&RunSeatCall, contexts.data(), outSeatIds, outResults, capacity, outCount);
+}
+
+BridgeResult ConnectionPool::ConnectAll(bool synchronous,
+                                        int32_t* outSeatIds, BridgeResult* outResults, int32_t capacity,
+                                        int32_t* outCount) {
+    SharedLock guard(_lock);
+    std::vector<ConnectCall> calls(_seats.size());
+    std::vector<void*> contexts(_seats.size());
+    for (size_t i = 0; i < _seats.size(); ++i) {
+        calls[i].wrapper = _seats[i]->wrapper;
+        calls[i].host = _seats[i]->host.c_str();
+        calls[i].synchronous = synchronous;
+        contexts[i] = &calls[i];
+    }
+    return RunBatch(&RunConnect, contexts.data(), outSeatIds, outResults, capacity, outCount);
+}
+
+BridgeResult ConnectionPool::Post(int32_t seatId, SeatProc proc, void* userData) {
+    SharedLock guard(_lock);
+    Seat* seat = FindSeat(seatId);
+    if (!seat) {
+        ProSim_SetLastError("Unknown seat id");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    SeatCall* call = new SeatCall();
+    call->proc = proc;
+    call->seatId = seat->id;
+    call->instance = seat->wrapper;
+    call->userData = userData;
+    BridgeResult posted = seat->worker->Post(&RunPostedSeatCall, call, nullptr, nullptr);
+    if (posted != BRIDGE_OK) {
+        delete call;
+    }
+    return posted;
+}
@@ -0,0 +1,121 @@
+// ConnectionPool.h
+// Several simulator connections addressed by seat id
+// Each seat owns a ProSimConnectWrapper and a worker thread with its own task queue,
+// so work for one seat never waits behind a slow or disconnected seat. Batch
+// operations post one task per seat and wait for all of them.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ProSimBridge.h"
+#include "NativeSupport.h"
+
+class ProSimConnectWrapper;
+
+// ============================================================================
+// SeatWorker
+// FIFO of tasks executed on a dedicated thread
+// ============================================================================
+
+class SeatWorker {
+public:
+    typedef BridgeResult (*TaskProc)(void* context);
+
+    // Completion shared by the tasks of one batch
+    struct Batch {
+        SrwLock lock;
+        ConditionVariable done;
+        int32_t remaining;
+
+        Batch() : remaining(0) {}
+    };
+
+private:
+    struct Task {
+        TaskProc proc;
+        void* context;
+        BridgeResult* result;           // may be null for fire-and-forget tasks
+        Batch* batch;                   // may be null
+    };
+
+    SrwLock _lock;                      // guards _queue and _stopping
+    ConditionVariable _workAvailable;
+    std::vector<Task> _queue;
+    std::vector<Task> _running;         // worker thread only
+    bool _stopping;
+
+    NativeThread _thread;
+
+    static void WorkerMain(NativeThread* thread, void* context);
+    void Run();
+
+    SeatWorker(const SeatWorker&) = delete;
+    SeatWorker& operator=(const SeatWorker&) = delete;
+
+public:
+    SeatWorker();
+    ~SeatWorker();
+
+    BridgeResult Start();
+
+    // Queues a task; result and batch are updated when it has run
+    BridgeResult Post(TaskProc proc, void* context, BridgeResult* result, Batch* batch);
+
+    // Runs the tasks already queued, then stops the thread
+    void Shutdown();
+};
+
+// ============================================================================
+// ConnectionPool
+// ============================================================================
+
+class ConnectionPool {
+public:
+    typedef BridgeResult (*SeatProc)(int32_t seatId, void* instance, void* userData);
+
+private:
+    struct Seat {
+        int32_t id;
+        std::string host;
+        ProSimConnectWrapper* wrapper;
+        SeatWorker* worker;
+    };
+
+    SrwLock _lock;                      // guards _seats; held shared while a batch runs
+    std::vector<Seat*> _seats;          // in the order they were added
+
+    Seat* FindSeat(int32_t seatId);
+    BridgeResult RunBatch(SeatWorker::TaskProc task, void* const* contexts,
+                          int32_t* outSeatIds, BridgeResult* outResults, int32_t capacity, int32_t* outCount);
+    static void DestroySeat(Seat* seat);
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+public:
+    ConnectionPool() {}
+    ~ConnectionPool();
+
+    // Creates a connection for a seat (not yet connected) with its own worker thread
+    BridgeResult AddSeat(int32_t seatId, const char* host, void** outInstance);
+
+    // Runs the seat's queued tasks, then destroys its connection
+    BridgeResult RemoveSeat(int32_t seatId);
+
+    BridgeResult GetSeat(int32_t seatId, void** outInstance);
+    int32_t Count();
+
+    // Runs proc once per seat, each on that seat's worker thread, and waits for all of
+    // them. Per-seat results are written in seat order; returns the first failure.
+    BridgeResult ForEach(SeatProc proc, void* userData,
+                         int32_t* outSeatIds, BridgeResult* outResults, int32_t capacity, int32_t* outCount);
+
+    // Connects every seat to its host in parallel
+    BridgeResult ConnectAll(bool synchronous,
+                            int32_t* outSeatIds, BridgeResult* outResults, int32_t capacity, int32_t* outCount);
+
+    // Queues proc on one seat's worker thread without waiting
+    BridgeResult Post(int32_t seatId, SeatProc proc, void* userData);
+};
@@ -0,0 +1,491 @@
+// Expression.cpp
+// Implementation of the derived DataRef expression compiler and evaluator
+
+#include "pch.h"
+#include "Expression.h"
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+
+// Pure arithmetic; compile it native rather than to IL
+#pragma managed(push, off)
+
+namespace {
+
+enum OpCode : uint8_t {
+    OpConst,                            // u16 constant index follows
+    OpInput,                            // u16 input index follows
+    OpNeg, OpNot,
+    OpAbs, OpSqrt, OpExp, OpLog, OpSin, OpCos, OpTan, OpAsin, OpAcos, OpAtan,
+    OpFloor, OpCeil, OpRound,
+    OpAdd, OpSub, OpMul, OpDiv, OpMod,
+    OpLt, OpLe, OpGt, OpGe, OpEq, OpNe, OpAnd, OpOr,
+    OpAtan2, OpPow, OpMin, OpMax,
+    OpSelect                            // cond, then, else
+};
+
+struct Function {
+    const char* name;
+    OpCode op;
+    int arity;
+};
+
+const Function Functions[] = {
+    { "abs", OpAbs, 1 },     { "sqrt", OpSqrt, 1 },   { "exp", OpExp, 1 },     { "log", OpLog, 1 },
+    { "sin", OpSin, 1 },     { "cos", OpCos, 1 },     { "tan", OpTan, 1 },     { "asin", OpAsin, 1 },
+    { "acos", OpAcos, 1 },   { "atan", OpAtan, 1 },   { "floor", OpFloor, 1 }, { "ceil", OpCeil, 1 },
+    { "round", OpRound, 1 }, { "atan2", OpAtan2, 2 }, { "pow", OpPow, 2 },     { "min", OpMin, 2 },
+    { "max", OpMax, 2 },
+};
+
+const int MaxNesting = 200;
+
+inline int Arity(uint8_t op) {
+    if (op <= OpInput) return 0;
+    if (op <= OpRound) return 1;
+    if (op <= OpMax) return 2;
+    return 3;
+}
+
+inline double Truth(bool value) {
+    return value ? 1.0 : 0.0;
+}
+
+// Applies an operator to its operands (a is the deepest)
+double Apply(uint8_t op, double a, double b, double c) {
+    switch (op) {
+    case OpNeg:    return -a;
+    case OpNot:    return Truth(a == 0.0);
+    case OpAbs:    return fabs(a);
+    case OpSqrt:   return sqrt(a);
+    case OpExp:    return exp(a);
+    case OpLog:    return log(a);
+    case OpSin:    return sin(a);
+    case OpCos:    return cos(a);
+    case OpTan:    return tan(a);
+    case OpAsin:   return asin(a);
+    case OpAcos:   return acos(a);
+    case OpAtan:   return atan(a);
+    case OpFloor:  return floor(a);
+    case OpCeil:   return ceil(a);
+    case OpRound:  return round(a);
+    case OpAdd:    return a + b;
+    case OpSub:    return a - b;
+    case OpMul:    return a * b;
+    case OpDiv:    return a / b;
+    case OpMod:    return fmod(a, b);
+    case OpLt:     return Truth(a < b);
+    case OpLe:     return Truth(a <= b);
+    case OpGt:     return Truth(a > b);
+    case OpGe:     return Truth(a >= b);
+    case OpEq:     return Truth(a == b);
+    case OpNe:     return Truth(a != b);
+    case OpAnd:    return Truth(a != 0.0 && b != 0.0);
+    case OpOr:     return Truth(a != 0.0 || b != 0.0);
+    case OpAtan2:  return atan2(a, b);
+    case OpPow:    return pow(a, b);
+    case OpMin:    return (b < a) ? b : a;
+    case OpMax:    return (b > a) ? b : a;
+    case OpSelect: return (a != 0.0) ? b : c;
+    default:       return 0.0;
+    }
+}
+
+inline uint16_t ReadIndex(const uint8_t* code) {
+    return static_cast<uint16_t>(code[0] | (code[1] << 8));
+}
+
+inline bool IsIdentStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline bool IsIdentChar(char c) {
+    return IsIdentStart(c) || (c >= '0' && c <= '9') || c == '.';
+}
+
+} // namespace
+
+// ============================================================================
+// ExpressionCompiler
+// Recursive-descent parser emitting bytecode. Operators whose operands are all
+// constants are folded as they are emitted.
+// ============================================================================
+
+class ExpressionCompiler {
+private:
+    Expression& _target;
+    Expression::InlineResolver _resolver;
+    void* _context;
+    const char* _source;
+    const char* _pos;
+    int _nesting;
+
+    // Code offset where each value on the evaluation stack starts, and whether it is a constant
+    std::vector<size_t> _operandStart;
+    std::vector<bool> _operandConstant;
+
+public:
+    ExpressionCompiler(Expression& target, Expression::InlineResolver resolver, void* context, const char* source)
+        : _target(target), _resolver(resolver), _context(context), _source(source), _pos(source), _nesting(0) {}
+
+    bool Run() {
+        if (!ParseTernary()) {
+            return false;
+        }
+        SkipSpace();
+        if (*_pos) {
+            return Fail("unexpected character");
+        }
+        return true;
+    }
+
+private:
+    bool Fail(const char* message) {
+        char prefix[32];
+        sprintf_s(prefix, sizeof(prefix), "column %d: ", static_cast<int>(_pos - _source) + 1);
+        _target._error = std::string(prefix) + message;
+        return false;
+    }
+
+    void SkipSpace() {
+        while (*_pos == ' ' || *_pos == '\t' || *_pos == '\r' || *_pos == '\n') {
+            ++_pos;
+        }
+    }
+
+    bool Accept(const char* token) {
+        SkipSpace();
+        size_t length = strlen(token);
+        if (strncmp(_pos, token, length) != 0) {
+            return false;
+        }
+        ++_pos;
+        if (length == 2) {
+            ++_pos;
+        }
+        return true;
+    }
+
+    // Accepts a one-character operator unless it starts the two-character one
+    bool AcceptSingle(char c, char notFollowedBy) {
+        SkipSpace();
+        if (_pos[0] != c || _pos[1] == notFollowedBy) {
+            return false;
+        }
+        ++_pos;
+        return true;
+    }
+
+    void EmitIndexed(uint8_t op, size_t index) {
+        _target._code.push_back(op);
+        _target._code.push_back(static_cast<uint8_t>(index & 0xFF));
+        _target._code.push_back(static_cast<uint8_t>(index >> 8));
+    }
+
+    bool Push(size_t start, bool constant) {
+        _operandStart.push_back(start);
+        _operandConstant.push_back(constant);
+        if (_operandStart.size() > _target._maxStack) {
+            _target._maxStack = _operandStart.size();
+        }
+        return true;
+    }
+
+    bool EmitConstant(double value) {
+        std::vector<double>& constants = _target._constants;
+        size_t index = 0;
+        while (index < constants.size() && memcmp(&constants[index], &value, sizeof(double)) != 0) {
+            ++index;
+        }
+        if (index == constants.size()) {
+            if (index > 0xFFFF) {
+                return Fail("too many constants");
+            }
+            constants.push_back(value);
+        }
+        size_t start = _target._code.size();
+        EmitIndexed(OpConst, index);
+        return Push(start, true);
+    }
+
+    bool EmitInput(const std::string& name) {
+        std::vector<std::string>& inputs = _target._inputs;
+        size_t index = 0;
+        while (index < inputs.size() && inputs[index] != name) {
+            ++index;
+        }
+        if (index == inputs.size()) {
+            if (index > 0xFFFF) {
+                return Fail("too many inputs");
+            }
+            inputs.push_back(name);
+        }
+        size_t start = _target._code.size();
+        EmitIndexed(OpInput, index);
+        return Push(start, false);
+    }
+
+    bool EmitOp(uint8_t op) {
+        int arity = Arity(op);
+        size_t first = _operandStart.size() - arity;
+        bool constant = true;
+        double operands[3] = { 0.0, 0.0, 0.0 };
+        for (int i = 0; i < arity; ++i) {
+            if (!_operandConstant[first + i]) {
+                constant = false;
+                break;
+            }
+            operands[i] = _target._constants[ReadIndex(&_target._code[_operandStart[first + i] + 1])];
+        }
+
+        size_t start = _operandStart[first];
+        _operandStart.resize(first);
+        _operandConstant.resize(first);
+        if (constant) {
+            _target._code.resize(start);
+            return EmitConstant(Apply(op, operands[0], operands[1], operands[2]));
+        }
+        _target._code.push_back(op);
+        return Push(start, false);
+    }
+
+    // Copies another expression's code in place of an identifier
+    bool EmitInlined(const Expression& inner) {
+        size_t start = _target._code.size();
+        size_t base = _operandStart.size();
+        if (base + inner._maxStack > Expression::MaxStack) {
+            return Fail("expression is nested too deeply");
+        }
+        const std::vector<uint8_t>& code = inner._code;
+        for (size_t pc = 0; pc < code.size(); ) {
+            uint8_t op = code[pc];
+            if (op == OpConst) {
+                if (!EmitConstant(inner._constants[ReadIndex(&code[pc + 1])])) return false;
+                pc += 3;
+            }
+            else if (op == OpInput) {
+                if (!EmitInput(inner._inputs[ReadIndex(&code[pc + 1])])) return false;
+                pc += 3;
+            }
+            else {
+                if (!EmitOp(op)) return false;
+                pc += 1;
+            }
+        }
+
+        // Whatever the inner code folded to, it is one operand here
+        bool constant = _operandConstant.back();
+        _operandStart.resize(base);
+        _operandConstant.resize(base);
+        return Push(start, constant);
+    }
+
+    bool ParseTernary() {
+        if (++_nesting > MaxNesting) {
+            return Fail("expression is nested too deeply");
+        }
+        if (!ParseOr()) return false;
+        if (Accept("?")) {
+            if (!ParseTernary()) return false;
+            if (!Accept(":")) return Fail("expected ':'");
+            if (!ParseTernary()) return false;
+            if (!EmitOp(OpSelect)) return false;
+        }
+        --_nesting;
+        return true;
+    }
+
+    bool ParseOr() {
+        if (!ParseAnd()) return false;
+        while (Accept("||")) {
+            if (!ParseAnd() || !EmitOp(OpOr)) return false;
+        }
+        return true;
+    }
+
+    bool ParseAnd() {
+        if (!ParseEquality()) return false;
+        while (Accept("&&")) {
+            if (!ParseEquality() || !EmitOp(OpAnd)) return false;
+        }
+        return true;
+    }
+
+    bool ParseEquality() {
+        if (!ParseRelational()) return false;
+        for (;;) {
+            uint8_t op;
+            if (Accept("==")) op = OpEq;
+            else if (Accept("!=")) op = OpNe;
+            else return true;
+            if (!ParseRelational() || !EmitOp(op)) return false;
+        }
+    }
+
+    bool ParseRelational() {
+        if (!ParseAdditive()) return false;
+        for (;;) {
+            uint8_t op;
+            if (Accept("<=")) op = OpLe;
+            else if (Accept(">=")) op = OpGe;
+            else if (Accept("<")) op = OpLt;
+            else if (Accept(">")) op = OpGt;
+            else return true;
+            if (!ParseAdditive() || !EmitOp(op)) return false;
+        }
+    }
+
+    bool ParseAdditive() {
+        if (!ParseMultiplicative()) return false;
+        for (;;) {
+            uint8_t op;
+            if (Accept("+")) op = OpAdd;
+            else if (Accept("-")) op = OpSub;
+            else return true;
+            if (!ParseMultiplicative() || !EmitOp(op)) return false;
+        }
+    }
+
+    bool ParseMultiplicative() {
+        if (!ParseUnary()) return false;
+        for (;;) {
+            uint8_t op;
+            if (Accept("*")) op = OpMul;
+            else if (Accept("/")) op = OpDiv;
+            else if (Accept("%")) op = OpMod;
+            else return true;
+            if (!ParseUnary() || !EmitOp(op)) return false;
+        }
+    }
+
+    bool ParseUnary() {
+        if (++_nesting > MaxNesting) {
+            return Fail("expression is nested too deeply");
+        }
+        bool ok;
+        if (Accept("-")) {
+            ok = ParseUnary() && EmitOp(OpNeg);
+        }
+        else if (Accept("+")) {
+            ok = ParseUnary();
+        }
+        else if (AcceptSingle('!', '=')) {
+            ok = ParseUnary() && EmitOp(OpNot);
+        }
+        else {
+            ok = ParsePrimary();
+        }
+        --_nesting;
+        return ok;
+    }
+
+    bool ParsePrimary() {
+        SkipSpace();
+        if (Accept("(")) {
+            if (!ParseTernary()) return false;
+            if (!Accept(")")) return Fail("expected ')'");
+            return true;
+        }
+
+        if ((*_pos >= '0' && *_pos <= '9') || (*_pos == '.' && _pos[1] >= '0' && _pos[1] <= '9')) {
+            char* end;
+            double value = strtod(_pos, &end);
+            if (IsIdentChar(*end)) {
+                return Fail("malformed number");
+            }
+            _pos = end;
+            return EmitConstant(value);
+        }
+
+        if (!IsIdentStart(*_pos)) {
+            return Fail(*_pos ? "expected a number, name or '('" : "unexpected end of expression");
+        }
+        const char* begin = _pos;
+        while (IsIdentChar(*_pos)) {
+            ++_pos;
+        }
+        std::string name(begin, _pos);
+
+        SkipSpace();
+        if (*_pos == '(') {
+            const Function* function = nullptr;
+            for (size_t i = 0; i < sizeof(Functions) / sizeof(Functions[0]); ++i) {
+                if (name == Functions[i].name) {
+                    function = &Functions[i];
+                    break;
+                }
+            }
+            if (!function) {
+                _pos = begin;
+                return Fail("unknown function");
+            }
+            ++_pos;
+            for (int i = 0; i < function->arity; ++i) {
+                if (i > 0 && !Accept(",")) return Fail("expected ','");
+                if (!ParseTernary()) return false;
+            }
+            if (!Accept(")")) return Fail(function->arity == 1 ? "expected ')' (function takes 1 argument)"
+                                                                : "expected ')' (function takes 2 arguments)");
+            return EmitOp(function->op);
+        }
+
+        const Expression* inner = _resolver ? _resolver(name.c_str(), _context) : nullptr;
+        if (inner) {
+            return EmitInlined(*inner);
+        }
+        return EmitInput(name);
+    }
+};
+
+// ============================================================================
+// Expression Implementation
+// ============================================================================
+
+BridgeResult Expression::Compile(const char* source, InlineResolver resolver, void* context) {
+    _code.clear();
+    _constants.clear();
+    _inputs.clear();
+    _maxStack = 0;
+    _error.clear();
+
+    ExpressionCompiler compiler(*this, resolver, context, source);
+    if (compiler.Run() && _maxStack > MaxStack) {
+        _error = "expression is nested too deeply";
+    }
+    if (!_error.empty()) {
+        _code.clear();
+        _inputs.clear();
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    return BRIDGE_OK;
+}
+
+double Expression::Evaluate(const double* inputs) const {
+    double stack[MaxStack];
+    size_t sp = 0;
+    const uint8_t* code = _code.data();
+    const uint8_t* end = code + _code.size();
+    while (code < end) {
+        uint8_t op = *code++;
+        switch (op) {
+        case OpConst:
+            stack[sp++] = _constants[ReadIndex(code)];
+            code += 2;
+            break;
+        case OpInput:
+            stack[sp++] = inputs[ReadIndex(code)];
+            code += 2;
+            break;
+        default: {
+            int arity = Arity(op);
+            sp -= arity;
+            stack[sp] = Apply(op, stack[sp], arity > 1 ? stack[sp + 1] : 0.0, arity > 2 ? stack[sp + 2] : 0.0);
+            ++sp;
+            break;
+        }
+        }
+    }
+    return sp ? stack[0] : 0.0;
+}
+
+#pragma managed(pop)
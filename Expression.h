@@ -0,0 +1,58 @@
+// Expression.h
+// Compiler and evaluator for derived DataRef expressions
+// An expression such as "sqrt(vx*vx + vy*vy) * 1.944" is compiled once into a compact
+// stack bytecode. Identifiers are DataRef names and become numbered inputs; evaluation
+// takes the current input values and does not allocate.
+//
+// Syntax (C precedence, all values are doubles, comparisons and logic yield 0 or 1):
+//     numbers      1, 0.5, 1e-3
+//     inputs       DataRef names: letters, digits, '_' and '.', not starting with a digit
+//     operators    ?:  ||  &&  == !=  < <= > >=  + -  * / %  unary - + !
+//     functions    abs sqrt exp log sin cos tan asin acos atan floor ceil round (1 argument)
+//                  atan2 pow min max (2 arguments)
+// Both sides of ?:, && and || are always evaluated; there are no side effects to skip.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "ProSimBridge.h"
+
+class Expression {
+public:
+    // Deepest evaluation stack an expression may need
+    static const size_t MaxStack = 64;
+
+    // Looks up an identifier that names another expression; returning it inlines that
+    // expression (with its inputs) in place of the identifier. May return null.
+    typedef const Expression* (*InlineResolver)(const char* name, void* context);
+
+private:
+    std::vector<uint8_t> _code;
+    std::vector<double> _constants;
+    std::vector<std::string> _inputs;
+    size_t _maxStack;
+    std::string _error;
+
+public:
+    Expression() : _maxStack(0) {}
+
+    // Compiles source, replacing any previous program; on failure returns
+    // BRIDGE_ERR_INVALID_ARGUMENT and Error() gives the column and reason
+    BridgeResult Compile(const char* source, InlineResolver resolver, void* context);
+
+    // DataRef names the expression reads, in input order
+    size_t InputCount() const { return _inputs.size(); }
+    const std::string& InputName(size_t index) const { return _inputs[index]; }
+
+    // Evaluates with inputs[i] holding the value of InputName(i)
+    double Evaluate(const double* inputs) const;
+
+    size_t CodeSize() const { return _code.size(); }
+    const std::string& Error() const { return _error; }
+
+private:
+    friend class ExpressionCompiler;
+};
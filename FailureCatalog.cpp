@@ -0,0 +1,140 @@
+// FailureCatalog.cpp
+// Implementation of the packed failure catalog
+
+#include "pch.h"
+#include "FailureCatalog.h"
+
+FailureCatalog::FailureCatalog()
+    : _version(0)
+    , _loaded(false)
+{
+}
+
+bool FailureCatalog::IsLoaded() {
+    SharedLock guard(_lock);
+    return _loaded;
+}
+
+size_t FailureCatalog::MemoryBytes() {
+    SharedLock guard(_lock);
+    size_t bytes = _records.capacity() * sizeof(FailureRecord);
+    bytes += _recordVersions.capacity() * sizeof(uint32_t);
+    bytes += _strings.capacity();
+    for (auto it = _indexById.begin(); it != _indexById.end(); ++it) {
+        bytes += sizeof(*it) + 2 * sizeof(void*) + it->first.capacity();
+    }
+    return bytes;
+}
+
+void FailureCatalog::BeginLoad(size_t expectedRecords) {
+    _stagedRecords.clear();
+    _stagedRecords.reserve(expectedRecords);
+    _stagedStrings.clear();
+    // ~6 strings per failure, most of them short
+    _stagedStrings.reserve(expectedRecords * 128);
+}
+
+uint32_t FailureCatalog::StageString(const char* utf8, size_t length) {
+    uint32_t offset = static_cast<uint32_t>(_stagedStrings.size());
+    _stagedStrings.insert(_stagedStrings.end(), utf8, utf8 + length);
+    _stagedStrings.push_back('\0');
+    return offset;
+}
+
+void FailureCatalog::StageRecord(const FailureRecord& record) {
+    _stagedRecords.push_back(record);
+}
+
+void FailureCatalog::CommitLoad() {
+    std::unordered_map<std::string, uint32_t> index;
+    index.reserve(_stagedRecords.size());
+    for (size_t i = 0; i < _stagedRecords.size(); ++i) {
+        index.emplace(std::string(&_stagedStrings[_stagedRecords[i].id_offset]), static_cast<uint32_t>(i));
+    }
+
+    ExclusiveLock guard(_lock);
+    ++_version;
+    _records.swap(_stagedRecords);
+    _strings.swap(_stagedStrings);
+    _indexById.swap(index);
+    _recordVersions.assign(_records.size(), _version);
+    _loaded = true;
+
+    _stagedRecords.clear();
+    _stagedStrings.clear();
+}
+
+void FailureCatalog::SetArmedState(const std::string& failureId, int32_t state, int32_t armedId) {
+    ExclusiveLock guard(_lock);
+    auto it = _indexById.find(failureId);
+    if (it == _indexById.end()) {
+        return;
+    }
+
+    FailureRecord& record = _records[it->second];
+    if (state == FAILURE_STATE_NONE && record.armed_id != armedId) {
+        return; // re-armed by a newer armed failure
+    }
+    if (record.armed_state == state && record.armed_id == armedId) {
+        return;
+    }
+
+    record.armed_state = state;
+    record.armed_id = (state == FAILURE_STATE_NONE) ? -1 : armedId;
+    _recordVersions[it->second] = ++_version;
+}
+
+BridgeResult FailureCatalog::Copy(FailureRecord* records, int32_t recordCapacity,
+                                  char* strings, int32_t stringCapacity,
+                                  int32_t* outCount, int32_t* outStringSize, uint32_t* outVersion) {
+    SharedLock guard(_lock);
+    *outCount = static_cast<int32_t>(_records.size());
+    *outStringSize = static_cast<int32_t>(_strings.size());
+    if (outVersion) {
+        *outVersion = _version;
+    }
+
+    if (static_cast<size_t>(recordCapacity) < _records.size() ||
+        static_cast<size_t>(stringCapacity) < _strings.size()) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    if (!_records.empty()) {
+        memcpy(records, _records.data(), _records.size() * sizeof(FailureRecord));
+    }
+    if (!_strings.empty()) {
+        memcpy(strings, _strings.data(), _strings.size());
+    }
+    return BRIDGE_OK;
+}
+
+BridgeResult FailureCatalog::GetUpdates(uint32_t sinceVersion, FailureStateUpdate* updates, int32_t capacity,
+                                        int32_t* outCount, uint32_t* outVersion) {
+    SharedLock guard(_lock);
+
+    // A linear scan of one uint32 per failure is cheaper than keeping a change log
+    int32_t count = 0;
+    for (size_t i = 0; i < _records.size(); ++i) {
+        if (_recordVersions[i] <= sinceVersion) {
+            continue;
+        }
+        if (count >= capacity) {
+            // Report how many changed so the caller can retry with a larger buffer
+            ++count;
+            continue;
+        }
+        updates[count].index = static_cast<int32_t>(i);
+        updates[count].armed_state = _records[i].armed_state;
+        updates[count].armed_id = _records[i].armed_id;
+        ++count;
+    }
+
+    *outCount = count;
+    if (count > capacity) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    if (outVersion) {
+        *outVersion = _version;
+    }
+    return BRIDGE_OK;
+}
@@ -0,0 +1,60 @@
+// FailureCatalog.h
+// Native copy of the simulator's failure catalog
+// All strings live in one packed UTF-8 table and records refer to them by offset, so
+// the whole catalog is handed to a client with two memcpy calls. Armed-failure events
+// update record state in place and bump a version so clients can fetch only changes.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "ProSimBridge.h"
+#include "NativeSupport.h"
+
+class FailureCatalog {
+private:
+    SrwLock _lock;                      // guards everything below
+    std::vector<FailureRecord> _records;
+    std::vector<uint32_t> _recordVersions;  // version of the last change to each record
+    std::vector<char> _strings;
+    std::unordered_map<std::string, uint32_t> _indexById;
+    uint32_t _version;
+    bool _loaded;
+
+    // Catalog being built by BeginLoad/Stage*/CommitLoad (loader thread only)
+    std::vector<FailureRecord> _stagedRecords;
+    std::vector<char> _stagedStrings;
+
+    FailureCatalog(const FailureCatalog&) = delete;
+    FailureCatalog& operator=(const FailureCatalog&) = delete;
+
+public:
+    FailureCatalog();
+
+    bool IsLoaded();
+
+    // Bytes held by the committed catalog (hash nodes approximated)
+    size_t MemoryBytes();
+
+    // Builds a new catalog; it replaces the current one atomically on CommitLoad
+    void BeginLoad(size_t expectedRecords);
+    uint32_t StageString(const char* utf8, size_t length);
+    void StageRecord(const FailureRecord& record);
+    void CommitLoad();
+
+    // Updates the armed state of a failure (FAILURE_STATE_*). Clearing only applies if the
+    // failure is still attributed to armedId, since several armed failures may share one.
+    void SetArmedState(const std::string& failureId, int32_t state, int32_t armedId);
+
+    // Copies the catalog; if either buffer is too small nothing is copied and
+    // BRIDGE_ERR_INVALID_ARGUMENT is returned, with the required sizes filled in
+    BridgeResult Copy(FailureRecord* records, int32_t recordCapacity,
+                      char* strings, int32_t stringCapacity,
+                      int32_t* outCount, int32_t* outStringSize, uint32_t* outVersion);
+
+    // Copies the state of records changed after sinceVersion
+    BridgeResult GetUpdates(uint32_t sinceVersion, FailureStateUpdate* updates, int32_t capacity,
+                            int32_t* outCount, uint32_t* outVersion);
+};
@@ -0,0 +1,215 @@
+// FailureScenario.cpp
+// Implementation of the failure scenario parser
+
+#include "pch.h"
+#include "FailureScenario.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool TokenEquals(const std::string& token, const char* keyword) {
+    if (token.size() != strlen(keyword)) {
+        return false;
+    }
+    for (size_t i = 0; i < token.size(); ++i) {
+        char c = token[i];
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseInt(const std::string& token, int32_t* out) {
+    if (token.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    long value = strtol(token.c_str(), &end, 10);
+    if (*end != '\0' || value < INT32_MIN || value > INT32_MAX) {
+        return false;
+    }
+    *out = static_cast<int32_t>(value);
+    return true;
+}
+
+bool ParseSeconds(const std::string& token, double* out) {
+    if (token.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    double value = strtod(token.c_str(), &end);
+    if (*end != '\0' || !(value >= 0.0)) {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+} // namespace
+
+bool FailureScenario::Fail(int32_t line, const std::string& message) {
+    char prefix[32];
+    sprintf_s(prefix, sizeof(prefix), "line %d: ", line);
+    _error = prefix + message;
+    return false;
+}
+
+bool FailureScenario::ParseLine(const char* begin, const char* end, int32_t line) {
+    std::vector<std::string> tokens;
+    const char* p = begin;
+    while (p < end) {
+        while (p < end && IsSpace(*p)) ++p;
+        if (p == end || *p == '#') break;
+        const char* start = p;
+        while (p < end && !IsSpace(*p) && *p != '#') ++p;
+        tokens.push_back(std::string(start, p));
+    }
+    if (tokens.empty()) {
+        return true;
+    }
+
+    if (!TokenEquals(tokens[0], "arm")) {
+        return Fail(line, "expected 'arm', got '" + tokens[0] + "'");
+    }
+    if (tokens.size() < 2) {
+        return Fail(line, "missing failure id");
+    }
+
+    Arm arm;
+    arm.firstFailure = static_cast<uint32_t>(_failureIds.size());
+    arm.failureCount = 0;
+    arm.line = line;
+    arm.hasAltitude = false;
+    arm.altitudeAbove = false;
+    arm.altitude = 0;
+    arm.hasSpeed = false;
+    arm.speed = 0;
+    arm.afterEvent = EventNone;
+    arm.afterEventSeconds = 0.0;
+    arm.hasDelay = false;
+    arm.delaySeconds = 0;
+
+    // Comma-separated failure ids
+    const std::string& ids = tokens[1];
+    size_t start = 0;
+    while (start <= ids.size()) {
+        size_t comma = ids.find(',', start);
+        if (comma == std::string::npos) comma = ids.size();
+        if (comma == start) {
+            return Fail(line, "empty failure id");
+        }
+        _failureIds.push_back(ids.substr(start, comma - start));
+        ++arm.failureCount;
+        start = comma + 1;
+    }
+
+    // Condition clauses
+    size_t i = 2;
+    while (i < tokens.size()) {
+        const std::string& keyword = tokens[i];
+        if (TokenEquals(keyword, "above") || TokenEquals(keyword, "below")) {
+            if (arm.hasAltitude) {
+                return Fail(line, "altitude condition given twice");
+            }
+            if (i + 1 >= tokens.size() || !ParseInt(tokens[i + 1], &arm.altitude)) {
+                return Fail(line, "'" + keyword + "' needs an altitude in feet");
+            }
+            arm.hasAltitude = true;
+            arm.altitudeAbove = TokenEquals(keyword, "above");
+            i += 2;
+        }
+        else if (TokenEquals(keyword, "speed")) {
+            if (arm.hasSpeed) {
+                return Fail(line, "speed condition given twice");
+            }
+            if (i + 1 >= tokens.size() || !ParseInt(tokens[i + 1], &arm.speed)) {
+                return Fail(line, "'speed' needs a speed in knots");
+            }
+            arm.hasSpeed = true;
+            i += 2;
+        }
+        else if (TokenEquals(keyword, "after")) {
+            if (arm.afterEvent != EventNone) {
+                return Fail(line, "event condition given twice");
+            }
+            if (i + 2 >= tokens.size()) {
+                return Fail(line, "'after' needs an event and a time in seconds");
+            }
+            const std::string& event = tokens[i + 1];
+            if (TokenEquals(event, "v1")) arm.afterEvent = EventV1;
+            else if (TokenEquals(event, "takeoff")) arm.afterEvent = EventTakeoff;
+            else if (TokenEquals(event, "landing")) arm.afterEvent = EventLanding;
+            else return Fail(line, "unknown event '" + event + "' (expected v1, takeoff or landing)");
+            if (!ParseSeconds(tokens[i + 2], &arm.afterEventSeconds)) {
+                return Fail(line, "invalid time '" + tokens[i + 2] + "' after " + event);
+            }
+            i += 3;
+        }
+        else if (TokenEquals(keyword, "delay")) {
+            if (arm.hasDelay) {
+                return Fail(line, "delay given twice");
+            }
+            if (i + 1 >= tokens.size() || !ParseInt(tokens[i + 1], &arm.delaySeconds) || arm.delaySeconds < 0) {
+                return Fail(line, "'delay' needs a whole number of seconds");
+            }
+            arm.hasDelay = true;
+            i += 2;
+        }
+        else {
+            return Fail(line, "unknown condition '" + keyword + "'");
+        }
+    }
+
+    _arms.push_back(arm);
+    return true;
+}
+
+BridgeResult FailureScenario::Parse(const char* text, size_t length) {
+    _arms.clear();
+    _failureIds.clear();
+    _error.clear();
+
+    const char* p = text;
+    const char* end = text + length;
+    int32_t line = 1;
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!lineEnd) lineEnd = end;
+        if (!ParseLine(p, lineEnd, line)) {
+            _arms.clear();
+            _failureIds.clear();
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        p = lineEnd + 1;
+        ++line;
+    }
+    return BRIDGE_OK;
+}
+
+BridgeResult FailureScenario::ParseFile(const char* path) {
+    FILE* file = nullptr;
+    if (fopen_s(&file, path, "rb") != 0 || !file) {
+        _error = std::string("cannot open scenario file '") + path + "'";
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    std::string text;
+    char chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        text.append(chunk, read);
+    }
+    fclose(file);
+
+    return Parse(text.data(), text.size());
+}
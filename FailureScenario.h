@@ -0,0 +1,65 @@
+// FailureScenario.h
+// Parser for failure-arming scenario files
+// A scenario is parsed completely (and every failure id resolved) before anything is
+// armed, so a typo on line 180 does not leave the simulator with half a scenario.
+//
+// Format: one armed failure per line, '#' starts a comment, keywords are case-insensitive
+//
+//     arm <id>[,<id>...] [above <ft> | below <ft>] [speed <kt>]
+//                        [after v1|takeoff|landing <seconds>] [delay <seconds>]
+//
+// All failures listed on one line share one condition and trigger together.
+// A line with no condition arms failures that trigger immediately.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ProSimBridge.h"
+
+class FailureScenario {
+public:
+    enum ScenarioEvent {
+        EventNone = -1,
+        EventV1 = 0,                    // values match FailureCondition::EventTypeEnum
+        EventTakeoff = 1,
+        EventLanding = 2
+    };
+
+    struct Arm {
+        uint32_t firstFailure;          // index into FailureIds()
+        uint32_t failureCount;
+        int32_t line;
+
+        bool hasAltitude;
+        bool altitudeAbove;             // false: below
+        int32_t altitude;               // feet
+        bool hasSpeed;
+        int32_t speed;                  // knots
+        int32_t afterEvent;             // ScenarioEvent
+        double afterEventSeconds;
+        bool hasDelay;
+        int32_t delaySeconds;
+    };
+
+private:
+    std::vector<Arm> _arms;
+    std::vector<std::string> _failureIds;
+    std::string _error;
+
+    bool Fail(int32_t line, const std::string& message);
+    bool ParseLine(const char* begin, const char* end, int32_t line);
+
+public:
+    // Parses scenario text; on failure returns BRIDGE_ERR_INVALID_ARGUMENT and
+    // Error() describes the offending line
+    BridgeResult Parse(const char* text, size_t length);
+
+    // Reads and parses a scenario file
+    BridgeResult ParseFile(const char* path);
+
+    const std::vector<Arm>& Arms() const { return _arms; }
+    const std::vector<std::string>& FailureIds() const { return _failureIds; }
+    const std::string& Error() const { return _error; }
+};
@@ -0,0 +1,470 @@
+// FanoutServer.cpp
+// Implementation of the loopback DataRef fan-out server
+
+#include "pch.h"
+#include "FanoutServer.h"
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "ws2_32.lib")
+
+namespace {
+
+// Largest DELTA payload before a new frame is started
+const size_t MaxDeltaPayload = 60000;
+
+// Limits imposed by the wire format
+const size_t MaxRefs = 0xFFFF;
+const size_t MaxNameLength = 0xFF;
+
+// Longest string sent; a record holding it fills a DELTA payload on its own
+// (u16 count, u16 ref_id, u8 type, u16 length, bytes)
+const size_t MaxStringLength = 0xFFFF - 7;
+
+void PutU8(std::vector<char>& out, uint8_t value) {
+    out.push_back(static_cast<char>(value));
+}
+
+void PutU16(std::vector<char>& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+void PutBytes(std::vector<char>& out, const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    out.insert(out.end(), bytes, bytes + length);
+}
+
+uint16_t GetU16(const char* p) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8));
+}
+
+// Starts a frame and returns the offset of its length field
+size_t BeginFrame(std::vector<char>& out, uint8_t type) {
+    PutU8(out, type);
+    size_t lengthOffset = out.size();
+    PutU16(out, 0);
+    return lengthOffset;
+}
+
+void EndFrame(std::vector<char>& out, size_t lengthOffset) {
+    size_t length = out.size() - lengthOffset - 2;
+    out[lengthOffset] = static_cast<char>(length & 0xFF);
+    out[lengthOffset + 1] = static_cast<char>(length >> 8);
+}
+
+void PutValue(std::vector<char>& out, const BridgeValue& value) {
+    PutU8(out, static_cast<uint8_t>(value.type));
+    switch (value.type) {
+    case DATAREF_TYPE_BOOL:
+        PutU8(out, value.boolValue ? 1 : 0);
+        break;
+    case DATAREF_TYPE_INT:
+        // x86 is little-endian, matching the wire format
+        PutBytes(out, &value.intValue, sizeof(int32_t));
+        break;
+    case DATAREF_TYPE_DOUBLE:
+        PutBytes(out, &value.doubleValue, sizeof(double));
+        break;
+    case DATAREF_TYPE_STRING: {
+        size_t length = value.stringValue.size() < MaxStringLength ? value.stringValue.size() : MaxStringLength;
+        PutU16(out, static_cast<uint16_t>(length));
+        PutBytes(out, value.stringValue.data(), length);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+size_t ValueSize(const BridgeValue& value) {
+    switch (value.type) {
+    case DATAREF_TYPE_BOOL:   return 1;
+    case DATAREF_TYPE_INT:    return 4;
+    case DATAREF_TYPE_DOUBLE: return 8;
+    case DATAREF_TYPE_STRING: return 2 + (value.stringValue.size() < MaxStringLength ? value.stringValue.size() : MaxStringLength);
+    default:                  return 0;
+    }
+}
+
+bool SameValue(const BridgeValue& a, const BridgeValue& b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    switch (a.type) {
+    case DATAREF_TYPE_BOOL:   return a.boolValue == b.boolValue;
+    case DATAREF_TYPE_INT:    return a.intValue == b.intValue;
+    case DATAREF_TYPE_DOUBLE: return memcmp(&a.doubleValue, &b.doubleValue, sizeof(double)) == 0;
+    case DATAREF_TYPE_STRING: return a.stringValue == b.stringValue;
+    default:                  return true;
+    }
+}
+
+} // namespace
+
+FanoutServer::FanoutServer()
+    : _version(0)
+    , _listen(INVALID_SOCKET)
+    , _port(0)
+    , _winsockStarted(false)
+    , _clientCount(0)
+    , _framesSent(0)
+    , _bytesSent(0)
+    , _publishes(0)
+{
+}
+
+FanoutServer::~FanoutServer() {
+    Stop();
+}
+
+BridgeResult FanoutServer::Start(uint16_t port) {
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        ProSim_SetLastError("WSAStartup failed");
+        return BRIDGE_ERR_CONNECTION_FAILED;
+    }
+    _winsockStarted = true;
+
+    _listen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_listen == INVALID_SOCKET) {
+        ProSim_SetLastError("Failed to create fan-out socket");
+        Stop();
+        return BRIDGE_ERR_CONNECTION_FAILED;
+    }
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(_listen, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(_listen, SOMAXCONN) != 0) {
+        ProSim_SetLastError("Failed to listen on the fan-out port");
+        Stop();
+        return BRIDGE_ERR_CONNECTION_FAILED;
+    }
+
+    int addressLength = sizeof(address);
+    getsockname(_listen, reinterpret_cast<sockaddr*>(&address), &addressLength);
+    _port = ntohs(address.sin_port);
+
+    u_long nonBlocking = 1;
+    ioctlsocket(_listen, FIONBIO, &nonBlocking);
+
+    if (!_thread.Start(&FanoutServer::ServerMain, this)) {
+        ProSim_SetLastError("Failed to start fan-out server thread");
+        Stop();
+        return BRIDGE_ERR_EXCEPTION;
+    }
+    return BRIDGE_OK;
+}
+
+void FanoutServer::Stop() {
+    _thread.Stop();
+
+    for (size_t i = 0; i < _clients.size(); ++i) {
+        CloseClient(_clients[i]);
+    }
+    _clients.clear();
+    _clientCount = 0;
+
+    if (_listen != INVALID_SOCKET) {
+        closesocket(_listen);
+        _listen = INVALID_SOCKET;
+    }
+    if (_winsockStarted) {
+        WSACleanup();
+        _winsockStarted = false;
+    }
+}
+
+BridgeResult FanoutServer::Publish(const char* name, const BridgeValue& value) {
+    if (value.type != DATAREF_TYPE_BOOL && value.type != DATAREF_TYPE_INT &&
+        value.type != DATAREF_TYPE_DOUBLE && value.type != DATAREF_TYPE_STRING) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    ExclusiveLock guard(_lock);
+    InterlockedIncrement64(&_publishes);
+
+    auto it = _refIndex.find(name);
+    if (it == _refIndex.end()) {
+        size_t nameLength = strlen(name);
+        if (nameLength == 0 || nameLength > MaxNameLength || _refs.size() >= MaxRefs) {
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        RefEntry entry;
+        entry.name.assign(name, nameLength);
+        entry.value = value;
+        entry.version = ++_version;
+        _refIndex[entry.name] = static_cast<uint32_t>(_refs.size());
+        _refs.push_back(entry);
+        return BRIDGE_OK;
+    }
+
+    RefEntry& entry = _refs[it->second];
+    if (!SameValue(entry.value, value)) {
+        entry.value = value;
+        entry.version = ++_version;
+    }
+    return BRIDGE_OK;
+}
+
+void FanoutServer::GetStats(FanoutStats* outStats) {
+    {
+        SharedLock guard(_lock);
+        outStats->refs = static_cast<int32_t>(_refs.size());
+    }
+    outStats->clients = _clientCount;
+    outStats->frames_sent = static_cast<uint64_t>(_framesSent);
+    outStats->bytes_sent = static_cast<uint64_t>(_bytesSent);
+    outStats->publishes = static_cast<uint64_t>(_publishes);
+}
+
+void FanoutServer::ServerMain(NativeThread* thread, void* context) {
+    static_cast<FanoutServer*>(context)->Run(thread);
+}
+
+void FanoutServer::Run(NativeThread* thread) {
+    while (!thread->WaitForStop(0)) {
+        fd_set readSet;
+        fd_set writeSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        FD_SET(_listen, &readSet);
+        for (size_t i = 0; i < _clients.size(); ++i) {
+            FD_SET(_clients[i]->socket, &readSet);
+            if (_clients[i]->outboundSent < _clients[i]->outbound.size()) {
+                FD_SET(_clients[i]->socket, &writeSet);
+            }
+        }
+
+        // select doubles as the tick timer
+        timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = TickMs * 1000;
+        int ready = select(0, &readSet, &writeSet, nullptr, &timeout);
+        if (ready == SOCKET_ERROR) {
+            Sleep(TickMs);
+            continue;
+        }
+
+        if (ready > 0 && FD_ISSET(_listen, &readSet)) {
+            Accept();
+        }
+
+        double now = MonotonicClock::Now();
+        for (size_t i = 0; i < _clients.size();) {
+            Client* client = _clients[i];
+            bool alive = true;
+            if (ready > 0 && FD_ISSET(client->socket, &readSet)) {
+                alive = Receive(client);
+            }
+
+            // A client still draining its last update is skipped; it gets the latest
+            // values once it catches up instead of a growing backlog
+            if (alive && client->subscribed && now >= client->nextSend &&
+                client->outboundSent == client->outbound.size()) {
+                client->outbound.clear();
+                client->outboundSent = 0;
+                BuildUpdate(client);
+                client->nextSend = now + client->interval;
+            }
+            if (alive) {
+                alive = Flush(client);
+            }
+
+            if (!alive) {
+                CloseClient(client);
+                _clients.erase(_clients.begin() + i);
+                InterlockedDecrement(&_clientCount);
+                continue;
+            }
+            ++i;
+        }
+    }
+}
+
+void FanoutServer::Accept() {
+    for (;;) {
+        SOCKET socketHandle = accept(_listen, nullptr, nullptr);
+        if (socketHandle == INVALID_SOCKET) {
+            return;
+        }
+
+        // FD_SETSIZE bounds how many sockets one select call can watch. Connections past it
+        // are closed at once; leaving them queued would keep the listen socket readable and
+        // select would return immediately on every tick.
+        if (_clients.size() + 1 >= FD_SETSIZE) {
+            closesocket(socketHandle);
+            continue;
+        }
+
+        u_long nonBlocking = 1;
+        ioctlsocket(socketHandle, FIONBIO, &nonBlocking);
+        BOOL noDelay = TRUE;
+        setsockopt(socketHandle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        Client* client = new Client();
+        client->socket = socketHandle;
+        client->outboundSent = 0;
+        client->subscribed = false;
+        client->allRefs = false;
+        client->builtVersion = 0;
+        client->interval = 0.0;
+        client->nextSend = 0.0;
+        _clients.push_back(client);
+        InterlockedIncrement(&_clientCount);
+    }
+}
+
+bool FanoutServer::Receive(Client* client) {
+    char buffer[4096];
+    int received = recv(client->socket, buffer, sizeof(buffer), 0);
+    if (received == 0) {
+        return false; // closed by the client
+    }
+    if (received == SOCKET_ERROR) {
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+    }
+    client->inbound.insert(client->inbound.end(), buffer, buffer + received);
+
+    // Handle every complete frame
+    size_t offset = 0;
+    while (client->inbound.size() - offset >= 3) {
+        const char* frame = client->inbound.data() + offset;
+        uint8_t type = static_cast<uint8_t>(frame[0]);
+        size_t length = GetU16(frame + 1);
+        if (client->inbound.size() - offset < 3 + length) {
+            break;
+        }
+        if (!HandleRequest(client, type, frame + 3, length)) {
+            return false;
+        }
+        offset += 3 + length;
+    }
+    client->inbound.erase(client->inbound.begin(), client->inbound.begin() + offset);
+    return true;
+}
+
+bool FanoutServer::HandleRequest(Client* client, uint8_t type, const char* payload, size_t length) {
+    if (type != FANOUT_MSG_SUBSCRIBE || length < 4) {
+        return false; // protocol error: drop the client
+    }
+
+    uint16_t rateHz = GetU16(payload);
+    uint16_t count = GetU16(payload + 2);
+    std::unordered_set<std::string> names;
+    size_t offset = 4;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (offset >= length) {
+            return false;
+        }
+        size_t nameLength = static_cast<uint8_t>(payload[offset]);
+        if (offset + 1 + nameLength > length) {
+            return false;
+        }
+        names.insert(std::string(payload + offset + 1, nameLength));
+        offset += 1 + nameLength;
+    }
+
+    // A new subscription replaces the old one and starts with the current value of
+    // every wanted ref; definitions already sent stay valid
+    client->subscribed = true;
+    client->allRefs = (count == 0);
+    client->names.swap(names);
+    client->wanted.clear();
+    client->sentVersion.assign(client->sentVersion.size(), 0);
+    client->builtVersion = 0;
+    client->interval = (rateHz > 0) ? 1.0 / rateHz : 0.0;
+    client->nextSend = 0.0;
+    return true;
+}
+
+void FanoutServer::BuildUpdate(Client* client) {
+    SharedLock guard(_lock);
+    if (_version == client->builtVersion) {
+        return; // nothing published since the last update
+    }
+    client->builtVersion = _version;
+    std::vector<char>& out = client->outbound;
+
+    // Resolve refs published since the last update against the subscription
+    size_t known = client->wanted.size();
+    if (known < _refs.size()) {
+        client->wanted.resize(_refs.size());
+        client->defined.resize(_refs.size(), 0);
+        client->sentVersion.resize(_refs.size(), 0);
+        for (size_t id = known; id < _refs.size(); ++id) {
+            client->wanted[id] = client->allRefs || client->names.count(_refs[id].name) != 0;
+        }
+    }
+
+    // Definitions first, so every id in the deltas below is known to the client
+    for (size_t id = 0; id < _refs.size(); ++id) {
+        if (client->wanted[id] && !client->defined[id]) {
+            const std::string& name = _refs[id].name;
+            size_t lengthOffset = BeginFrame(out, FANOUT_MSG_DEFINE);
+            PutU16(out, static_cast<uint16_t>(id));
+            PutU8(out, static_cast<uint8_t>(name.size()));
+            PutBytes(out, name.data(), name.size());
+            EndFrame(out, lengthOffset);
+            InterlockedIncrement64(&_framesSent);
+            client->defined[id] = 1;
+        }
+    }
+
+    size_t lengthOffset = 0;
+    size_t countOffset = 0;
+    uint16_t count = 0;
+    for (size_t id = 0; id < _refs.size(); ++id) {
+        const RefEntry& entry = _refs[id];
+        if (!client->wanted[id] || entry.version <= client->sentVersion[id]) {
+            continue;
+        }
+
+        size_t recordSize = 3 + ValueSize(entry.value);
+        if (count > 0 && (out.size() - countOffset + recordSize > MaxDeltaPayload || count == 0xFFFF)) {
+            out[countOffset] = static_cast<char>(count & 0xFF);
+            out[countOffset + 1] = static_cast<char>(count >> 8);
+            EndFrame(out, lengthOffset);
+            InterlockedIncrement64(&_framesSent);
+            count = 0;
+        }
+        if (count == 0) {
+            lengthOffset = BeginFrame(out, FANOUT_MSG_DELTA);
+            countOffset = out.size();
+            PutU16(out, 0);
+        }
+
+        PutU16(out, static_cast<uint16_t>(id));
+        PutValue(out, entry.value);
+        client->sentVersion[id] = entry.version;
+        ++count;
+    }
+    if (count > 0) {
+        out[countOffset] = static_cast<char>(count & 0xFF);
+        out[countOffset + 1] = static_cast<char>(count >> 8);
+        EndFrame(out, lengthOffset);
+        InterlockedIncrement64(&_framesSent);
+    }
+}
+
+bool FanoutServer::Flush(Client* client) {
+    while (client->outboundSent < client->outbound.size()) {
+        size_t remaining = client->outbound.size() - client->outboundSent;
+        int chunk = remaining > 0x10000 ? 0x10000 : static_cast<int>(remaining);
+        int sent = send(client->socket, client->outbound.data() + client->outboundSent, chunk, 0);
+        if (sent == SOCKET_ERROR) {
+            return WSAGetLastError() == WSAEWOULDBLOCK;
+        }
+        client->outboundSent += static_cast<size_t>(sent);
+        InterlockedExchangeAdd64(&_bytesSent, sent);
+    }
+    return true;
+}
+
+void FanoutServer::CloseClient(Client* client) {
+    closesocket(client->socket);
+    delete client;
+}
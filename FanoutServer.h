@@ -0,0 +1,97 @@
+// FanoutServer.h
+// Loopback TCP server that rebroadcasts DataRef changes to local subscribers
+// Dashboards and tools subscribe here instead of each holding an SDK connection. Values
+// are published into a table (from attached connections or directly), and each client
+// receives only the refs it asked for, coalesced to the latest value at its max rate.
+// The wire format is described with the FANOUT_MSG_* constants in ProSimBridge.h.
+
+#pragma once
+
+// select() watches at most FD_SETSIZE sockets (64 by default on Windows)
+#ifndef FD_SETSIZE
+#define FD_SETSIZE 256
+#endif
+#include <winsock2.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "ProSimBridge.h"
+#include "NativeSupport.h"
+#include "WritePipeline.h"
+
+class FanoutServer {
+private:
+    // Server tick; also the send interval for clients without a rate limit
+    static const DWORD TickMs = 10;
+
+    struct RefEntry {
+        std::string name;
+        BridgeValue value;
+        uint64_t version;               // _version when the value last changed
+    };
+
+    struct Client {
+        SOCKET socket;
+        std::vector<char> inbound;      // unparsed request bytes
+        std::vector<char> outbound;     // bytes the socket has not accepted yet
+        size_t outboundSent;
+
+        bool subscribed;
+        bool allRefs;
+        std::unordered_set<std::string> names;
+        std::vector<uint8_t> wanted;    // per ref id, resolved as refs appear
+        std::vector<uint8_t> defined;   // per ref id; definition already sent
+        std::vector<uint64_t> sentVersion; // per ref id; 0 = value not sent since subscribing
+        uint64_t builtVersion;          // table version of the last update built
+        double interval;                // seconds between sends, 0 = every tick
+        double nextSend;
+    };
+
+    SrwLock _lock;                      // guards the ref table
+    std::vector<RefEntry> _refs;
+    std::unordered_map<std::string, uint32_t> _refIndex;
+    uint64_t _version;
+
+    // Server thread only
+    std::vector<Client*> _clients;
+
+    SOCKET _listen;
+    uint16_t _port;
+    bool _winsockStarted;
+    NativeThread _thread;
+
+    volatile LONG _clientCount;
+    volatile LONG64 _framesSent;
+    volatile LONG64 _bytesSent;
+    volatile LONG64 _publishes;
+
+    static void ServerMain(NativeThread* thread, void* context);
+    void Run(NativeThread* thread);
+    void Accept();
+    bool Receive(Client* client);
+    bool HandleRequest(Client* client, uint8_t type, const char* payload, size_t length);
+    void BuildUpdate(Client* client);
+    bool Flush(Client* client);
+    static void CloseClient(Client* client);
+
+    FanoutServer(const FanoutServer&) = delete;
+    FanoutServer& operator=(const FanoutServer&) = delete;
+
+public:
+    FanoutServer();
+    ~FanoutServer();
+
+    // Listens on 127.0.0.1:port (0 picks a free port) and starts the server thread
+    BridgeResult Start(uint16_t port);
+    void Stop();
+    uint16_t Port() const { return _port; }
+
+    // Records a value; subscribers receive it on their next send if it changed.
+    // Returns BRIDGE_ERR_INVALID_ARGUMENT for unsupported types, names over 255 bytes
+    // or once 65535 refs exist.
+    BridgeResult Publish(const char* name, const BridgeValue& value);
+
+    void GetStats(FanoutStats* outStats);
+};
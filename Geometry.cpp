@@ -0,0 +1,289 @@
+// Geometry.cpp
+// Implementation of the batch relative-geometry kernel
+// Compiled as native code: SSE2 intrinsics are not available in managed functions.
+
+#include "pch.h"
+#include "Geometry.h"
+#include <math.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define GEOMETRY_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#pragma managed(push, off)
+
+const double GeometryKernel::EarthRadiusNm = 6371.0088 / 1.852;
+
+namespace {
+    const double Pi = 3.14159265358979323846;
+    const double DegToRad = Pi / 180.0;
+    const double RadToDeg = 180.0 / Pi;
+
+    struct OwnshipTerms {
+        double latRad;
+        double lonRad;
+        double sinLat;
+        double cosLat;
+        double altitude;
+        double velNorth;                // knots
+        double velEast;
+    };
+
+    OwnshipTerms PrepareOwnship(const GeoState& ownship) {
+        OwnshipTerms own;
+        own.latRad = ownship.latitude * DegToRad;
+        own.lonRad = ownship.longitude * DegToRad;
+        own.sinLat = sin(own.latRad);
+        own.cosLat = cos(own.latRad);
+        own.altitude = ownship.altitude;
+        own.velNorth = ownship.ground_speed * cos(ownship.track_true * DegToRad);
+        own.velEast = ownship.ground_speed * sin(ownship.track_true * DegToRad);
+        return own;
+    }
+
+    void ComputeOne(const OwnshipTerms& own, double lat, double lon, double alt,
+                    double groundSpeed, double track, RelativeGeometry* out) {
+        double lat2 = lat * DegToRad;
+        double dLat = lat2 - own.latRad;
+        double dLon = lon * DegToRad - own.lonRad;
+        double sinHalfLat = sin(dLat * 0.5);
+        double sinHalfLon = sin(dLon * 0.5);
+        double cosLat2 = cos(lat2);
+
+        double a = sinHalfLat * sinHalfLat + own.cosLat * cosLat2 * sinHalfLon * sinHalfLon;
+        if (a > 1.0) a = 1.0;
+        out->range_nm = 2.0 * atan2(sqrt(a), sqrt(1.0 - a)) * GeometryKernel::EarthRadiusNm;
+
+        double east = sin(dLon) * cosLat2;
+        double north = own.cosLat * sin(lat2) - own.sinLat * cosLat2 * cos(dLon);
+        double bearing = atan2(east, north) * RadToDeg;
+        out->bearing_deg = bearing < 0.0 ? bearing + 360.0 : bearing;
+
+        out->relative_altitude_ft = alt - own.altitude;
+
+        double h = sqrt(east * east + north * north);
+        if (h > 0.0) {
+            double tgtNorth = groundSpeed * cos(track * DegToRad);
+            double tgtEast = groundSpeed * sin(track * DegToRad);
+            out->closure_rate_kt = ((own.velNorth - tgtNorth) * north + (own.velEast - tgtEast) * east) / h;
+        }
+        else {
+            out->closure_rate_kt = 0.0;
+        }
+    }
+
+#ifdef GEOMETRY_SSE2
+    // ------------------------------------------------------------------------
+    // Two-lane double precision sin/cos and atan2, after the Cephes library
+    // ------------------------------------------------------------------------
+
+    inline __m128d Splat(double v) { return _mm_set1_pd(v); }
+
+    inline __m128d Poly5(__m128d x, double c0, double c1, double c2, double c3, double c4, double c5) {
+        __m128d r = Splat(c0);
+        r = _mm_add_pd(_mm_mul_pd(r, x), Splat(c1));
+        r = _mm_add_pd(_mm_mul_pd(r, x), Splat(c2));
+        r = _mm_add_pd(_mm_mul_pd(r, x), Splat(c3));
+        r = _mm_add_pd(_mm_mul_pd(r, x), Splat(c4));
+        return _mm_add_pd(_mm_mul_pd(r, x), Splat(c5));
+    }
+
+    inline __m128d Select(__m128d mask, __m128d ifTrue, __m128d ifFalse) {
+        return _mm_or_pd(_mm_and_pd(mask, ifTrue), _mm_andnot_pd(mask, ifFalse));
+    }
+
+    // Expands the low two int32 lanes into two 64-bit lane masks where (lane & bit) != 0
+    inline __m128d BitMask(__m128i lanes, int bit) {
+        __m128i wide = _mm_shuffle_epi32(lanes, _MM_SHUFFLE(1, 1, 0, 0));
+        __m128i b = _mm_set1_epi32(bit);
+        return _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(wide, b), b));
+    }
+
+    // Arguments must be within int32 range of multiples of pi/4 (always true for angles
+    // derived from degrees)
+    void SinCos(__m128d x, __m128d* outSin, __m128d* outCos) {
+        const __m128d signBit = Splat(-0.0);
+        __m128d ax = _mm_andnot_pd(signBit, x);
+        __m128d sinSign = _mm_and_pd(signBit, x);
+
+        // Octant index rounded up to even: x = j * pi/4 + z with |z| <= pi/4
+        __m128i j = _mm_cvttpd_epi32(_mm_mul_pd(ax, Splat(4.0 / Pi)));
+        j = _mm_add_epi32(j, _mm_set1_epi32(1));
+        j = _mm_and_si128(j, _mm_set1_epi32(~1));
+        __m128d y = _mm_cvtepi32_pd(j);
+
+        __m128d z = _mm_sub_pd(ax, _mm_mul_pd(y, Splat(7.85398125648498535156E-1)));
+        z = _mm_sub_pd(z, _mm_mul_pd(y, Splat(3.77489470793079817668E-8)));
+        z = _mm_sub_pd(z, _mm_mul_pd(y, Splat(2.69515142907905952645E-15)));
+        __m128d zz = _mm_mul_pd(z, z);
+
+        __m128d polySin = Poly5(zz, 1.58962301576546568060E-10, -2.50507477628578072866E-8,
+                                2.75573136213857245213E-6, -1.98412698295895385996E-4,
+                                8.33333333332211858878E-3, -1.66666666666666307295E-1);
+        polySin = _mm_add_pd(z, _mm_mul_pd(_mm_mul_pd(z, zz), polySin));
+
+        __m128d polyCos = Poly5(zz, -1.13585365213876817300E-11, 2.08757008419747316778E-9,
+                                -2.75573141792967388112E-7, 2.48015872888517045348E-5,
+                                -1.38888888888730564116E-3, 4.16666666666665929218E-2);
+        polyCos = _mm_add_pd(_mm_sub_pd(Splat(1.0), _mm_mul_pd(Splat(0.5), zz)),
+                             _mm_mul_pd(_mm_mul_pd(zz, zz), polyCos));
+
+        // Quadrant q = j / 2: odd quadrants swap sin and cos, sign follows the quadrant
+        __m128d swap = BitMask(j, 2);
+        __m128d s = Select(swap, polyCos, polySin);
+        __m128d c = Select(swap, polySin, polyCos);
+
+        sinSign = _mm_xor_pd(sinSign, _mm_and_pd(BitMask(j, 4), signBit));
+        __m128d cosSign = _mm_and_pd(BitMask(_mm_add_epi32(j, _mm_set1_epi32(2)), 4), signBit);
+
+        *outSin = _mm_xor_pd(s, sinSign);
+        *outCos = _mm_xor_pd(c, cosSign);
+    }
+
+    // atan for x >= 0
+    __m128d AtanPositive(__m128d x) {
+        const double T3P8 = 2.41421356237309504880;
+        const double MoreBits = 6.123233995736765886130E-17;
+
+        __m128d big = _mm_cmpgt_pd(x, Splat(T3P8));
+        __m128d mid = _mm_andnot_pd(big, _mm_cmpgt_pd(x, Splat(0.66)));
+
+        __m128d xBig = _mm_div_pd(Splat(-1.0), x);
+        __m128d xMid = _mm_div_pd(_mm_sub_pd(x, Splat(1.0)), _mm_add_pd(x, Splat(1.0)));
+        __m128d xr = Select(big, xBig, Select(mid, xMid, x));
+        __m128d base = Select(big, Splat(Pi / 2), _mm_and_pd(mid, Splat(Pi / 4)));
+        __m128d extra = Select(big, Splat(MoreBits), _mm_and_pd(mid, Splat(0.5 * MoreBits)));
+
+        __m128d z = _mm_mul_pd(xr, xr);
+        __m128d p = Splat(-8.750608600031904122785E-1);
+        p = _mm_add_pd(_mm_mul_pd(p, z), Splat(-1.615753718733365076637E1));
+        p = _mm_add_pd(_mm_mul_pd(p, z), Splat(-7.500855792314704667340E1));
+        p = _mm_add_pd(_mm_mul_pd(p, z), Splat(-1.228866684490136173410E2));
+        p = _mm_add_pd(_mm_mul_pd(p, z), Splat(-6.485021904942025371773E1));
+        __m128d q = _mm_add_pd(z, Splat(2.485846490142306297962E1));
+        q = _mm_add_pd(_mm_mul_pd(q, z), Splat(1.650270098316988542046E2));
+        q = _mm_add_pd(_mm_mul_pd(q, z), Splat(4.328810604912902668951E2));
+        q = _mm_add_pd(_mm_mul_pd(q, z), Splat(4.853903996359136964868E2));
+        q = _mm_add_pd(_mm_mul_pd(q, z), Splat(1.945506571482613964425E2));
+
+        __m128d r = _mm_mul_pd(z, _mm_div_pd(p, q));
+        r = _mm_add_pd(_mm_mul_pd(xr, r), xr);
+        return _mm_add_pd(base, _mm_add_pd(r, extra));
+    }
+
+    __m128d Atan2(__m128d y, __m128d x) {
+        const __m128d signBit = Splat(-0.0);
+        __m128d ay = _mm_andnot_pd(signBit, y);
+        __m128d ax = _mm_andnot_pd(signBit, x);
+
+        // max() keeps 0/0 at 0 instead of NaN
+        __m128d t = AtanPositive(_mm_div_pd(ay, _mm_max_pd(ax, Splat(1e-300))));
+        t = Select(_mm_cmplt_pd(x, _mm_setzero_pd()), _mm_sub_pd(Splat(Pi), t), t);
+        return _mm_or_pd(t, _mm_and_pd(y, signBit));
+    }
+
+    void ComputeTwo(const OwnshipTerms& own, const double* lat, const double* lon, const double* alt,
+                    const double* groundSpeed, const double* track, RelativeGeometry* out) {
+        const __m128d degToRad = Splat(DegToRad);
+
+        __m128d lat2 = _mm_mul_pd(_mm_loadu_pd(lat), degToRad);
+        __m128d dLat = _mm_sub_pd(lat2, Splat(own.latRad));
+        __m128d dLon = _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(lon), degToRad), Splat(own.lonRad));
+
+        __m128d sinHalfLat, cosHalfLat, sinHalfLon, cosHalfLon, sinLat2, cosLat2;
+        SinCos(_mm_mul_pd(dLat, Splat(0.5)), &sinHalfLat, &cosHalfLat);
+        SinCos(_mm_mul_pd(dLon, Splat(0.5)), &sinHalfLon, &cosHalfLon);
+        SinCos(lat2, &sinLat2, &cosLat2);
+
+        // Haversine central angle
+        __m128d a = _mm_add_pd(_mm_mul_pd(sinHalfLat, sinHalfLat),
+                               _mm_mul_pd(_mm_mul_pd(Splat(own.cosLat), cosLat2),
+                                          _mm_mul_pd(sinHalfLon, sinHalfLon)));
+        a = _mm_min_pd(a, Splat(1.0));
+        __m128d angle = Atan2(_mm_sqrt_pd(a), _mm_sqrt_pd(_mm_sub_pd(Splat(1.0), a)));
+        __m128d range = _mm_mul_pd(angle, Splat(2.0 * GeometryKernel::EarthRadiusNm));
+
+        // Initial bearing; sin/cos of dLon come from the half angle
+        __m128d sinDLon = _mm_mul_pd(Splat(2.0), _mm_mul_pd(sinHalfLon, cosHalfLon));
+        __m128d cosDLon = _mm_sub_pd(Splat(1.0), _mm_mul_pd(Splat(2.0), _mm_mul_pd(sinHalfLon, sinHalfLon)));
+        __m128d east = _mm_mul_pd(sinDLon, cosLat2);
+        __m128d north = _mm_sub_pd(_mm_mul_pd(Splat(own.cosLat), sinLat2),
+                                   _mm_mul_pd(_mm_mul_pd(Splat(own.sinLat), cosLat2), cosDLon));
+        __m128d bearing = _mm_mul_pd(Atan2(east, north), Splat(RadToDeg));
+        bearing = _mm_add_pd(bearing, _mm_and_pd(_mm_cmplt_pd(bearing, _mm_setzero_pd()), Splat(360.0)));
+
+        __m128d relAlt = _mm_sub_pd(_mm_loadu_pd(alt), Splat(own.altitude));
+
+        // Closure: relative velocity projected on the line of sight
+        __m128d relNorth = Splat(own.velNorth);
+        __m128d relEast = Splat(own.velEast);
+        if (groundSpeed && track) {
+            __m128d gs = _mm_loadu_pd(groundSpeed);
+            __m128d sinTrk, cosTrk;
+            SinCos(_mm_mul_pd(_mm_loadu_pd(track), degToRad), &sinTrk, &cosTrk);
+            relNorth = _mm_sub_pd(relNorth, _mm_mul_pd(gs, cosTrk));
+            relEast = _mm_sub_pd(relEast, _mm_mul_pd(gs, sinTrk));
+        }
+        __m128d h = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(east, east), _mm_mul_pd(north, north)));
+        __m128d closure = _mm_div_pd(_mm_add_pd(_mm_mul_pd(relNorth, north), _mm_mul_pd(relEast, east)),
+                                     _mm_max_pd(h, Splat(1e-300)));
+        closure = _mm_and_pd(_mm_cmpgt_pd(h, _mm_setzero_pd()), closure);
+
+        double r[2], b[2], v[2], c[2];
+        _mm_storeu_pd(r, range);
+        _mm_storeu_pd(b, bearing);
+        _mm_storeu_pd(v, relAlt);
+        _mm_storeu_pd(c, closure);
+        for (int i = 0; i < 2; ++i) {
+            out[i].range_nm = r[i];
+            out[i].bearing_deg = b[i];
+            out[i].relative_altitude_ft = v[i];
+            out[i].closure_rate_kt = c[i];
+        }
+    }
+#endif
+}
+
+void GeometryKernel::ComputeScalar(const GeoState& ownship,
+                                   const double* latitudes, const double* longitudes, const double* altitudes,
+                                   const double* groundSpeeds, const double* tracks,
+                                   size_t count, RelativeGeometry* out) {
+    OwnshipTerms own = PrepareOwnship(ownship);
+    bool moving = groundSpeeds && tracks;
+    for (size_t i = 0; i < count; ++i) {
+        ComputeOne(own, latitudes[i], longitudes[i], altitudes[i],
+                   moving ? groundSpeeds[i] : 0.0, moving ? tracks[i] : 0.0, &out[i]);
+    }
+}
+
+void GeometryKernel::Compute(const GeoState& ownship,
+                             const double* latitudes, const double* longitudes, const double* altitudes,
+                             const double* groundSpeeds, const double* tracks,
+                             size_t count, RelativeGeometry* out) {
+#ifdef GEOMETRY_SSE2
+    OwnshipTerms own = PrepareOwnship(ownship);
+    bool moving = groundSpeeds && tracks;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        ComputeTwo(own, latitudes + i, longitudes + i, altitudes + i,
+                   moving ? groundSpeeds + i : nullptr, moving ? tracks + i : nullptr, &out[i]);
+    }
+    if (i < count) {
+        ComputeOne(own, latitudes[i], longitudes[i], altitudes[i],
+                   moving ? groundSpeeds[i] : 0.0, moving ? tracks[i] : 0.0, &out[i]);
+    }
+#else
+    ComputeScalar(ownship, latitudes, longitudes, altitudes, groundSpeeds, tracks, count, out);
+#endif
+}
+
+bool GeometryKernel::IsVectorized() {
+#ifdef GEOMETRY_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+#pragma managed(pop)
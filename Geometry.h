@@ -0,0 +1,31 @@
+// Geometry.h
+// Batch relative-geometry kernel (range, bearing, relative altitude, closure rate)
+// Inputs are struct-of-arrays so the kernel can process two targets per SSE2 register;
+// builds without SSE2 use the scalar path for every target.
+
+#pragma once
+
+#include <stddef.h>
+#include "ProSimBridge.h"
+
+class GeometryKernel {
+public:
+    // Mean Earth radius in nautical miles (6371.0088 km)
+    static const double EarthRadiusNm;
+
+    // Computes the geometry from ownship to count targets. groundSpeeds and tracks may be
+    // NULL, in which case the targets are treated as stationary.
+    static void Compute(const GeoState& ownship,
+                        const double* latitudes, const double* longitudes, const double* altitudes,
+                        const double* groundSpeeds, const double* tracks,
+                        size_t count, RelativeGeometry* out);
+
+    // Same as Compute using the C runtime's trigonometry only
+    static void ComputeScalar(const GeoState& ownship,
+                              const double* latitudes, const double* longitudes, const double* altitudes,
+                              const double* groundSpeeds, const double* tracks,
+                              size_t count, RelativeGeometry* out);
+
+    // True if Compute uses the SIMD kernel in this build
+    static bool IsVectorized();
+};
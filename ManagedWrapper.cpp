@@ -3,14 +3,20 @@
 
 #include "pch.h"
 #include "ManagedWrapper.h"
+#include "FanoutServer.h"
 #include <cstring>
+#include <cstdio>
+#include <new>
 
 using namespace System;
+using namespace System::Collections::Generic;
 using namespace System::Runtime::InteropServices;
+using namespace System::Text;
 using namespace ProSimSDK;
 
-// Helper function to store exception message for error reporting
-static void StoreExceptionMessage(Exception^ ex) {
+// Helper function to store exception message for error reporting; when capture is given the
+// message is also copied there, for callers that report it somewhere other than the last error
+static void StoreExceptionMessage(Exception^ ex, char* capture = nullptr, size_t captureSize = 0) {
     if (ex != nullptr) {
         try {
             // Build detailed error message with exception type and message
@@ -31,6 +37,9 @@ static void StoreExceptionMessage(Exception^ ex) {
             IntPtr ptr = Marshal::StringToHGlobalAnsi(fullMessage);
             try {
                 ProSim_SetLastError(static_cast<const char*>(ptr.ToPointer()));
+                if (capture && captureSize > 0) {
+                    strncpy_s(capture, captureSize, static_cast<const char*>(ptr.ToPointer()), _TRUNCATE);
+                }
             }
             finally {
                 Marshal::FreeHGlobal(ptr);
@@ -38,6 +47,9 @@ static void StoreExceptionMessage(Exception^ ex) {
         }
         catch (...) {
             ProSim_SetLastError("Exception occurred (failed to get details)");
+            if (capture && captureSize > 0) {
+                strncpy_s(capture, captureSize, "Exception occurred (failed to get details)", _TRUNCATE);
+            }
         }
     }
 }
@@ -58,16 +70,102 @@ void ConnectionEventBridge::OnDisconnect() {
     }
 }
 
+void ConnectionEventBridge::OnDataRefsUpdated() {
+    if (_nativeWrapper) {
+        _nativeWrapper->FireOnDataRefsUpdated();
+    }
+}
+
+void ConnectionEventBridge::OnAiTrafficAdded(AiTrafficObject^ traffic) {
+    if (_nativeWrapper && traffic != nullptr) {
+        // Copy the numeric fields once here so consumers never touch the managed object
+        TrafficTarget target;
+        target.object_id = traffic->ObjectId;
+        target.latitude = traffic->Latitude;
+        target.longitude = traffic->Longitude;
+        target.altitude = traffic->Altitude;
+        target.altitude_indicated = traffic->AltitudeIndicated;
+        target.ground_speed = traffic->GroundSpeed;
+        target.heading_true = traffic->HeadingTrue;
+        target.vertical_speed = traffic->VerticalSpeed;
+        target.velocity_x = traffic->VelocityWorldX;
+        target.velocity_y = traffic->VelocityWorldY;
+        target.velocity_z = traffic->VelocityWorldZ;
+        target.on_ground = traffic->OnGround;
+        target.distance_nm = 0.0;
+        _nativeWrapper->GetTraffic().Upsert(target);
+    }
+}
+
+void ConnectionEventBridge::OnAiTrafficRemoved(unsigned int objectId) {
+    if (_nativeWrapper) {
+        _nativeWrapper->GetTraffic().Remove(objectId);
+    }
+}
+
+// ============================================================================
+// FailureEventBridge Implementation
+// ============================================================================
+
+void FailureEventBridge::Track(ArmedFailure^ armed) {
+    armed->onTrigger += gcnew ArmedFailureEventDelegate(this, &FailureEventBridge::OnTrigger);
+    armed->onRemove += gcnew ArmedFailureEventDelegate(this, &FailureEventBridge::OnRemove);
+    if (_nativeWrapper) {
+        _nativeWrapper->ApplyArmedFailure(armed, armed->isActive ? FAILURE_STATE_TRIGGERED : FAILURE_STATE_ARMED);
+    }
+}
+
+void FailureEventBridge::OnNew(ArmedFailure^ armed) {
+    if (_nativeWrapper && armed != nullptr) {
+        Track(armed);
+    }
+}
+
+void FailureEventBridge::OnTrigger(ArmedFailure^ armed) {
+    if (_nativeWrapper && armed != nullptr) {
+        _nativeWrapper->ApplyArmedFailure(armed, FAILURE_STATE_TRIGGERED);
+    }
+}
+
+void FailureEventBridge::OnRemove(ArmedFailure^ armed) {
+    if (armed == nullptr) {
+        return;
+    }
+    armed->onTrigger -= gcnew ArmedFailureEventDelegate(this, &FailureEventBridge::OnTrigger);
+    armed->onRemove -= gcnew ArmedFailureEventDelegate(this, &FailureEventBridge::OnRemove);
+    if (_nativeWrapper) {
+        _nativeWrapper->ApplyArmedFailure(armed, FAILURE_STATE_NONE);
+    }
+}
+
 // ============================================================================
 // ProSimConnectWrapper Implementation
 // ============================================================================
 
 ProSimConnectWrapper::ProSimConnectWrapper()
     : _disposed(false)
+    , _dataRefPool(new SlabPool(sizeof(DataRefWrapper), 256))
+    , _historyBytes(0)
+    , _historyLimit(0)
+    , _cacheBytes(0)
     , _onConnectCallback(nullptr)
     , _onConnectUserData(nullptr)
     , _onDisconnectCallback(nullptr)
     , _onDisconnectUserData(nullptr)
+    , _onDataRefsUpdatedCallback(nullptr)
+    , _onDataRefsUpdatedUserData(nullptr)
+    , _asyncWriter(this)
+    , _fanout(nullptr)
+    , _dispatcher(nullptr)
+    , _derivedNotifyThread(0)
+    , _lazyRegistration(0)
+    , _idleTtlMs(0)
+    , _adaptiveIntervals(0)
+    , _minIntervalMs(0)
+    , _maxIntervalMs(0)
+    , _reviewWindowMs(0)
+    , _userPriority(false)
+    , _writerPriority(false)
 {
     _connection = gcnew ProSimConnect();
     _eventBridge = gcnew ConnectionEventBridge(this);
@@ -75,18 +173,45 @@ ProSimConnectWrapper::ProSimConnectWrapper()
     // Subscribe to managed events using the bridge class
     _connection->onConnect += gcnew ProSimConnect::connectionChangedDelegate(_eventBridge, &ConnectionEventBridge::OnConnect);
     _connection->onDisconnect += gcnew ProSimConnect::connectionChangedDelegate(_eventBridge, &ConnectionEventBridge::OnDisconnect);
+    _connection->onDataRefsUpdated += gcnew ProSimConnect::connectionChangedDelegate(_eventBridge, &ConnectionEventBridge::OnDataRefsUpdated);
+    _connection->onAiTrafficAdded += gcnew ProSimConnect::aiTrafficAddedDelegate(_eventBridge, &ConnectionEventBridge::OnAiTrafficAdded);
+    _connection->onAiTrafficRemoved += gcnew ProSimConnect::aiTrafficRemovedDelegate(_eventBridge, &ConnectionEventBridge::OnAiTrafficRemoved);
 }
 
 ProSimConnectWrapper::~ProSimConnectWrapper() {
     if (!_disposed) {
         _disposed = true;
+
+        // DataRef handles still alive let go of the connection first, while the writers,
+        // the dispatcher and the registration threads they detach from are still running
+        ReleaseLiveDataRefs();
+
+        // Stop background threads before the connection goes away
+        _idleSweeper.Stop();
+        _intervalTuner.Stop();
+        _writeBuffer.Shutdown();
+        _asyncWriter.Shutdown();
+
+        // Finish queued callbacks
+        SetCallbackDispatch(nullptr);
+
         try {
+            // onNew is a static SDK event, so the failure bridge must be unhooked explicitly
+            FailureEventBridge^ failureBridge = _failureBridge;
+            if (failureBridge != nullptr) {
+                failureBridge->Detach();
+                ArmedFailure::onNew -= gcnew ArmedFailureEventDelegate(failureBridge, &FailureEventBridge::OnNew);
+            }
+
             // Unsubscribe from events before disposing
             ProSimConnect^ conn = _connection;
             ConnectionEventBridge^ bridge = _eventBridge;
             if (conn != nullptr && bridge != nullptr) {
                 conn->onConnect -= gcnew ProSimConnect::connectionChangedDelegate(bridge, &ConnectionEventBridge::OnConnect);
                 conn->onDisconnect -= gcnew ProSimConnect::connectionChangedDelegate(bridge, &ConnectionEventBridge::OnDisconnect);
+                conn->onDataRefsUpdated -= gcnew ProSimConnect::connectionChangedDelegate(bridge, &ConnectionEventBridge::OnDataRefsUpdated);
+                conn->onAiTrafficAdded -= gcnew ProSimConnect::aiTrafficAddedDelegate(bridge, &ConnectionEventBridge::OnAiTrafficAdded);
+                conn->onAiTrafficRemoved -= gcnew ProSimConnect::aiTrafficRemovedDelegate(bridge, &ConnectionEventBridge::OnAiTrafficRemoved);
             }
 
             // Dispose the connection (delete invokes IDisposable::Dispose in C++/CLI)
@@ -105,6 +230,86 @@ ProSimConnectWrapper::~ProSimConnectWrapper() {
     }
 }
 
+void ProSimConnectWrapper::ReleaseLiveDataRefs() {
+    // Orphan the application's handles, scanning from the back. The internal inputs of
+    // derived DataRefs are skipped: their derived DataRef destroys them when it is released.
+    // Removal moves the last entry into the gap, so everything at or past `end` is an input.
+    size_t end = SIZE_MAX;
+    for (;;) {
+        DataRefWrapper* next = nullptr;
+        {
+            SharedLock guard(_liveLock);
+            end = (end < _liveRefs.size()) ? end : _liveRefs.size();
+            while (end > 0 && _liveRefs[end - 1]->FeedsDerived()) {
+                --end;
+            }
+            if (end > 0) {
+                next = _liveRefs[end - 1];
+            }
+        }
+        if (!next) {
+            break;
+        }
+        next->Orphan();
+    }
+
+    // Inputs whose derived DataRef is gone are not reachable from the application
+    for (;;) {
+        DataRefWrapper* input = nullptr;
+        {
+            SharedLock guard(_liveLock);
+            if (!_liveRefs.empty()) {
+                input = _liveRefs.back();
+            }
+        }
+        if (!input) {
+            break;
+        }
+        DataRefWrapper::Destroy(input);
+    }
+
+    // Shared DataRefs go with their last view, so none should be left
+    std::vector<SharedDataRef*> leftover;
+    {
+        ExclusiveLock guard(_sharedLock);
+        for (auto it = _sharedRefs.begin(); it != _sharedRefs.end(); ++it) {
+            leftover.push_back(it->second);
+        }
+        _sharedRefs.clear();
+    }
+    for (size_t i = 0; i < leftover.size(); ++i) {
+        ForgetRegistration(leftover[i]);
+        delete leftover[i];
+    }
+
+    // Orphaned handles keep their blocks until DataRef_Destroy; the last one deletes the pool
+    if (_dataRefPool->InUse() == 0) {
+        delete _dataRefPool;
+    }
+    _dataRefPool = nullptr;
+}
+
+void ProSimConnectWrapper::TrackDataRef(DataRefWrapper* wrapper) {
+    ExclusiveLock guard(_liveLock);
+    wrapper->LiveSlot() = static_cast<int32_t>(_liveRefs.size());
+    _liveRefs.push_back(wrapper);
+}
+
+void ProSimConnectWrapper::UntrackDataRef(DataRefWrapper* wrapper) {
+    ExclusiveLock guard(_liveLock);
+    int32_t index = wrapper->LiveSlot();
+    if (index < 0) {
+        return;
+    }
+
+    // Move the last entry into the gap
+    DataRefWrapper* last = _liveRefs.back();
+    _liveRefs[index] = last;
+    last->LiveSlot() = index;
+    _liveRefs.pop_back();
+    wrapper->LiveSlot() = -1;
+}
+
 BridgeResult ProSimConnectWrapper::Connect(const char* host, bool synchronous) {
     try {
         String^ managedHost = gcnew String(host);
@@ -130,127 +335,1967 @@ bool ProSimConnectWrapper::IsConnected() {
     }
 }
 
-void ProSimConnectWrapper::SetPriorityMode(bool priority) {
+void ProSimConnectWrapper::SetPriorityMode(bool priority) {
+    ExclusiveLock guard(_priorityLock);
+    _userPriority = priority;
+    try {
+        _connection->setSDKPriorityMode(_userPriority || _writerPriority);
+    }
+    catch (...) {
+        // Ignore errors
+    }
+}
+
+void ProSimConnectWrapper::SetWriterPriority(bool priority) {
+    ExclusiveLock guard(_priorityLock);
+    _writerPriority = priority;
+    try {
+        _connection->setSDKPriorityMode(_userPriority || _writerPriority);
+    }
+    catch (...) {
+        // Ignore errors
+    }
+}
+
+void ProSimConnectWrapper::SetFanout(FanoutServer* server) {
+    ExclusiveLock guard(_fanoutLock);
+    _fanout = server;
+}
+
+void ProSimConnectWrapper::PublishToFanout(const char* name, const BridgeValue& value) {
+    SharedLock guard(_fanoutLock);
+    if (_fanout) {
+        _fanout->Publish(name, value);
+    }
+}
+
+BridgeResult ProSimConnectWrapper::SetCallbackDispatch(const CallbackDispatchOptions* options) {
+    CallbackDispatcher* dispatcher = nullptr;
+    if (options) {
+        dispatcher = new CallbackDispatcher();
+        BridgeResult result = dispatcher->Start(*options);
+        if (result != BRIDGE_OK) {
+            delete dispatcher;
+            return result;
+        }
+    }
+
+    // The previous pool drains while the lock is held, so no DataRef can start a callback
+    // inline or on the new pool while an earlier one is still queued
+    ExclusiveLock guard(_dispatchLock);
+    delete _dispatcher;
+    _dispatcher = dispatcher;
+    return BRIDGE_OK;
+}
+
+bool ProSimConnectWrapper::DispatchCallback(CallbackDispatcher::Strand& strand) {
+    SharedLock guard(_dispatchLock);
+    if (!_dispatcher) {
+        return false;
+    }
+    _dispatcher->Dispatch(strand);
+    return true;
+}
+
+const Expression* ProSimConnectWrapper::ResolveDerived(const char* name, void* context) {
+    // Called while compiling, with _derivedLock held shared. Only looks the name up: a
+    // derived DataRef's name is already interned, and an expression that fails to compile
+    // must not leave its identifiers in the arena. AddDerived interns the inputs afterwards.
+    ProSimConnectWrapper* self = static_cast<ProSimConnectWrapper*>(context);
+    uint32_t nameId;
+    if (!self->_names.Find(name, &nameId)) {
+        return nullptr;
+    }
+    auto found = self->_derivedByName.find(nameId);
+    return (found != self->_derivedByName.end()) ? &found->second->GetDerived()->expression : nullptr;
+}
+
+BridgeResult ProSimConnectWrapper::CompileDerived(Expression& expression, const char* source) {
+    SharedLock guard(_derivedLock);
+    BridgeResult result = expression.Compile(source, &ProSimConnectWrapper::ResolveDerived, this);
+    if (result != BRIDGE_OK) {
+        std::string message = "Invalid expression: " + expression.Error();
+        ProSim_SetLastError(message.c_str());
+    }
+    return result;
+}
+
+BridgeResult ProSimConnectWrapper::AddDerived(DataRefWrapper* derived, int interval) {
+    ExclusiveLock setupGuard(_derivedSetupLock);
+    DerivedState* state = derived->GetDerived();
+    const Expression& expression = state->expression;
+    size_t count = expression.InputCount();
+
+    if (!state->trigger && _derivedByName.find(derived->GetNameId()) != _derivedByName.end()) {
+        ProSim_SetLastError("A derived DataRef with this name already exists");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    state->inputIds.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!_names.Intern(expression.InputName(i).c_str(), &state->inputIds[i])) {
+            ProSim_SetLastError("Name storage limit reached: the name would exceed max_name_bytes");
+            return BRIDGE_ERR_LIMIT_EXCEEDED;
+        }
+        if (state->inputIds[i] == derived->GetNameId()) {
+            ProSim_SetLastError("A derived DataRef cannot read itself");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+    }
+
+    // Create the inputs no derived DataRef reads yet. Only setup changes the input map, so it
+    // can be read here; the SDK DataRefs are created without _derivedLock because creating one
+    // can raise its first change event.
+    std::vector<DataRefWrapper*> created(count, nullptr);
+    for (size_t i = 0; i < count; ++i) {
+        if (_derivedInputs.find(state->inputIds[i]) != _derivedInputs.end()) {
+            continue;
+        }
+        created[i] = DataRefWrapper::CreateById(state->inputIds[i], interval, this, true);
+        if (!created[i]) {
+            for (size_t j = 0; j < i; ++j) {
+                if (created[j]) {
+                    DataRefWrapper::Destroy(created[j]);
+                }
+            }
+            return BRIDGE_ERR_EXCEPTION;
+        }
+        created[i]->MarkDerivedInput();
+    }
+
+    {
+        ExclusiveLock guard(_derivedLock);
+        state->inputs.assign(count, Double::NaN);
+        state->seen.assign(count, false);
+        state->missing = count;
+        for (size_t i = 0; i < count; ++i) {
+            DerivedInput& input = _derivedInputs[state->inputIds[i]];
+            if (created[i]) {
+                input.wrapper = created[i];
+            }
+            input.readers.push_back(std::make_pair(derived, static_cast<uint32_t>(i)));
+        }
+        if (!state->trigger) {
+            _derivedByName[derived->GetNameId()] = derived;
+        }
+    }
+
+    // Seed with the inputs' current values. Reading after linking means a change raised in
+    // between is either seen here or delivered by OnDerivedInput, which takes precedence.
+    std::vector<double> seeds(count);
+    std::vector<bool> seeded(count, false);
+    for (size_t i = 0; i < count; ++i) {
+        DataRefWrapper* input = _derivedInputs.find(state->inputIds[i])->second.wrapper;
+        seeded[i] = (input->GetDouble(&seeds[i]) == BRIDGE_OK);
+    }
+
+    ExclusiveLock guard(_derivedLock);
+    for (size_t i = 0; i < count; ++i) {
+        if (seeded[i] && !state->seen[i]) {
+            state->inputs[i] = seeds[i];
+            state->seen[i] = true;
+            --state->missing;
+        }
+    }
+    state->Recompute();
+    return BRIDGE_OK;
+}
+
+void ProSimConnectWrapper::RemoveDerived(DataRefWrapper* derived) {
+    DerivedState* state = derived->GetDerived();
+    std::vector<DataRefWrapper*> unused;
+    {
+        ExclusiveLock setupGuard(_derivedSetupLock);
+        ExclusiveLock guard(_derivedLock);
+        auto named = _derivedByName.find(derived->GetNameId());
+        if (named != _derivedByName.end() && named->second == derived) {
+            _derivedByName.erase(named);
+        }
+        for (size_t i = 0; i < _dirtyDerived.size(); ++i) {
+            if (_dirtyDerived[i] == derived) {
+                _dirtyDerived[i] = _dirtyDerived.back();
+                _dirtyDerived.pop_back();
+                break;
+            }
+        }
+
+        // Inputs are linked all at once, so a partly added DataRef has no links at all
+        for (size_t i = 0; i < state->inputIds.size(); ++i) {
+            auto found = _derivedInputs.find(state->inputIds[i]);
+            if (found == _derivedInputs.end()) {
+                continue;
+            }
+            std::vector<std::pair<DataRefWrapper*, uint32_t>>& readers = found->second.readers;
+            for (size_t r = 0; r < readers.size(); ) {
+                if (readers[r].first == derived) {
+                    readers[r] = readers.back();
+                    readers.pop_back();
+                }
+                else {
+                    ++r;
+                }
+            }
+            if (readers.empty()) {
+                unused.push_back(found->second.wrapper);
+                _derivedInputs.erase(found);
+            }
+        }
+    }
+
+    // Unlinked, so no later evaluation can queue it; wait out a notification in progress
+    if (_derivedNotifyThread == GetCurrentThreadId()) {
+        // Destroyed from a change callback raised by our own notification pass
+        for (size_t i = 0; i < _notifyingDerived.size(); ++i) {
+            if (_notifyingDerived[i] == derived) {
+                _notifyingDerived[i] = nullptr;
+            }
+        }
+    }
+    else {
+        ExclusiveLock notifyGuard(_derivedNotifyLock);
+    }
+
+    for (size_t i = 0; i < unused.size(); ++i) {
+        DataRefWrapper::Destroy(unused[i]);
+    }
+}
+
+void ProSimConnectWrapper::OnDerivedInput(uint32_t nameId, double value) {
+    ExclusiveLock guard(_derivedLock);
+    auto found = _derivedInputs.find(nameId);
+    if (found == _derivedInputs.end()) {
+        return;
+    }
+    std::vector<std::pair<DataRefWrapper*, uint32_t>>& readers = found->second.readers;
+    for (size_t i = 0; i < readers.size(); ++i) {
+        DataRefWrapper* derived = readers[i].first;
+        DerivedState* state = derived->GetDerived();
+        uint32_t index = readers[i].second;
+        if (!state->seen[index]) {
+            state->seen[index] = true;
+            --state->missing;
+        }
+        state->inputs[index] = value;
+        if (!state->dirty) {
+            state->dirty = true;
+            _dirtyDerived.push_back(derived);
+        }
+    }
+}
+
+void ProSimConnectWrapper::EvaluateDerived() {
+    ExclusiveLock notifyGuard(_derivedNotifyLock);
+    {
+        // Each dirty DataRef is evaluated once however many of its inputs changed
+        ExclusiveLock guard(_derivedLock);
+        for (size_t i = 0; i < _dirtyDerived.size(); ++i) {
+            DataRefWrapper* derived = _dirtyDerived[i];
+            DerivedState* state = derived->GetDerived();
+            state->dirty = false;
+            if (!state->Recompute()) {
+                continue;
+            }
+            if (!state->trigger) {
+                _notifyingDerived.push_back(derived);
+            }
+            else if (!state->trigger->pending) {
+                state->trigger->pending = true;
+                _pendingTriggers.push_back(state->trigger);
+            }
+        }
+        _dirtyDerived.clear();
+    }
+    CheckTriggers();
+    if (_notifyingDerived.empty() && _firingTriggers.empty()) {
+        return;
+    }
+
+    _derivedNotifyThread = GetCurrentThreadId();
+    for (size_t i = 0; i < _notifyingDerived.size(); ++i) {
+        if (_notifyingDerived[i]) {
+            ChangeSample sample;
+            _notifyingDerived[i]->FireOnDataChange(sample);
+        }
+    }
+    for (size_t i = 0; i < _firingTriggers.size(); ++i) {
+        Trigger* trigger = _firingTriggers[i].first;
+        if (trigger && trigger->callback) {
+            trigger->callback(trigger, _firingTriggers[i].second, trigger->userData);
+        }
+    }
+    _derivedNotifyThread = 0;
+    _notifyingDerived.clear();
+    _firingTriggers.clear();
+}
+
+void ProSimConnectWrapper::CheckTriggers() {
+    // Called from EvaluateDerived with _derivedNotifyLock held
+    if (_pendingTriggers.empty()) {
+        return;
+    }
+
+    double now = MonotonicClock::Now();
+    size_t kept = 0;
+    for (size_t i = 0; i < _pendingTriggers.size(); ++i) {
+        Trigger* trigger = _pendingTriggers[i];
+        if (!trigger->condition) {
+            // Still being created (it queues itself when done) or being destroyed
+            trigger->pending = false;
+            continue;
+        }
+
+        bool set = trigger->condition->GetDerived()->IsTrue();
+        bool clear = trigger->release ? trigger->release->GetDerived()->IsTrue() : !set;
+        bool changed = trigger->state.Update(set, clear, now);
+        if (changed) {
+            InterlockedExchange(&trigger->active, trigger->state.IsActive() ? 1 : 0);
+            _firingTriggers.push_back(std::make_pair(trigger, trigger->state.IsActive()));
+        }
+
+        // After a transition, look once more in case the opposite input already holds
+        if (changed || trigger->state.IsHolding()) {
+            _pendingTriggers[kept++] = trigger;
+        }
+        else {
+            trigger->pending = false;
+        }
+    }
+    _pendingTriggers.resize(kept);
+}
+
+Trigger* ProSimConnectWrapper::CreateTrigger(const TriggerOptions& options, TriggerCallback callback, void* userData) {
+    if (!options.condition) {
+        ProSim_SetLastError("Null trigger condition");
+        return nullptr;
+    }
+    if (options.on_delay_ms < 0 || options.off_delay_ms < 0) {
+        ProSim_SetLastError("Trigger delays must not be negative");
+        return nullptr;
+    }
+
+    // The expressions are derived DataRefs that are never registered under this name,
+    // which cannot appear in an expression
+    static const char* const ExpressionName = "$trigger";
+    Trigger* trigger = new Trigger(this, options, callback, userData);
+    DataRefWrapper* condition = DataRefWrapper::CreateDerived(ExpressionName, options.condition,
+                                                              options.interval, this, trigger);
+    DataRefWrapper* release = nullptr;
+    if (condition && options.release) {
+        release = DataRefWrapper::CreateDerived(ExpressionName, options.release, options.interval, this, trigger);
+    }
+    bool created = condition && (release || !options.release);
+
+    {
+        // Publish the expressions to CheckTriggers and take the initial state in the next pass
+        bool notifying = (_derivedNotifyThread == GetCurrentThreadId());
+        if (!notifying) {
+            _derivedNotifyLock.LockExclusive();
+        }
+        trigger->condition = condition;
+        trigger->release = release;
+        if (created && !trigger->pending) {
+            trigger->pending = true;
+            _pendingTriggers.push_back(trigger);
+        }
+        if (!notifying) {
+            _derivedNotifyLock.UnlockExclusive();
+        }
+    }
+
+    if (!created) {
+        DestroyTrigger(trigger);
+        return nullptr;
+    }
+    return trigger;
+}
+
+void ProSimConnectWrapper::DestroyTrigger(Trigger* trigger) {
+    // Destroying a trigger from a callback raised by our own pass must not wait for the pass
+    bool notifying = (_derivedNotifyThread == GetCurrentThreadId());
+
+    // Hide the expressions from CheckTriggers before they are freed; a pass may still queue
+    // the trigger until they are unlinked, so it stays allocated until then
+    DataRefWrapper* condition;
+    DataRefWrapper* release;
+    if (!notifying) {
+        _derivedNotifyLock.LockExclusive();
+    }
+    condition = trigger->condition;
+    release = trigger->release;
+    trigger->condition = nullptr;
+    trigger->release = nullptr;
+    if (!notifying) {
+        _derivedNotifyLock.UnlockExclusive();
+    }
+
+    if (condition) {
+        DataRefWrapper::Destroy(condition);
+    }
+    if (release) {
+        DataRefWrapper::Destroy(release);
+    }
+
+    if (!notifying) {
+        _derivedNotifyLock.LockExclusive();
+    }
+    for (size_t i = 0; i < _pendingTriggers.size(); ++i) {
+        if (_pendingTriggers[i] == trigger) {
+            _pendingTriggers.erase(_pendingTriggers.begin() + i);
+            break;
+        }
+    }
+    for (size_t i = 0; i < _firingTriggers.size(); ++i) {
+        if (_firingTriggers[i].first == trigger) {
+            _firingTriggers[i].first = nullptr;
+        }
+    }
+    if (!notifying) {
+        _derivedNotifyLock.UnlockExclusive();
+    }
+    delete trigger;
+}
+
+SharedDataRef* ProSimConnectWrapper::AcquireShared(DataRefWrapper* view, const char* name, uint32_t nameId,
+                                                   int interval, bool registerNow) {
+    SharedDataRef* shared;
+    bool created = false;
+    {
+        ExclusiveLock guard(_sharedLock);
+        auto found = _sharedRefs.find(nameId);
+        if (found != _sharedRefs.end()) {
+            shared = found->second;
+        }
+        else {
+            shared = new SharedDataRef(this, name, nameId, interval);
+            _sharedRefs.emplace(nameId, shared);
+            created = true;
+        }
+        ++shared->refs;
+    }
+    shared->AddView(view);
+    if (created && shared->registration.adaptive) {
+        TrackAdaptive(shared);
+    }
+
+    ExclusiveLock guard(_registrationLock);
+    RegistrationState& state = shared->registration;
+    state.requested.push_back(interval);
+    if (!state.adaptive && interval < state.interval) {
+        // Every view of the name sees the faster updates once the replacement registration
+        // delivers its first value
+        shared->ApplyInterval(interval);
+    }
+    if (registerNow && !state.lazy) {
+        RegisterLocked(shared);
+    }
+    return shared;
+}
+
+void ProSimConnectWrapper::ReleaseShared(SharedDataRef* shared, DataRefWrapper* view, int32_t interval) {
+    shared->RemoveView(view);
+    {
+        // The view's reference keeps the DataRef alive until refs is decremented below
+        ExclusiveLock guard(_registrationLock);
+        RegistrationState& state = shared->registration;
+        std::vector<int32_t>& requested = state.requested;
+        for (size_t i = 0; i < requested.size(); ++i) {
+            if (requested[i] == interval) {
+                requested[i] = requested.back();
+                requested.pop_back();
+                break;
+            }
+        }
+        if (!state.adaptive && !requested.empty()) {
+            int32_t fastest = requested[0];
+            for (size_t i = 1; i < requested.size(); ++i) {
+                fastest = (requested[i] < fastest) ? requested[i] : fastest;
+            }
+            if (fastest > state.interval) {
+                // The fastest view is gone; poll only as often as the remaining ones ask
+                shared->ApplyInterval(fastest);
+            }
+        }
+    }
+
+    {
+        ExclusiveLock guard(_sharedLock);
+        if (--shared->refs != 0) {
+            return;
+        }
+        _sharedRefs.erase(shared->nameId);
+    }
+
+    ForgetRegistration(shared);
+    if (shared->notifyThread == GetCurrentThreadId()) {
+        // Released from a callback of this DataRef's own fan-out, which deletes it when done
+        shared->retired = true;
+        return;
+    }
+    delete shared;
+}
+
+BridgeResult ProSimConnectWrapper::SetLazyRegistration(bool enabled, int32_t idleTtlMs) {
+    if (idleTtlMs < 0) {
+        ProSim_SetLastError("Idle TTL must not be negative");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    ExclusiveLock guard(_sweeperLock);
+    InterlockedExchange(&_lazyRegistration, enabled ? 1 : 0);
+    InterlockedExchange(&_idleTtlMs, enabled ? idleTtlMs : 0);
+
+    bool sweep = enabled && idleTtlMs > 0;
+    if (sweep && !_idleSweeper.IsRunning()) {
+        if (!_idleSweeper.Start(&ProSimConnectWrapper::SweeperMain, this)) {
+            ProSim_SetLastError("Failed to start idle DataRef sweeper thread");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+    else if (!sweep && _idleSweeper.IsRunning()) {
+        _idleSweeper.Stop();
+    }
+    return BRIDGE_OK;
+}
+
+void ProSimConnectWrapper::SweeperMain(NativeThread* thread, void* context) {
+    ProSimConnectWrapper* self = static_cast<ProSimConnectWrapper*>(context);
+    for (;;) {
+        // A quarter of the TTL keeps unregistration within 25% of it
+        DWORD waitMs = static_cast<DWORD>(self->_idleTtlMs) / 4;
+        waitMs = (waitMs < 10) ? 10 : (waitMs > 1000) ? 1000 : waitMs;
+        if (thread->WaitForStop(waitMs)) {
+            return;
+        }
+        self->UnregisterIdle();
+    }
+}
+
+BridgeResult ProSimConnectWrapper::RegisterLocked(SharedDataRef* ref) {
+    RegistrationState& state = ref->registration;
+    if (state.registered) {
+        return BRIDGE_OK;
+    }
+    BridgeResult result = ref->ApplyRegistration(true);
+    if (result == BRIDGE_OK && state.lazy) {
+        state.slot = static_cast<int32_t>(_lazyRegistered.size());
+        _lazyRegistered.push_back(ref);
+    }
+    return result;
+}
+
+BridgeResult ProSimConnectWrapper::EnsureRegistered(SharedDataRef* ref) {
+    ExclusiveLock guard(_registrationLock);
+    return RegisterLocked(ref);
+}
+
+void ProSimConnectWrapper::SetRegistrationPin(SharedDataRef* ref, uint32_t* pins, uint32_t pin, bool pinned) {
+    RegistrationState& state = ref->registration;
+    if (!state.lazy) {
+        return;
+    }
+
+    ExclusiveLock guard(_registrationLock);
+    uint32_t previous = *pins;
+    *pins = pinned ? (previous | pin) : (previous & ~pin);
+    if (previous == 0 && *pins != 0) {
+        ++state.pinnedViews;
+    }
+    else if (previous != 0 && *pins == 0) {
+        --state.pinnedViews;
+    }
+    if (pinned) {
+        RegisterLocked(ref);
+    }
+}
+
+void ProSimConnectWrapper::ForgetRegistration(SharedDataRef* ref) {
+    RegistrationState& state = ref->registration;
+    if (!state.lazy && !state.adaptive) {
+        return;
+    }
+
+    ExclusiveLock guard(_registrationLock);
+    if (state.slot >= 0) {
+        SharedDataRef* moved = _lazyRegistered.back();
+        _lazyRegistered[state.slot] = moved;
+        moved->registration.slot = state.slot;
+        _lazyRegistered.pop_back();
+        state.slot = -1;
+    }
+    if (state.adaptiveSlot >= 0) {
+        SharedDataRef* moved = _adaptiveRefs.back();
+        _adaptiveRefs[state.adaptiveSlot] = moved;
+        moved->registration.adaptiveSlot = state.adaptiveSlot;
+        _adaptiveRefs.pop_back();
+        state.adaptiveSlot = -1;
+    }
+}
+
+void ProSimConnectWrapper::UnregisterIdle() {
+    DWORD ttl = static_cast<DWORD>(_idleTtlMs);
+    if (ttl == 0) {
+        return;
+    }
+
+    DWORD now = GetTickCount();
+    ExclusiveLock guard(_registrationLock);
+    for (size_t i = _lazyRegistered.size(); i > 0; --i) {
+        SharedDataRef* ref = _lazyRegistered[i - 1];
+        RegistrationState& state = ref->registration;
+
+        // Unsigned difference, so GetTickCount wrapping around is harmless
+        if (state.pinnedViews != 0 || now - state.lastUse < ttl) {
+            continue;
+        }
+        ref->ApplyRegistration(false);
+
+        SharedDataRef* moved = _lazyRegistered.back();
+        _lazyRegistered[i - 1] = moved;
+        moved->registration.slot = static_cast<int32_t>(i - 1);
+        _lazyRegistered.pop_back();
+        state.slot = -1;
+    }
+}
+
+BridgeResult ProSimConnectWrapper::SetAdaptiveIntervals(const AdaptiveIntervalOptions* options) {
+    if (options && (options->min_interval_ms <= 0 || options->max_interval_ms < options->min_interval_ms ||
+                    options->window_ms < 0)) {
+        ProSim_SetLastError("Invalid adaptive interval bounds");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    ExclusiveLock guard(_sweeperLock);
+    if (!options) {
+        InterlockedExchange(&_adaptiveIntervals, 0);
+        _intervalTuner.Stop();
+        return BRIDGE_OK;
+    }
+
+    // A window must span several polls at the slowest interval to measure anything
+    LONG64 window = options->window_ms;
+    if (window == 0) {
+        window = 4LL * options->max_interval_ms;
+        window = (window < 2000) ? 2000 : (window > MAXLONG) ? MAXLONG : window;
+    }
+    InterlockedExchange(&_minIntervalMs, options->min_interval_ms);
+    InterlockedExchange(&_maxIntervalMs, options->max_interval_ms);
+    InterlockedExchange(&_reviewWindowMs, static_cast<LONG>(window));
+    InterlockedExchange(&_adaptiveIntervals, 1);
+
+    if (!_intervalTuner.IsRunning() && !_intervalTuner.Start(&ProSimConnectWrapper::TunerMain, this)) {
+        InterlockedExchange(&_adaptiveIntervals, 0);
+        ProSim_SetLastError("Failed to start interval tuner thread");
+        return BRIDGE_ERR_EXCEPTION;
+    }
+    return BRIDGE_OK;
+}
+
+int32_t ProSimConnectWrapper::ClampInterval(int32_t interval) const {
+    int32_t minInterval = _minIntervalMs;
+    int32_t maxInterval = _maxIntervalMs;
+    return (interval < minInterval) ? minInterval : (interval > maxInterval) ? maxInterval : interval;
+}
+
+void ProSimConnectWrapper::TrackAdaptive(SharedDataRef* ref) {
+    ExclusiveLock guard(_registrationLock);
+    ref->registration.adaptiveSlot = static_cast<int32_t>(_adaptiveRefs.size());
+    _adaptiveRefs.push_back(ref);
+}
+
+void ProSimConnectWrapper::TunerMain(NativeThread* thread, void* context) {
+    ProSimConnectWrapper* self = static_cast<ProSimConnectWrapper*>(context);
+    DWORD last = GetTickCount();
+    while (!thread->WaitForStop(static_cast<DWORD>(self->_reviewWindowMs))) {
+        DWORD now = GetTickCount();
+        self->ReviewIntervals(now - last);
+        last = now;
+    }
+}
+
+void ProSimConnectWrapper::ReviewIntervals(DWORD elapsedMs) {
+    if (elapsedMs == 0) {
+        return;
+    }
+
+    ExclusiveLock guard(_registrationLock);
+    for (size_t i = 0; i < _adaptiveRefs.size(); ++i) {
+        SharedDataRef* ref = _adaptiveRefs[i];
+        RegistrationState& state = ref->registration;
+        LONG version = ref->changeVersion;
+        LONG changes = version - state.reviewedVersion;
+        LONG uses = InterlockedExchange(&state.uses, 0);
+        state.reviewedVersion = version;
+        if (!state.registered) {
+            // A lazy DataRef that is not registered was not polled
+            continue;
+        }
+
+        // Shares of the window's polls that brought a change and that were read. The 4x gap
+        // between the thresholds exceeds one step, so an interval does not flip back and forth.
+        double polls = static_cast<double>(elapsedMs) / state.interval;
+        double changeShare = changes / polls;
+        double useShare = ref->consumed ? 1.0 : uses / polls;
+
+        int32_t interval = state.interval;
+        if (changeShare >= 0.5 && useShare >= 0.5) {
+            interval /= 2;
+        }
+        else if (changeShare < 0.125 || useShare < 0.125) {
+            interval = (interval > MAXLONG / 2) ? MAXLONG : interval * 2;
+        }
+        interval = ClampInterval(interval);
+        if (interval != state.interval) {
+            ref->ApplyInterval(interval);
+        }
+    }
+}
+
+void ProSimConnectWrapper::GetMemoryStats(MemoryStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->wrapper_bytes = _dataRefPool->Bytes();
+    {
+        SharedLock guard(_sharedLock);
+        stats->wrapper_bytes += _sharedRefs.size() * sizeof(SharedDataRef);
+    }
+    stats->name_bytes = _names.ReservedBytes();
+    stats->cache_bytes = static_cast<uint64_t>(InterlockedCompareExchange64(&_cacheBytes, 0, 0)) +
+                         _traffic.MemoryBytes() + _failures.MemoryBytes();
+    stats->history_bytes = static_cast<uint64_t>(InterlockedCompareExchange64(&_historyBytes, 0, 0));
+
+    uint64_t changeBytes;
+    {
+        // The delivery arrays swap with these every cycle, so count the lists twice
+        SharedLock guard(_changedLock);
+        changeBytes = 2 * (_changedRefs.capacity() * sizeof(DataRefHandle) + _changedValues.capacity() * sizeof(double)) +
+                      _changedSlots.capacity() * sizeof(int32_t*);
+    }
+    stats->queue_bytes = _writeBuffer.MemoryBytes() + _asyncWriter.MemoryBytes() + changeBytes;
+
+    stats->datarefs = static_cast<int32_t>(_dataRefPool->InUse());
+    stats->names = static_cast<int32_t>(_names.Count());
+    stats->pending_writes = static_cast<int32_t>(_writeBuffer.PendingCount() + _asyncWriter.PendingCount());
+
+    stats->managed_heap_bytes = static_cast<uint64_t>(GC::GetTotalMemory(false));
+    stats->gen0_collections = GC::CollectionCount(0);
+    stats->gen1_collections = GC::CollectionCount(1);
+    stats->gen2_collections = GC::CollectionCount(2);
+}
+
+BridgeResult ProSimConnectWrapper::SetMemoryLimits(const MemoryLimits* limits) {
+    // Byte limits past INT64_MAX are negative values passed through the unsigned fields;
+    // cast to size_t they would silently mean "unlimited" or wrap
+    const uint64_t MaxBytes = static_cast<uint64_t>(MAXLONG64);
+    if (limits && (limits->max_datarefs < 0 || limits->max_name_bytes > MaxBytes ||
+                   limits->max_history_bytes > MaxBytes)) {
+        ProSim_SetLastError("Memory limits must not be negative");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    _dataRefPool->SetLimit(limits ? static_cast<size_t>(limits->max_datarefs) : 0);
+    _names.SetLimit(limits ? static_cast<size_t>(limits->max_name_bytes < SIZE_MAX ? limits->max_name_bytes : SIZE_MAX) : 0);
+    InterlockedExchange64(&_historyLimit, limits ? static_cast<LONG64>(limits->max_history_bytes) : 0);
+    return BRIDGE_OK;
+}
+
+bool ProSimConnectWrapper::ReserveHistoryBytes(LONG64 bytes) {
+    LONG64 limit = InterlockedCompareExchange64(&_historyLimit, 0, 0);
+    for (;;) {
+        LONG64 current = InterlockedCompareExchange64(&_historyBytes, 0, 0);
+        LONG64 next = current + bytes;
+        if (bytes > 0 && limit != 0 && next > limit) {
+            return false;
+        }
+        if (InterlockedCompareExchange64(&_historyBytes, next, current) == current) {
+            return true;
+        }
+    }
+}
+
+bool ProSimConnectWrapper::LoadDescriptions() {
+    if (static_cast<Dictionary<String^, DataRefDescription^>^>(_descriptions) != nullptr) {
+        return true;
+    }
+    if (!IsConnected()) {
+        return false;
+    }
+
+    try {
+        auto descriptions = gcnew Dictionary<String^, DataRefDescription^>(StringComparer::Ordinal);
+        for each (DataRefDescription^ description in _connection->getDataRefDescriptions()) {
+            if (description != nullptr && description->Name != nullptr) {
+                descriptions[description->Name] = description;
+            }
+        }
+        _descriptions = descriptions;
+        return true;
+    }
+    catch (Exception^) {
+        // Catalog unavailable: cache an empty one so types are learned from values instead
+        _descriptions = gcnew Dictionary<String^, DataRefDescription^>(StringComparer::Ordinal);
+        return true;
+    }
+}
+
+// Encodes a managed string as UTF-8 into scratch (not terminated); returns the byte count
+static size_t EncodeUtf8(String^ value, std::vector<char>& scratch) {
+    if (value == nullptr || value->Length == 0) {
+        return 0;
+    }
+    int byteCount = Encoding::UTF8->GetByteCount(value);
+    if (scratch.size() < static_cast<size_t>(byteCount)) {
+        scratch.resize(static_cast<size_t>(byteCount));
+    }
+    pin_ptr<const wchar_t> chars = PtrToStringChars(value);
+    Encoding::UTF8->GetBytes(const_cast<wchar_t*>(chars), value->Length,
+                             reinterpret_cast<unsigned char*>(scratch.data()), byteCount);
+    return static_cast<size_t>(byteCount);
+}
+
+static uint32_t StageFailureString(FailureCatalog& catalog, String^ value, std::vector<char>& scratch) {
+    size_t length = EncodeUtf8(value, scratch);
+    return catalog.StageString(scratch.data(), length);
+}
+
+BridgeResult ProSimConnectWrapper::LoadFailureCatalog() {
+    ExclusiveLock loadGuard(_failureLoadLock);
+    if (!IsConnected()) {
+        ProSim_SetLastError("Not connected");
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+
+    try {
+        // Start tracking armed failures before reading the catalog so none are missed
+        FailureEventBridge^ bridge = _failureBridge;
+        bool firstLoad = (bridge == nullptr);
+        if (firstLoad) {
+            bridge = gcnew FailureEventBridge(this);
+            _failureBridge = bridge;
+            ArmedFailure::onNew += gcnew ArmedFailureEventDelegate(bridge, &FailureEventBridge::OnNew);
+        }
+
+        List<Failure^>^ failures = gcnew List<Failure^>(_connection->getFailures());
+        std::vector<char> scratch(256);
+        _failures.BeginLoad(static_cast<size_t>(failures->Count));
+        for each (Failure^ failure in failures) {
+            if (failure == nullptr) {
+                continue;
+            }
+            FailureRecord record;
+            record.id_offset = StageFailureString(_failures, failure->id, scratch);
+            record.name_offset = StageFailureString(_failures, failure->name, scratch);
+            record.description_offset = StageFailureString(_failures, failure->description, scratch);
+            record.domain_offset = StageFailureString(_failures, failure->domain, scratch);
+            record.group_offset = StageFailureString(_failures, failure->groupName, scratch);
+            record.group_member_offset = StageFailureString(_failures, failure->groupMember, scratch);
+            record.failure_class = static_cast<int32_t>(failure->failureClass);
+            record.armed_state = FAILURE_STATE_NONE;
+            record.armed_id = -1;
+            _failures.StageRecord(record);
+        }
+        _failures.CommitLoad();
+
+        // Failures armed before the first load have no onNew event to replay
+        if (firstLoad) {
+            for each (ArmedFailure^ armed in _connection->getArmedFailures()) {
+                if (armed != nullptr && armed->isAlive) {
+                    bridge->Track(armed);
+                }
+            }
+        }
+        else {
+            for each (ArmedFailure^ armed in _connection->getArmedFailures()) {
+                if (armed != nullptr && armed->isAlive) {
+                    ApplyArmedFailure(armed, armed->isActive ? FAILURE_STATE_TRIGGERED : FAILURE_STATE_ARMED);
+                }
+            }
+        }
+        return BRIDGE_OK;
+    }
+    catch (NotConnectedException^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+    catch (Exception^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_EXCEPTION;
+    }
+}
+
+void ProSimConnectWrapper::ApplyArmedFailure(ArmedFailure^ armed, int32_t state) {
+    if (armed->failures == nullptr) {
+        return;
+    }
+    std::vector<char> scratch(64);
+    for each (Failure^ failure in armed->failures) {
+        if (failure == nullptr) {
+            continue;
+        }
+        size_t length = EncodeUtf8(failure->id, scratch);
+        _failures.SetArmedState(std::string(scratch.data(), length), state, armed->id);
+    }
+}
+
+static FailureCondition^ BuildFailureCondition(const FailureScenario::Arm& arm) {
+    FailureCondition^ condition = gcnew FailureCondition();
+    if (arm.hasAltitude) {
+        condition->altitudeThreshold = arm.altitudeAbove ? FailureCondition::ThresholdTypeEnum::Above
+                                                         : FailureCondition::ThresholdTypeEnum::Below;
+        condition->altitude = Nullable<int>(arm.altitude);
+    }
+    if (arm.hasSpeed) {
+        condition->speed = Nullable<int>(arm.speed);
+    }
+    if (arm.afterEvent != FailureScenario::EventNone) {
+        condition->afterEvent = Nullable<FailureCondition::EventTypeEnum>(
+            static_cast<FailureCondition::EventTypeEnum>(arm.afterEvent));
+        condition->afterEventTimer = Nullable<TimeSpan>(TimeSpan::FromSeconds(arm.afterEventSeconds));
+    }
+    if (arm.hasDelay) {
+        // setSeconds turns the relative delay into the condition's trigger time
+        condition->seconds = Nullable<int>(arm.delaySeconds);
+        condition->setSeconds();
+    }
+    return condition;
+}
+
+BridgeResult ProSimConnectWrapper::ArmFailureScenario(const FailureScenario& scenario, FailureScenarioResult* result) {
+    if (!IsConnected()) {
+        ProSim_SetLastError("Not connected");
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+
+    try {
+        // Resolve every failure id before arming anything, so a bad scenario arms nothing
+        double resolveStart = MonotonicClock::Now();
+        auto failuresById = gcnew Dictionary<String^, Failure^>(StringComparer::Ordinal);
+        for each (Failure^ failure in _connection->getFailures()) {
+            if (failure != nullptr && failure->id != nullptr) {
+                failuresById[failure->id] = failure;
+            }
+        }
+
+        const std::vector<FailureScenario::Arm>& arms = scenario.Arms();
+        const std::vector<std::string>& ids = scenario.FailureIds();
+        auto resolved = gcnew array<array<Failure^>^>(static_cast<int>(arms.size()));
+        for (size_t a = 0; a < arms.size(); ++a) {
+            const FailureScenario::Arm& arm = arms[a];
+            auto failures = gcnew array<Failure^>(static_cast<int>(arm.failureCount));
+            for (uint32_t f = 0; f < arm.failureCount; ++f) {
+                const std::string& id = ids[arm.firstFailure + f];
+                String^ managedId = gcnew String(reinterpret_cast<signed char*>(const_cast<char*>(id.c_str())), 0,
+                                                 static_cast<int>(id.size()), Encoding::UTF8);
+                Failure^ failure = nullptr;
+                if (!failuresById->TryGetValue(managedId, failure)) {
+                    char message[256];
+                    sprintf_s(message, sizeof(message), "line %d: unknown failure '%s'", arm.line, id.c_str());
+                    ProSim_SetLastError(message);
+                    return BRIDGE_ERR_INVALID_ARGUMENT;
+                }
+                failures[static_cast<int>(f)] = failure;
+            }
+            resolved[static_cast<int>(a)] = failures;
+        }
+        result->resolve_ms = (MonotonicClock::Now() - resolveStart) * 1000.0;
+
+        // Arm everything in one pass
+        double pushStart = MonotonicClock::Now();
+        for (size_t a = 0; a < arms.size(); ++a) {
+            const FailureScenario::Arm& arm = arms[a];
+            bool unconditional = !arm.hasAltitude && !arm.hasSpeed && !arm.hasDelay &&
+                                 arm.afterEvent == FailureScenario::EventNone;
+            if (unconditional) {
+                ArmedFailure::Create(resolved[static_cast<int>(a)]);
+            }
+            else {
+                ArmedFailure::Create(BuildFailureCondition(arm), resolved[static_cast<int>(a)]);
+            }
+            result->armed_failures++;
+            result->failures += static_cast<int32_t>(arm.failureCount);
+        }
+        result->push_ms = (MonotonicClock::Now() - pushStart) * 1000.0;
+        return BRIDGE_OK;
+    }
+    catch (NotConnectedException^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+    catch (Exception^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_EXCEPTION;
+    }
+}
+
+// Converts a value read from the SDK into a snapshot value; returns false for values a
+// snapshot does not hold (null, DateTime, reposition data and other objects)
+static bool ToSnapshotValue(Object^ value, BridgeValue* out, std::vector<char>& scratch) {
+    if (value == nullptr) {
+        return false;
+    }
+    switch (Type::GetTypeCode(value->GetType())) {
+    case TypeCode::Boolean:
+        *out = BridgeValue::FromBool(safe_cast<bool>(value));
+        return true;
+    case TypeCode::Int32:
+        *out = BridgeValue::FromInt(safe_cast<int>(value));
+        return true;
+    case TypeCode::String: {
+        size_t length = EncodeUtf8(safe_cast<String^>(value), scratch);
+        out->type = DATAREF_TYPE_STRING;
+        out->stringValue.assign(scratch.data(), length);
+        return true;
+    }
+    case TypeCode::Double:
+    case TypeCode::Single:
+    case TypeCode::Int64:
+    case TypeCode::Int16:
+    case TypeCode::UInt16:
+    case TypeCode::UInt32:
+    case TypeCode::UInt64:
+    case TypeCode::Byte:
+    case TypeCode::SByte:
+    case TypeCode::Decimal:
+        *out = BridgeValue::FromDouble(Convert::ToDouble(value));
+        return true;
+    default:
+        return false;
+    }
+}
+
+BridgeResult ProSimConnectWrapper::CaptureSnapshot(SimSnapshot& snapshot) {
+    if (!IsConnected() || !LoadDescriptions()) {
+        ProSim_SetLastError("Not connected");
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+
+    try {
+        std::vector<char> scratch;
+        std::vector<char> nameScratch;
+        Dictionary<String^, DataRefDescription^>^ descriptions = _descriptions;
+        for each (KeyValuePair<String^, DataRefDescription^> pair in descriptions) {
+            DataRefDescription^ description = pair.Value;
+            if (!description->CanRead || !description->CanWrite) {
+                continue;
+            }
+
+            BridgeValue value;
+            try {
+                if (!ToSnapshotValue(_connection->ReadDataRef(pair.Key), &value, scratch)) {
+                    continue;
+                }
+            }
+            catch (NotConnectedException^) {
+                throw;
+            }
+            catch (Exception^) {
+                // Not available in the current aircraft state; left out of the snapshot
+                continue;
+            }
+            size_t nameLength = EncodeUtf8(pair.Key, nameScratch);
+            snapshot.Add(nameScratch.data(), nameLength, value);
+        }
+        return BRIDGE_OK;
+    }
+    catch (NotConnectedException^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+    catch (Exception^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_EXCEPTION;
+    }
+}
+
+BridgeResult ProSimConnectWrapper::RestoreSnapshot(const SimSnapshot& snapshot, SnapshotRestoreResult* result) {
+    const std::vector<SimSnapshot::Entry>& entries = snapshot.Entries();
+    result->entries = static_cast<int32_t>(entries.size());
+    if (!IsConnected()) {
+        ProSim_SetLastError("Not connected");
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+
+    // Read the current values first, so only the entries that differ are written
+    double readStart = MonotonicClock::Now();
+    std::vector<const SimSnapshot::Entry*> changed;
+    try {
+        std::vector<char> scratch;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const SimSnapshot::Entry& entry = entries[i];
+            String^ name = gcnew String(reinterpret_cast<signed char*>(const_cast<char*>(entry.name.c_str())), 0,
+                                        static_cast<int>(entry.name.size()), Encoding::UTF8);
+            BridgeValue current;
+            bool known = false;
+            try {
+                known = ToSnapshotValue(_connection->ReadDataRef(name), &current, scratch);
+            }
+            catch (NotConnectedException^) {
+                throw;
+            }
+            catch (Exception^) {
+                // Unreadable now; write it regardless
+            }
+            if (known && SimSnapshot::SameValue(current, entry.value)) {
+                result->unchanged++;
+            }
+            else {
+                changed.push_back(&entry);
+            }
+        }
+    }
+    catch (NotConnectedException^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+    catch (Exception^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_EXCEPTION;
+    }
+    result->read_ms = (MonotonicClock::Now() - readStart) * 1000.0;
+
+    return WriteSnapshotValues(changed, result);
+}
+
+BridgeResult ProSimConnectWrapper::ApplySnapshotDiff(const SnapshotDiff& diff, SnapshotRestoreResult* result) {
+    // The diff already says what differs, so nothing is read; removed names have no value
+    const std::vector<SnapshotDiff::Entry>& entries = diff.Entries();
+    std::vector<SimSnapshot::Entry> values;
+    values.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].kind != SNAPSHOT_DIFF_REMOVED) {
+            values.push_back(SimSnapshot::Entry());
+            values.back().name = entries[i].name;
+            values.back().value = entries[i].after;
+        }
+    }
+    result->entries = static_cast<int32_t>(values.size());
+    if (!IsConnected()) {
+        ProSim_SetLastError("Not connected");
+        return BRIDGE_ERR_NOT_CONNECTED;
+    }
+
+    std::vector<const SimSnapshot::Entry*> targets(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        targets[i] = &values[i];
+    }
+    return WriteSnapshotValues(targets, result);
+}
+
+BridgeResult ProSimConnectWrapper::WriteSnapshotValues(const std::vector<const SimSnapshot::Entry*>& values,
+                                                       SnapshotRestoreResult* result) {
+    // Open every target before writing so the writes go out back to back. Handles share
+    // the DataRefs this connection already has for those names; the others are opened
+    // without registering, since the SDK writes through an unregistered DataRef and a
+    // Register/unRegister pair per value would cost more than the write. The slowest
+    // interval keeps a shared DataRef from being re-created at a faster one.
+    static const int TargetInterval = MAXLONG;
+    double writeStart = MonotonicClock::Now();
+    std::vector<DataRefWrapper*> targets(values.size(), nullptr);
+    for (size_t i = 0; i < values.size(); ++i) {
+        try {
+            targets[i] = DataRefWrapper::Create(values[i]->name.c_str(), TargetInterval, this, false);
+        }
+        catch (Exception^ ex) {
+            StoreExceptionMessage(ex);
+        }
+    }
+
+    BridgeResult status = BRIDGE_OK;
+    for (size_t i = 0; i < values.size(); ++i) {
+        BridgeResult written = targets[i] ? targets[i]->WriteValue(values[i]->value, false) : BRIDGE_ERR_EXCEPTION;
+        if (written == BRIDGE_OK) {
+            result->written++;
+        }
+        else {
+            result->failed++;
+            status = (status == BRIDGE_OK) ? written : status;
+        }
+    }
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (targets[i]) {
+            DataRefWrapper::Destroy(targets[i]);
+        }
+    }
+    result->write_ms = (MonotonicClock::Now() - writeStart) * 1000.0;
+    return status;
+}
+
+int32_t ProSimConnectWrapper::GetDeclaredValueType(const char* name) {
+    if (!name || !LoadDescriptions()) {
+        return DATAREF_TYPE_UNKNOWN;
+    }
+
+    Dictionary<String^, DataRefDescription^>^ descriptions = _descriptions;
+    DataRefDescription^ description = nullptr;
+    if (!descriptions->TryGetValue(gcnew String(name), description) || description->DataType == nullptr) {
+        return DATAREF_TYPE_UNKNOWN;
+    }
+
+    String^ type = description->DataType->Trim();
+    if (String::Equals(type, "double", StringComparison::OrdinalIgnoreCase)) return DATAREF_TYPE_DOUBLE;
+    if (String::Equals(type, "float", StringComparison::OrdinalIgnoreCase) ||
+        String::Equals(type, "single", StringComparison::OrdinalIgnoreCase)) return DATAREF_TYPE_FLOAT;
+    if (String::Equals(type, "int", StringComparison::OrdinalIgnoreCase) ||
+        String::Equals(type, "int32", StringComparison::OrdinalIgnoreCase) ||
+        String::Equals(type, "integer", StringComparison::OrdinalIgnoreCase)) return DATAREF_TYPE_INT;
+    if (String::Equals(type, "long", StringComparison::OrdinalIgnoreCase) ||
+        String::Equals(type, "int64", StringComparison::OrdinalIgnoreCase)) return DATAREF_TYPE_INT64;
+    if (String::Equals(type, "bool", StringComparison::OrdinalIgnoreCase) ||
+        String::Equals(type, "boolean", StringComparison::OrdinalIgnoreCase)) return DATAREF_TYPE_BOOL;
+    if (String::Equals(type, "string", StringComparison::OrdinalIgnoreCase)) return DATAREF_TYPE_STRING;
+    if (String::Equals(type, "datetime", StringComparison::OrdinalIgnoreCase)) return DATAREF_TYPE_DATETIME;
+    return DATAREF_TYPE_UNKNOWN;
+}
+
+void ProSimConnectWrapper::SetOnConnect(ConnectionCallback callback, void* userData) {
+    _onConnectCallback = callback;
+    _onConnectUserData = userData;
+}
+
+void ProSimConnectWrapper::SetOnDisconnect(ConnectionCallback callback, void* userData) {
+    _onDisconnectCallback = callback;
+    _onDisconnectUserData = userData;
+}
+
+void ProSimConnectWrapper::SetOnDataRefsUpdated(DataRefsUpdatedCallback callback, void* userData) {
+    ExclusiveLock guard(_changedLock);
+    _onDataRefsUpdatedCallback = callback;
+    _onDataRefsUpdatedUserData = userData;
+
+    if (!callback) {
+        // Nothing will deliver the collected changes now
+        for (size_t i = 0; i < _changedSlots.size(); ++i) {
+            *_changedSlots[i] = -1;
+        }
+        _changedRefs.clear();
+        _changedValues.clear();
+        _changedSlots.clear();
+    }
+}
+
+void ProSimConnectWrapper::RecordChange(DataRefHandle handle, int32_t* slot, double value) {
+    ExclusiveLock guard(_changedLock);
+    if (!_onDataRefsUpdatedCallback) {
+        return;
+    }
+
+    // A DataRef that changes twice in one cycle is listed once, with its latest value
+    if (*slot >= 0) {
+        _changedValues[*slot] = value;
+        return;
+    }
+    *slot = static_cast<int32_t>(_changedRefs.size());
+    _changedRefs.push_back(handle);
+    _changedValues.push_back(value);
+    _changedSlots.push_back(slot);
+}
+
+void ProSimConnectWrapper::ForgetChange(int32_t* slot) {
+    ExclusiveLock guard(_changedLock);
+    int32_t index = *slot;
+    if (index < 0) {
+        return;
+    }
+
+    // Move the last entry into the gap
+    int32_t last = static_cast<int32_t>(_changedRefs.size()) - 1;
+    if (index != last) {
+        _changedRefs[index] = _changedRefs[last];
+        _changedValues[index] = _changedValues[last];
+        _changedSlots[index] = _changedSlots[last];
+        *_changedSlots[index] = index;
+    }
+    _changedRefs.pop_back();
+    _changedValues.pop_back();
+    _changedSlots.pop_back();
+    *slot = -1;
+}
+
+void ProSimConnectWrapper::FireOnConnect() {
+    if (_onConnectCallback) {
+        _onConnectCallback(_onConnectUserData);
+    }
+}
+
+void ProSimConnectWrapper::FireOnDisconnect() {
+    // Traffic is re-announced on the next connection
+    _traffic.Clear();
+
+    if (_onDisconnectCallback) {
+        _onDisconnectCallback(_onDisconnectUserData);
+    }
+}
+
+void ProSimConnectWrapper::FireOnDataRefsUpdated() {
+    // Derived DataRefs first, so their changes are part of this cycle's batch
+    EvaluateDerived();
+
+    ExclusiveLock deliverGuard(_deliverLock);
+    DataRefsUpdatedCallback callback;
+    void* userData;
+    {
+        // Take the cycle's changes; the next cycle starts collecting into the emptied arrays
+        ExclusiveLock guard(_changedLock);
+        callback = _onDataRefsUpdatedCallback;
+        userData = _onDataRefsUpdatedUserData;
+        if (!callback || _changedRefs.empty()) {
+            return;
+        }
+        for (size_t i = 0; i < _changedSlots.size(); ++i) {
+            *_changedSlots[i] = -1;
+        }
+        _deliverRefs.swap(_changedRefs);
+        _deliverValues.swap(_changedValues);
+        _changedRefs.clear();
+        _changedValues.clear();
+        _changedSlots.clear();
+    }
+
+    callback(_deliverRefs.data(), _deliverValues.data(), static_cast<int32_t>(_deliverRefs.size()), userData);
+}
+
+// ============================================================================
+// DataRefEventBridge Implementation
+// ============================================================================
+
+void DataRefEventBridge::OnDataChange(DataRef^ dataRef) {
+    if (_nativeShared) {
+        _nativeShared->PromotePending(dataRef);
+        _nativeShared->FireOnDataChange();
+    }
+}
+
+// ============================================================================
+// SharedDataRef Implementation
+// ============================================================================
+
+SharedDataRef::SharedDataRef(ProSimConnectWrapper* owner, const char* refName, uint32_t refNameId, int interval)
+    : connection(owner)
+    , name(refName)
+    , nameId(refNameId)
+    , declaredType(DATAREF_TYPE_UNKNOWN)
+    , disposed(false)
+    , refs(0)
+    , notifyThread(0)
+    , retired(false)
+    , changeVersion(1)
+    , consumed(0)
+{
+    // Lazy DataRefs wait for their first use; the others are registered by AcquireShared
+    registration.lazy = owner->IsLazyRegistration();
+    registration.lastUse = GetTickCount();
+
+    // Adaptive DataRefs start from the requested interval, within the connection's bounds
+    registration.adaptive = owner->IsAdaptiveIntervals();
+    registration.interval = registration.adaptive ? owner->ClampInterval(interval) : interval;
+    registration.reviewedVersion = changeVersion;
+
+    dataRef = gcnew DataRef(gcnew String(refName), registration.interval, owner->GetManagedConnection(), false);
+    eventBridge = gcnew DataRefEventBridge(this);
+
+    // Seed the value type from the catalog; each view's first value read corrects it if needed
+    declaredType = owner->GetDeclaredValueType(refName);
+
+    // Subscribe to data change events using the bridge class
+    dataRef->onDataChange += gcnew DataRef::onDataChangeDelegate(eventBridge, &DataRefEventBridge::OnDataChange);
+}
+
+SharedDataRef::~SharedDataRef() {
+    try {
+        // Unsubscribe from events before disposing
+        DataRef^ dr = dataRef;
+        DataRef^ pending = pendingRef;
+        DataRefEventBridge^ bridge = eventBridge;
+        DataRef^ subscribed = (pending != nullptr) ? pending : dr;
+        if (subscribed != nullptr && bridge != nullptr) {
+            subscribed->onDataChange -= gcnew DataRef::onDataChangeDelegate(bridge, &DataRefEventBridge::OnDataChange);
+        }
+
+        // Let a fan-out that started before the unsubscribe finish
+        {
+            ExclusiveLock guard(notifyLock);
+        }
+
+        // Dispose the DataRefs (delete invokes IDisposable::Dispose in C++/CLI)
+        DataRef^ owned[2] = { dr, pending };
+        for (int i = 0; i < 2; ++i) {
+            if (owned[i] != nullptr) {
+                try {
+                    delete owned[i];
+                }
+                catch (...) {
+                    // Ignore disposal errors
+                }
+            }
+        }
+    }
+    catch (...) {
+        // Ignore exceptions during cleanup
+    }
+}
+
+void SharedDataRef::AddView(DataRefWrapper* view) {
+    // A view created from a callback of our own fan-out is not notified of that change
+    bool notifying = (notifyThread == GetCurrentThreadId());
+    if (!notifying) {
+        notifyLock.LockExclusive();
+    }
+    views.push_back(view);
+    if (!notifying) {
+        notifyLock.UnlockExclusive();
+    }
+}
+
+void SharedDataRef::RemoveView(DataRefWrapper* view) {
+    // Removing a view from a callback raised by our own fan-out must not wait for it
+    bool notifying = (notifyThread == GetCurrentThreadId());
+    if (!notifying) {
+        notifyLock.LockExclusive();
+    }
+    for (size_t i = 0; i < views.size(); ++i) {
+        if (views[i] == view) {
+            views[i] = views.back();
+            views.pop_back();
+            break;
+        }
+    }
+    for (size_t i = 0; i < firing.size(); ++i) {
+        if (firing[i] == view) {
+            firing[i] = nullptr;
+        }
+    }
+    if (!notifying) {
+        notifyLock.UnlockExclusive();
+    }
+}
+
+DataRef^ SharedDataRef::ActiveRef() {
+    SharedLock guard(refLock);
+    DataRef^ pending = pendingRef;
+    return (pending != nullptr) ? pending : static_cast<DataRef^>(dataRef);
+}
+
+void SharedDataRef::PromotePending(DataRef^ changed) {
+    ExclusiveLock guard(refLock);
+    DataRef^ pending = pendingRef;
+    if (pending != nullptr && Object::ReferenceEquals(pending, changed)) {
+        // The previous DataRef is already unsubscribed, and disposed if it was registered. A
+        // disposed DataRef still returns its last value, so a reader on another thread that
+        // still holds it is safe; the collector frees it.
+        dataRef = pending;
+        pendingRef = nullptr;
+    }
+}
+
+DataRef^ SharedDataRef::Replace(int32_t interval) {
+    DataRef^ replacement = gcnew DataRef(gcnew String(name), interval, connection->GetManagedConnection(), false);
+    DataRef^ previous = ActiveRef();
+    DataRefEventBridge^ bridge = eventBridge;
+    previous->onDataChange -= gcnew DataRef::onDataChangeDelegate(bridge, &DataRefEventBridge::OnDataChange);
+    replacement->onDataChange += gcnew DataRef::onDataChangeDelegate(bridge, &DataRefEventBridge::OnDataChange);
+    {
+        // The replacement takes over at its first change (PromotePending); a replaced
+        // pending DataRef never served values and is dropped
+        ExclusiveLock guard(refLock);
+        pendingRef = replacement;
+    }
+    disposed = false;
+    return previous;
+}
+
+BridgeResult SharedDataRef::ApplyRegistration(bool registered) {
+    try {
+        if (registered) {
+            if (disposed) {
+                // Registered before and disposed to unregister; the SDK keeps a disposed
+                // DataRef marked registered, so a new one is registered in its place
+                Replace(registration.interval);
+            }
+            ActiveRef()->Register();
+        }
+        else {
+            // ProSimConnect::unRegister is internal to the SDK, and disposing a DataRef is the
+            // public way to unregister it. The disposed DataRef keeps serving its last value
+            // until the next use registers a replacement.
+            DataRef^ active = ActiveRef();
+            DataRefEventBridge^ bridge = eventBridge;
+            active->onDataChange -= gcnew DataRef::onDataChangeDelegate(bridge, &DataRefEventBridge::OnDataChange);
+            delete active;
+            disposed = true;
+        }
+        InterlockedExchange(&registration.registered, registered ? 1 : 0);
+        return BRIDGE_OK;
+    }
+    catch (Exception^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_EXCEPTION;
+    }
+}
+
+BridgeResult SharedDataRef::ApplyInterval(int32_t interval) {
+    try {
+        // A DataRef's interval is fixed at construction, so move the subscription and the
+        // registration onto a new DataRef with the new interval. The previous one is disposed
+        // to unregister it once the replacement is registered; its last value stays readable.
+        bool registered = (registration.registered != 0);
+        bool wasDisposed = disposed;
+        DataRef^ previous = Replace(interval);
+        registration.interval = interval;
+        if (registered) {
+            ActiveRef()->Register();
+        }
+        if (registered && !wasDisposed) {
+            delete previous;
+        }
+        return BRIDGE_OK;
+    }
+    catch (Exception^ ex) {
+        StoreExceptionMessage(ex);
+        return BRIDGE_ERR_EXCEPTION;
+    }
+}
+
+void SharedDataRef::FireOnDataChange() {
+    InterlockedIncrement(&changeVersion);
+
+    bool done;
+    {
+        ExclusiveLock guard(notifyLock);
+        firing = views;
+        notifyThread = GetCurrentThreadId();
+
+        // The value is read at most once, by the first view that needs it
+        ChangeSample sample;
+        bool anyConsumer = false;
+        for (size_t i = 0; i < firing.size(); ++i) {
+            DataRefWrapper* view = firing[i];
+            if (view) {
+                anyConsumer = anyConsumer || view->HasChangeConsumers();
+                view->FireOnDataChange(sample);
+            }
+        }
+        InterlockedExchange(&consumed, anyConsumer ? 1 : 0);
+
+        notifyThread = 0;
+        firing.clear();
+        done = retired;
+    }
+
+    if (done) {
+        // The last view was destroyed by one of the callbacks
+        delete this;
+    }
+}
+
+// ============================================================================
+// DataRefWrapper Implementation
+// ============================================================================
+
+void* DataRefWrapper::AllocateBlock(ProSimConnectWrapper* connection) {
+    void* block = connection->GetDataRefPool().Allocate();
+    if (!block) {
+        ProSim_SetLastError("DataRef limit reached: the connection already has max_datarefs DataRefs");
+    }
+    return block;
+}
+
+DataRefWrapper* DataRefWrapper::Construct(const char* name, uint32_t nameId, int interval,
+                                          ProSimConnectWrapper* connection, bool registerNow) {
+    void* block = AllocateBlock(connection);
+    if (!block) {
+        return nullptr;
+    }
+    DataRefWrapper* wrapper;
     try {
-        _connection->setSDKPriorityMode(priority);
+        wrapper = new (block) DataRefWrapper(name, nameId, interval, connection, registerNow);
     }
     catch (...) {
-        // Ignore errors
+        connection->GetDataRefPool().Free(block);
+        throw;
     }
+    connection->TrackDataRef(wrapper);
+    return wrapper;
 }
 
-void ProSimConnectWrapper::SetOnConnect(ConnectionCallback callback, void* userData) {
-    _onConnectCallback = callback;
-    _onConnectUserData = userData;
+DataRefWrapper* DataRefWrapper::Create(const char* name, int interval, ProSimConnectWrapper* connection, bool registerNow) {
+    uint32_t nameId;
+    const char* interned = connection->GetNames().Intern(name, &nameId);
+    if (!interned) {
+        ProSim_SetLastError("Name storage limit reached: the name would exceed max_name_bytes");
+        return nullptr;
+    }
+    return Construct(interned, nameId, interval, connection, registerNow);
 }
 
-void ProSimConnectWrapper::SetOnDisconnect(ConnectionCallback callback, void* userData) {
-    _onDisconnectCallback = callback;
-    _onDisconnectUserData = userData;
+DataRefWrapper* DataRefWrapper::CreateById(uint32_t nameId, int interval, ProSimConnectWrapper* connection, bool registerNow) {
+    const char* name = connection->GetNames().Name(nameId);
+    if (!name) {
+        ProSim_SetLastError("Unknown name id");
+        return nullptr;
+    }
+    return Construct(name, nameId, interval, connection, registerNow);
 }
 
-void ProSimConnectWrapper::FireOnConnect() {
-    if (_onConnectCallback) {
-        _onConnectCallback(_onConnectUserData);
+DataRefWrapper* DataRefWrapper::CreateDerived(const char* name, const char* expression, int interval,
+                                              ProSimConnectWrapper* connection, Trigger* trigger) {
+    uint32_t nameId;
+    const char* interned = connection->GetNames().Intern(name, &nameId);
+    if (!interned) {
+        ProSim_SetLastError("Name storage limit reached: the name would exceed max_name_bytes");
+        return nullptr;
     }
-}
 
-void ProSimConnectWrapper::FireOnDisconnect() {
-    if (_onDisconnectCallback) {
-        _onDisconnectCallback(_onDisconnectUserData);
+    DerivedState* derived = new DerivedState();
+    derived->trigger = trigger;
+    void* block = nullptr;
+    if (connection->CompileDerived(derived->expression, expression) != BRIDGE_OK ||
+        (block = AllocateBlock(connection)) == nullptr) {
+        delete derived;
+        return nullptr;
     }
-}
 
-// ============================================================================
-// DataRefEventBridge Implementation
-// ============================================================================
+    // From here the wrapper owns the state, and destroying it undoes a partial AddDerived
+    DataRefWrapper* wrapper = new (block) DataRefWrapper(interned, nameId, connection, derived);
+    connection->TrackDataRef(wrapper);
+    if (connection->AddDerived(wrapper, interval) != BRIDGE_OK) {
+        Destroy(wrapper);
+        return nullptr;
+    }
+    return wrapper;
+}
 
-void DataRefEventBridge::OnDataChange(DataRef^ dataRef) {
-    if (_nativeWrapper) {
-        _nativeWrapper->FireOnDataChange();
+void DataRefWrapper::Destroy(DataRefWrapper* wrapper) {
+    bool orphaned = (wrapper->_connection == nullptr);
+    SlabPool* pool = wrapper->_pool;
+    wrapper->~DataRefWrapper();
+    if (pool->Free(wrapper) == 0 && orphaned) {
+        // The last handle to outlive its connection takes the pool with it
+        delete pool;
     }
 }
 
-// ============================================================================
-// DataRefWrapper Implementation
-// ============================================================================
+void DataRefWrapper::Orphan() {
+    Release();
+    _connection = nullptr;
+}
 
-DataRefWrapper::DataRefWrapper(const char* name, int interval, ProSimConnectWrapper* connection, bool registerNow)
-    : _nameBuffer(nullptr)
+DataRefWrapper::DataRefWrapper(const char* name, uint32_t nameId, int interval, ProSimConnectWrapper* connection, bool registerNow)
+    : _shared(nullptr)
+    , _interval(interval)
+    , _pins(0)
+    , _connection(connection)
+    , _pool(&connection->GetDataRefPool())
+    , _liveSlot(-1)
+    , _name(name)
+    , _nameId(nameId)
+    , _valueType(DATAREF_TYPE_UNKNOWN)
+    , _derived(nullptr)
+    , _feedsDerived(false)
+    , _changeVersion(1)
+    , _utf8Version(0)
     , _disposed(false)
     , _onDataChangeCallback(nullptr)
     , _onDataChangeUserData(nullptr)
+    , _callbackStrand(new CallbackDispatcher::Strand(&DataRefWrapper::RunCallback, this))
+    , _changedSlot(-1)
 {
-    String^ managedName = gcnew String(name);
-    ProSimConnect^ conn = connection->GetManagedConnection();
+    // Handles for the same name share one SDK DataRef; lazy ones wait for their first use
+    // whatever registerNow says
+    _shared = connection->AcquireShared(this, name, nameId, interval, registerNow);
 
-    _dataRef = gcnew DataRef(managedName, interval, conn, registerNow);
-    _eventBridge = gcnew DataRefEventBridge(this);
-
-    // Store name for later retrieval
-    size_t len = strlen(name) + 1;
-    _nameBuffer = new char[len];
-    strcpy_s(_nameBuffer, len, name);
+    // Seed the value type from the catalog; the first value read corrects it if needed
+    _valueType = _shared->declaredType;
+}
 
-    // Subscribe to data change events using the bridge class
-    _dataRef->onDataChange += gcnew DataRef::onDataChangeDelegate(_eventBridge, &DataRefEventBridge::OnDataChange);
+DataRefWrapper::DataRefWrapper(const char* name, uint32_t nameId, ProSimConnectWrapper* connection, DerivedState* derived)
+    : _shared(nullptr)
+    , _interval(0)
+    , _pins(0)
+    , _connection(connection)
+    , _pool(&connection->GetDataRefPool())
+    , _liveSlot(-1)
+    , _name(name)
+    , _nameId(nameId)
+    , _valueType(DATAREF_TYPE_DOUBLE)
+    , _derived(derived)
+    , _feedsDerived(false)
+    , _changeVersion(1)
+    , _utf8Version(0)
+    , _disposed(false)
+    , _onDataChangeCallback(nullptr)
+    , _onDataChangeUserData(nullptr)
+    , _callbackStrand(new CallbackDispatcher::Strand(&DataRefWrapper::RunCallback, this))
+    , _changedSlot(-1)
+{
+    // No SDK DataRef: the value comes from the expression (see ProSimConnectWrapper::AddDerived)
 }
 
 DataRefWrapper::~DataRefWrapper() {
+    Release();
+}
+
+void DataRefWrapper::Release() {
     if (!_disposed) {
         _disposed = true;
+        _connection->UntrackDataRef(this);
+
+        // Drop writes still buffered or queued for this DataRef
+        _connection->GetWriteBuffer().Discard(this);
+        _connection->GetAsyncWriter().Discard(this);
+
         try {
-            // Unsubscribe from events before disposing
-            DataRef^ dr = _dataRef;
-            DataRefEventBridge^ bridge = _eventBridge;
-            if (dr != nullptr && bridge != nullptr) {
-                dr->onDataChange -= gcnew DataRef::onDataChangeDelegate(bridge, &DataRefEventBridge::OnDataChange);
+            // Leave the shared DataRef, disposing it if this was its last handle
+            if (_shared) {
+                _connection->SetRegistrationPin(_shared, &_pins, ~0u, false);
+                _connection->ReleaseShared(_shared, this, _interval);
+                _shared = nullptr;
             }
-
-            // Dispose the DataRef (delete invokes IDisposable::Dispose in C++/CLI)
-            if (dr != nullptr) {
-                try {
-                    delete dr;
-                }
-                catch (...) {
-                    // Ignore disposal errors
-                }
+            if (_derived) {
+                _connection->RemoveDerived(this);
             }
+
+            _connection->ForgetChange(&_changedSlot);
+
+            // Give back this DataRef's share of the connection's memory accounting
+            _connection->ReserveHistoryBytes(-static_cast<LONG64>(_history.Bytes()));
+            _connection->AdjustCacheBytes(-static_cast<LONG64>(_utf8.capacity()));
         }
         catch (...) {
             // Ignore exceptions during cleanup
         }
 
-        // Free name buffer
-        if (_nameBuffer) {
-            delete[] _nameBuffer;
-            _nameBuffer = nullptr;
-        }
+        // No new callbacks can be queued now. Queued ones are dropped; only a callback running
+        // on another worker is waited for, so this may run from any callback.
+        _callbackStrand->Retire();
+        _callbackStrand = nullptr;
+
+        delete _derived;
+        _derived = nullptr;
     }
 }
 
 BridgeResult DataRefWrapper::Register() {
-    try {
-        // Note: DataRef constructor with registerNow parameter handles registration
-        // This method is for explicit registration if needed
+    if (_derived) {
+        // Computed locally; nothing to register
         return BRIDGE_OK;
     }
-    catch (Exception^ ex) {
-        StoreExceptionMessage(ex);
-        return BRIDGE_ERR_EXCEPTION;
+    _shared->registration.lastUse = GetTickCount();
+    return _connection->EnsureRegistered(_shared);
+}
+
+void DataRefWrapper::SetPin(uint32_t pin, bool pinned) {
+    if (_shared) {
+        _connection->SetRegistrationPin(_shared, &_pins, pin, pinned);
     }
 }
 
+bool DataRefWrapper::HasChangeConsumers() {
+    return _onDataChangeCallback != nullptr || _feedsDerived || _history.IsEnabled() ||
+           _connection->WantsBatchedChanges() || _connection->HasFanout();
+}
+
+void DataRefWrapper::MarkDerivedInput() {
+    _feedsDerived = true;
+    SetPin(RegistrationState::PinDerivedInput, true);
+}
+
 const char* DataRefWrapper::GetName() {
-    return _nameBuffer;
+    return _name;
+}
+
+int32_t DataRefWrapper::GetValueType() {
+    if (_valueType == DATAREF_TYPE_UNKNOWN) {
+        try {
+            Object^ val = _shared->dataRef->value;
+            if (val != nullptr) {
+                _valueType = ValueTypeOf(val);
+            }
+        }
+        catch (Exception^) {
+            // Value not available yet; the type stays unknown until the first read
+        }
+    }
+    return _valueType;
+}
+
+int32_t DataRefWrapper::ValueTypeOf(Object^ value) {
+    switch (Type::GetTypeCode(value->GetType())) {
+    case TypeCode::Boolean:  return DATAREF_TYPE_BOOL;
+    case TypeCode::Int32:    return DATAREF_TYPE_INT;
+    case TypeCode::Int64:    return DATAREF_TYPE_INT64;
+    case TypeCode::Single:   return DATAREF_TYPE_FLOAT;
+    case TypeCode::Double:   return DATAREF_TYPE_DOUBLE;
+    case TypeCode::String:   return DATAREF_TYPE_STRING;
+    case TypeCode::DateTime: return DATAREF_TYPE_DATETIME;
+    default:                 return DATAREF_TYPE_OBJECT;
+    }
+}
+
+// The unbox helpers try the learned type first (a single type check, no IConvertible
+// dispatch). If the boxed value has a different runtime type the wrapper re-learns it
+// once and retries. They return false when the value cannot represent the requested type.
+
+bool DataRefWrapper::UnboxAsDouble(Object^ value, double* outValue) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        switch (_valueType) {
+        case DATAREF_TYPE_DOUBLE: {
+            Double^ boxed = dynamic_cast<Double^>(value);
+            if (boxed != nullptr) { *outValue = *boxed; return true; }
+            break;
+        }
+        case DATAREF_TYPE_INT: {
+            Int32^ boxed = dynamic_cast<Int32^>(value);
+            if (boxed != nullptr) { *outValue = *boxed; return true; }
+            break;
+        }
+        case DATAREF_TYPE_FLOAT: {
+            Single^ boxed = dynamic_cast<Single^>(value);
+            if (boxed != nullptr) { *outValue = *boxed; return true; }
+            break;
+        }
+        case DATAREF_TYPE_INT64: {
+            Int64^ boxed = dynamic_cast<Int64^>(value);
+            if (boxed != nullptr) { *outValue = static_cast<double>(*boxed); return true; }
+            break;
+        }
+        case DATAREF_TYPE_BOOL: {
+            Boolean^ boxed = dynamic_cast<Boolean^>(value);
+            if (boxed != nullptr) { *outValue = *boxed ? 1.0 : 0.0; return true; }
+            break;
+        }
+        case DATAREF_TYPE_OBJECT: {
+            // Uncommon numeric types (Int16, UInt32, Decimal, ...) keep the generic conversion
+            IConvertible^ convertible = dynamic_cast<IConvertible^>(value);
+            if (convertible != nullptr && ValueTypeOf(value) == DATAREF_TYPE_OBJECT) {
+                try {
+                    *outValue = convertible->ToDouble(nullptr);
+                    return true;
+                }
+                catch (Exception^) {
+                    return false;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        int32_t actual = ValueTypeOf(value);
+        if (actual == _valueType) {
+            return false;
+        }
+        _valueType = actual;
+    }
+    return false;
+}
+
+bool DataRefWrapper::UnboxAsInt(Object^ value, int32_t* outValue) {
+    Int32^ boxed = nullptr;
+    if (_valueType == DATAREF_TYPE_INT && (boxed = dynamic_cast<Int32^>(value)) != nullptr) {
+        *outValue = *boxed;
+        return true;
+    }
+
+    double d = 0.0;
+    if (!UnboxAsDouble(value, &d)) {
+        return false;
+    }
+    return RoundToInt(d, outValue);
+}
+
+bool DataRefWrapper::RoundToInt(double value, int32_t* outValue) {
+    // Same semantics as Convert::ToInt32: round half to even, reject out-of-range values
+    double rounded = Math::Round(value);
+    if (!(rounded >= -2147483648.0 && rounded <= 2147483647.0)) {
+        return false;
+    }
+    *outValue = static_cast<int32_t>(rounded);
+    return true;
+}
+
+bool DataRefWrapper::UnboxAsBool(Object^ value, bool* outValue) {
+    Boolean^ boxed = nullptr;
+    if (_valueType == DATAREF_TYPE_BOOL && (boxed = dynamic_cast<Boolean^>(value)) != nullptr) {
+        *outValue = *boxed;
+        return true;
+    }
+
+    double d = 0.0;
+    if (!UnboxAsDouble(value, &d)) {
+        return false;
+    }
+    *outValue = (d != 0.0);
+    return true;
+}
+
+void DataRefWrapper::StoreTypeMismatch(const char* requested) {
+    char message[512];
+    sprintf_s(message, sizeof(message), "DataRef '%s' (type %d) cannot be read as %s",
+              _name, _valueType, requested);
+    ProSim_SetLastError(message);
+}
+
+BridgeResult DataRefWrapper::ReadDerived(double* outValue) {
+    SharedLock guard(_derived->valueLock);
+    if (!_derived->ready) {
+        char message[512];
+        sprintf_s(message, sizeof(message), "Derived DataRef '%s' has no value until every input has one", _name);
+        ProSim_SetLastError(message);
+        return BRIDGE_ERR_DATAREF_NOT_READY;
+    }
+    *outValue = _derived->value;
+    return BRIDGE_OK;
+}
+
+BridgeResult DataRefWrapper::RejectDerivedWrite() {
+    char message[512];
+    sprintf_s(message, sizeof(message), "Derived DataRef '%s' is read-only", _name);
+    ProSim_SetLastError(message);
+    return BRIDGE_ERR_INVALID_ARGUMENT;
+}
+
+bool DerivedState::Recompute() {
+    if (missing != 0) {
+        return false;
+    }
+    double result = expression.Evaluate(inputs.data());
+
+    // Compare bits so NaN to NaN is not a change
+    ExclusiveLock guard(valueLock);
+    bool changed = !ready || memcmp(&result, &value, sizeof(double)) != 0;
+    value = result;
+    ready = true;
+    return changed;
+}
+
+bool DerivedState::IsTrue() {
+    SharedLock guard(valueLock);
+    return ready && value != 0.0 && value == value;
 }
 
 BridgeResult DataRefWrapper::GetInt(int32_t* outValue) {
     if (!outValue) return BRIDGE_ERR_INVALID_ARGUMENT;
+    Touch();
+
+    if (_derived) {
+        double d = 0.0;
+        BridgeResult result = ReadDerived(&d);
+        if (result == BRIDGE_OK && !RoundToInt(d, outValue)) {
+            StoreTypeMismatch("int");
+            return BRIDGE_ERR_INVALID_DATA;
+        }
+        return result;
+    }
 
     try {
-        Object^ val = _dataRef->value;
-        *outValue = Convert::ToInt32(val);
+        Object^ val = _shared->dataRef->value;
+        if (val == nullptr) {
+            *outValue = 0;
+            return BRIDGE_OK;
+        }
+        if (!UnboxAsInt(val, outValue)) {
+            StoreTypeMismatch("int");
+            return BRIDGE_ERR_INVALID_DATA;
+        }
         return BRIDGE_OK;
     }
     catch (DataRefNotReady^ ex) {
@@ -265,10 +2310,22 @@ BridgeResult DataRefWrapper::GetInt(int32_t* outValue) {
 
 BridgeResult DataRefWrapper::GetDouble(double* outValue) {
     if (!outValue) return BRIDGE_ERR_INVALID_ARGUMENT;
+    Touch();
+
+    if (_derived) {
+        return ReadDerived(outValue);
+    }
 
     try {
-        Object^ val = _dataRef->value;
-        *outValue = Convert::ToDouble(val);
+        Object^ val = _shared->dataRef->value;
+        if (val == nullptr) {
+            *outValue = 0.0;
+            return BRIDGE_OK;
+        }
+        if (!UnboxAsDouble(val, outValue)) {
+            StoreTypeMismatch("double");
+            return BRIDGE_ERR_INVALID_DATA;
+        }
         return BRIDGE_OK;
     }
     catch (DataRefNotReady^ ex) {
@@ -283,10 +2340,27 @@ BridgeResult DataRefWrapper::GetDouble(double* outValue) {
 
 BridgeResult DataRefWrapper::GetBool(bool* outValue) {
     if (!outValue) return BRIDGE_ERR_INVALID_ARGUMENT;
+    Touch();
+
+    if (_derived) {
+        double d = 0.0;
+        BridgeResult result = ReadDerived(&d);
+        if (result == BRIDGE_OK) {
+            *outValue = (d != 0.0);
+        }
+        return result;
+    }
 
     try {
-        Object^ val = _dataRef->value;
-        *outValue = Convert::ToBoolean(val);
+        Object^ val = _shared->dataRef->value;
+        if (val == nullptr) {
+            *outValue = false;
+            return BRIDGE_OK;
+        }
+        if (!UnboxAsBool(val, outValue)) {
+            StoreTypeMismatch("bool");
+            return BRIDGE_ERR_INVALID_DATA;
+        }
         return BRIDGE_OK;
     }
     catch (DataRefNotReady^ ex) {
@@ -299,28 +2373,44 @@ BridgeResult DataRefWrapper::GetBool(bool* outValue) {
     }
 }
 
-BridgeResult DataRefWrapper::GetString(char* buffer, int32_t bufferSize) {
-    if (!buffer || bufferSize <= 0) return BRIDGE_ERR_INVALID_ARGUMENT;
+BridgeResult DataRefWrapper::RefreshUtf8() {
+    LONG version = ChangeVersion();
+    if (_utf8Version == version && !_utf8.empty()) {
+        return BRIDGE_OK;
+    }
 
     try {
-        Object^ val = _dataRef->value;
-        String^ str = val->ToString();
-
-        // Check if buffer is large enough
-        int requiredSize = str->Length + 1;
-        if (requiredSize > bufferSize) {
-            return (BridgeResult)requiredSize; // Return required size
+        String^ str;
+        if (_derived) {
+            double value = 0.0;
+            BridgeResult result = ReadDerived(&value);
+            if (result != BRIDGE_OK) {
+                return result;
+            }
+            str = value.ToString();
+        }
+        else {
+            Object^ val = _shared->dataRef->value;
+            str = dynamic_cast<String^>(val);
+            if (str == nullptr) {
+                str = (val != nullptr) ? val->ToString() : String::Empty;
+            }
         }
 
-        // Convert managed string to native string
-        IntPtr ptr = Marshal::StringToHGlobalAnsi(str);
-        try {
-            strncpy_s(buffer, bufferSize, static_cast<const char*>(ptr.ToPointer()), _TRUNCATE);
+        // Encode straight into the wrapper-owned buffer; it only reallocates when it grows
+        int byteCount = Encoding::UTF8->GetByteCount(str);
+        size_t capacity = _utf8.capacity();
+        _utf8.resize(static_cast<size_t>(byteCount) + 1);
+        if (_utf8.capacity() != capacity) {
+            _connection->AdjustCacheBytes(static_cast<LONG64>(_utf8.capacity()) - static_cast<LONG64>(capacity));
         }
-        finally {
-            Marshal::FreeHGlobal(ptr);
+        if (byteCount > 0) {
+            pin_ptr<const wchar_t> chars = PtrToStringChars(str);
+            Encoding::UTF8->GetBytes(const_cast<wchar_t*>(chars), str->Length,
+                                     reinterpret_cast<unsigned char*>(_utf8.data()), byteCount);
         }
-
+        _utf8[byteCount] = '\0';
+        _utf8Version = version;
         return BRIDGE_OK;
     }
     catch (DataRefNotReady^ ex) {
@@ -333,62 +2423,138 @@ BridgeResult DataRefWrapper::GetString(char* buffer, int32_t bufferSize) {
     }
 }
 
-BridgeResult DataRefWrapper::SetInt(int32_t value) {
-    try {
-        _dataRef->value = value;
+BridgeResult DataRefWrapper::CopyUtf8(char* buffer, int32_t bufferSize) {
+    // Check if buffer is large enough
+    int32_t requiredSize = static_cast<int32_t>(_utf8.size());
+    if (requiredSize > bufferSize) {
+        return (BridgeResult)requiredSize; // Return required size
+    }
+
+    memcpy(buffer, _utf8.data(), _utf8.size());
+    return BRIDGE_OK;
+}
+
+BridgeResult DataRefWrapper::GetString(char* buffer, int32_t bufferSize) {
+    if (!buffer || bufferSize <= 0) return BRIDGE_ERR_INVALID_ARGUMENT;
+    Touch();
+
+    ExclusiveLock lock(_utf8Lock);
+    BridgeResult result = RefreshUtf8();
+    if (result != BRIDGE_OK) {
+        return result;
+    }
+    return CopyUtf8(buffer, bufferSize);
+}
+
+BridgeResult DataRefWrapper::GetStringIfChanged(char* buffer, int32_t bufferSize, uint32_t* inOutVersion) {
+    if (!buffer || bufferSize <= 0 || !inOutVersion) return BRIDGE_ERR_INVALID_ARGUMENT;
+    Touch();
+
+    // Fast path: the caller already holds the current value
+    if (*inOutVersion == static_cast<uint32_t>(ChangeVersion())) {
         return BRIDGE_OK;
     }
-    catch (InvalidData^ ex) {
-        StoreExceptionMessage(ex);
-        return BRIDGE_ERR_INVALID_DATA;
+
+    ExclusiveLock lock(_utf8Lock);
+    BridgeResult result = RefreshUtf8();
+    if (result != BRIDGE_OK) {
+        return result;
     }
-    catch (Exception^ ex) {
-        StoreExceptionMessage(ex);
-        return BRIDGE_ERR_EXCEPTION;
+    result = CopyUtf8(buffer, bufferSize);
+    if (result == BRIDGE_OK) {
+        *inOutVersion = static_cast<uint32_t>(_utf8Version);
     }
+    return result;
 }
 
-BridgeResult DataRefWrapper::SetDouble(double value) {
+BridgeResult DataRefWrapper::WriteManaged(Object^ value, bool touch, char* error, size_t errorSize) {
+    if (touch) {
+        Touch();
+    }
     try {
-        _dataRef->value = value;
+        _shared->dataRef->value = value;
+        InterlockedIncrement(&ChangeVersion());
         return BRIDGE_OK;
     }
     catch (InvalidData^ ex) {
-        StoreExceptionMessage(ex);
+        StoreExceptionMessage(ex, error, errorSize);
         return BRIDGE_ERR_INVALID_DATA;
     }
     catch (Exception^ ex) {
-        StoreExceptionMessage(ex);
+        StoreExceptionMessage(ex, error, errorSize);
         return BRIDGE_ERR_EXCEPTION;
     }
 }
 
-BridgeResult DataRefWrapper::SetBool(bool value) {
-    try {
-        _dataRef->value = value;
+BridgeResult DataRefWrapper::WriteValue(const BridgeValue& value, bool touch, char* error, size_t errorSize) {
+    switch (value.type) {
+    case DATAREF_TYPE_INT:
+        return WriteManaged(value.intValue, touch, error, errorSize);
+    case DATAREF_TYPE_DOUBLE:
+        return WriteManaged(value.doubleValue, touch, error, errorSize);
+    case DATAREF_TYPE_BOOL:
+        return WriteManaged(value.boolValue, touch, error, errorSize);
+    case DATAREF_TYPE_STRING: {
+        const std::string& str = value.stringValue;
+        return WriteManaged(gcnew String(reinterpret_cast<signed char*>(const_cast<char*>(str.c_str())), 0,
+                                         static_cast<int>(str.size()), Encoding::UTF8), touch, error, errorSize);
+    }
+    default:
+        if (error && errorSize > 0) {
+            strncpy_s(error, errorSize, "Unsupported value type", _TRUNCATE);
+        }
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+}
+
+BridgeResult DataRefWrapper::SetAsync(const BridgeValue& value, int32_t priority, WriteToken* outToken) {
+    if (_derived) return RejectDerivedWrite();
+    return _connection->GetAsyncWriter().Submit(this, value, priority, outToken);
+}
+
+BridgeResult DataRefWrapper::SetInt(int32_t value) {
+    if (_derived) return RejectDerivedWrite();
+
+    if (_connection->GetWriteBuffer().IsEnabled()) {
+        _connection->GetWriteBuffer().Stage(this, BridgeValue::FromInt(value));
         return BRIDGE_OK;
     }
-    catch (InvalidData^ ex) {
-        StoreExceptionMessage(ex);
-        return BRIDGE_ERR_INVALID_DATA;
+    return WriteManaged(value);
+}
+
+BridgeResult DataRefWrapper::SetDouble(double value) {
+    if (_derived) return RejectDerivedWrite();
+
+    if (_connection->GetWriteBuffer().IsEnabled()) {
+        _connection->GetWriteBuffer().Stage(this, BridgeValue::FromDouble(value));
+        return BRIDGE_OK;
     }
-    catch (Exception^ ex) {
-        StoreExceptionMessage(ex);
-        return BRIDGE_ERR_EXCEPTION;
+    return WriteManaged(value);
+}
+
+BridgeResult DataRefWrapper::SetBool(bool value) {
+    if (_derived) return RejectDerivedWrite();
+
+    if (_connection->GetWriteBuffer().IsEnabled()) {
+        _connection->GetWriteBuffer().Stage(this, BridgeValue::FromBool(value));
+        return BRIDGE_OK;
     }
+    return WriteManaged(value);
 }
 
 BridgeResult DataRefWrapper::SetString(const char* value) {
     if (!value) return BRIDGE_ERR_INVALID_ARGUMENT;
+    if (_derived) return RejectDerivedWrite();
 
-    try {
-        String^ managedValue = gcnew String(value);
-        _dataRef->value = managedValue;
+    if (_connection->GetWriteBuffer().IsEnabled()) {
+        _connection->GetWriteBuffer().Stage(this, BridgeValue::FromString(value));
         return BRIDGE_OK;
     }
-    catch (InvalidData^ ex) {
-        StoreExceptionMessage(ex);
-        return BRIDGE_ERR_INVALID_DATA;
+
+    try {
+        String^ managedValue = gcnew String(reinterpret_cast<signed char*>(const_cast<char*>(value)), 0,
+                                             static_cast<int>(strlen(value)), Encoding::UTF8);
+        return WriteManaged(managedValue);
     }
     catch (Exception^ ex) {
         StoreExceptionMessage(ex);
@@ -398,9 +2564,15 @@ BridgeResult DataRefWrapper::SetString(const char* value) {
 
 BridgeResult DataRefWrapper::GetDateTime(::DateTime* outValue) {
     if (!outValue) return BRIDGE_ERR_INVALID_ARGUMENT;
+    Touch();
+
+    if (_derived) {
+        StoreTypeMismatch("DateTime");
+        return BRIDGE_ERR_INVALID_DATA;
+    }
 
     try {
-        Object^ val = _dataRef->value;
+        Object^ val = _shared->dataRef->value;
         System::DateTime dt = Convert::ToDateTime(val);
         outValue->year = dt.Year;
         outValue->month = dt.Month;
@@ -423,6 +2595,8 @@ BridgeResult DataRefWrapper::GetDateTime(::DateTime* outValue) {
 
 BridgeResult DataRefWrapper::SetDateTime(const ::DateTime* value) {
     if (!value) return BRIDGE_ERR_INVALID_ARGUMENT;
+    if (_derived) return RejectDerivedWrite();
+    Touch();
 
     try {
         System::DateTime^ dt = gcnew System::DateTime(
@@ -434,7 +2608,7 @@ BridgeResult DataRefWrapper::SetDateTime(const ::DateTime* value) {
             value->second,
             value->millisecond
         );
-        _dataRef->value = dt;
+        _shared->dataRef->value = dt;
         return BRIDGE_OK;
     }
     catch (InvalidData^ ex) {
@@ -449,6 +2623,8 @@ BridgeResult DataRefWrapper::SetDateTime(const ::DateTime* value) {
 
 BridgeResult DataRefWrapper::SetReposition(const ::RepositionData* data) {
     if (!data) return BRIDGE_ERR_INVALID_ARGUMENT;
+    if (_derived) return RejectDerivedWrite();
+    Touch();
 
     try {
         ProSimSDK::RepositionData^ reposition = gcnew ProSimSDK::RepositionData();
@@ -461,7 +2637,7 @@ BridgeResult DataRefWrapper::SetReposition(const ::RepositionData* data) {
         reposition->Ias = data->ias;
         reposition->OnGround = data->on_ground;
 
-        _dataRef->value = reposition;
+        _shared->dataRef->value = reposition;
         return BRIDGE_OK;
     }
     catch (InvalidData^ ex) {
@@ -474,13 +2650,150 @@ BridgeResult DataRefWrapper::SetReposition(const ::RepositionData* data) {
     }
 }
 
+BridgeResult DataRefWrapper::EnableHistory(int32_t capacity, double maxExtrapolationSeconds) {
+    int32_t type = GetValueType();
+    if (capacity > 0 && (type == DATAREF_TYPE_STRING || type == DATAREF_TYPE_DATETIME)) {
+        ProSim_SetLastError("Sample history requires a numeric DataRef");
+        return BRIDGE_ERR_INVALID_DATA;
+    }
+
+    // Charge the connection for the change in ring size before allocating it
+    LONG64 delta = static_cast<LONG64>(SampleHistory::BytesFor(capacity)) - static_cast<LONG64>(_history.Bytes());
+    if (!_connection->ReserveHistoryBytes(delta)) {
+        ProSim_SetLastError("Sample history limit reached (max_history_bytes)");
+        return BRIDGE_ERR_LIMIT_EXCEEDED;
+    }
+    BridgeResult result;
+    try {
+        result = _history.Configure(capacity, maxExtrapolationSeconds);
+    }
+    catch (...) {
+        _connection->ReserveHistoryBytes(-delta);
+        throw;
+    }
+    if (result != BRIDGE_OK) {
+        _connection->ReserveHistoryBytes(-delta);
+        return result;
+    }
+
+    // Samples are recorded from change events, so a lazy DataRef must stay registered
+    SetPin(RegistrationState::PinHistory, capacity > 0);
+    return result;
+}
+
+BridgeResult DataRefWrapper::SampleAt(double time, int32_t mode, double* outValue) {
+    if (!_history.IsEnabled()) {
+        ProSim_SetLastError("Sample history is not enabled for this DataRef");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    BridgeResult result = _history.SampleAt(time, mode, outValue);
+    if (result == BRIDGE_ERR_DATAREF_NOT_READY) {
+        ProSim_SetLastError("No samples recorded yet");
+    }
+    return result;
+}
+
 void DataRefWrapper::SetOnDataChange(DataRefChangeCallback callback, void* userData) {
     _onDataChangeCallback = callback;
     _onDataChangeUserData = userData;
+    SetPin(RegistrationState::PinCallback, callback != nullptr);
 }
 
-void DataRefWrapper::FireOnDataChange() {
-    if (_onDataChangeCallback) {
+void DataRefWrapper::FireOnDataChange(ChangeSample& sample) {
+    if (_derived) {
+        // A shared DataRef counts its own changes before the fan-out
+        InterlockedIncrement(&_changeVersion);
+    }
+
+    bool record = _history.IsEnabled();
+    bool batched = _connection->WantsBatchedChanges();
+    if (record || batched || _feedsDerived) {
+        if (!sample.read) {
+            // Timestamp before reading so the sample reflects arrival time, not callback latency
+            sample.read = true;
+            sample.time = MonotonicClock::Now();
+            if (_derived) {
+                sample.numeric = (ReadDerived(&sample.value) == BRIDGE_OK);
+            }
+            else {
+                try {
+                    sample.numeric = UnboxAsDouble(_shared->dataRef->value, &sample.value);
+                }
+                catch (Exception^) {
+                    // Not ready or not numeric
+                }
+            }
+        }
+        double value = sample.numeric ? sample.value : Double::NaN;
+        if (record && sample.numeric) {
+            _history.Push(sample.time, value);
+        }
+        if (batched) {
+            _connection->RecordChange(static_cast<DataRefHandle>(this), &_changedSlot, value);
+        }
+        if (_feedsDerived) {
+            _connection->OnDerivedInput(_nameId, value);
+        }
+    }
+
+    if (_connection->HasFanout()) {
+        PublishChange();
+    }
+
+    if (_onDataChangeCallback && !_connection->DispatchCallback(*_callbackStrand)) {
         _onDataChangeCallback(static_cast<DataRefHandle>(this), _onDataChangeUserData);
     }
+}
+
+void DataRefWrapper::RunCallback(void* context) {
+    DataRefWrapper* self = static_cast<DataRefWrapper*>(context);
+    DataRefChangeCallback callback = self->_onDataChangeCallback;
+    if (callback) {
+        callback(static_cast<DataRefHandle>(self), self->_onDataChangeUserData);
+    }
+}
+
+void DataRefWrapper::PublishChange() {
+    if (_derived) {
+        double value;
+        if (ReadDerived(&value) == BRIDGE_OK) {
+            _connection->PublishToFanout(_name, BridgeValue::FromDouble(value));
+        }
+        return;
+    }
+
+    try {
+        Object^ val = _shared->dataRef->value;
+        if (val == nullptr) {
+            return;
+        }
+
+        // Bool, int and string keep their type on the wire; other numerics go as double
+        BridgeValue value;
+        int32_t type = (_valueType != DATAREF_TYPE_UNKNOWN) ? _valueType : ValueTypeOf(val);
+        if (type == DATAREF_TYPE_STRING) {
+            ExclusiveLock guard(_utf8Lock);
+            if (RefreshUtf8() != BRIDGE_OK) {
+                return;
+            }
+            value.type = DATAREF_TYPE_STRING;
+            value.stringValue.assign(_utf8.data(), _utf8.size() - 1);
+        }
+        else if (type == DATAREF_TYPE_BOOL && UnboxAsBool(val, &value.boolValue)) {
+            value.type = DATAREF_TYPE_BOOL;
+        }
+        else if (type == DATAREF_TYPE_INT && UnboxAsInt(val, &value.intValue)) {
+            value.type = DATAREF_TYPE_INT;
+        }
+        else if (UnboxAsDouble(val, &value.doubleValue)) {
+            value.type = DATAREF_TYPE_DOUBLE;
+        }
+        else {
+            return; // DateTime and non-numeric objects are not published
+        }
+        _connection->PublishToFanout(_name, value);
+    }
+    catch (Exception^) {
+        // Not ready; the next change publishes
+    }
 }
\ No newline at end of file
@@ -6,11 +6,29 @@
 
 #include <vcclr.h>
 #include <msclr/gcroot.h>
+#include <unordered_map>
+#include <vector>
 #include "ProSimBridge.h"
+#include "NativeSupport.h"
+#include "WritePipeline.h"
+#include "SampleHistory.h"
+#include "TrafficStore.h"
+#include "FailureCatalog.h"
+#include "FailureScenario.h"
+#include "CallbackDispatcher.h"
+#include "SlabPool.h"
+#include "Expression.h"
+#include "Trigger.h"
+#include "Snapshot.h"
+#include "SnapshotDiff.h"
 
 // Forward declarations
 class DataRefWrapper;
+class FanoutServer;
 class ProSimConnectWrapper;
+struct DerivedState;
+struct SharedDataRef;
+struct Trigger;
 
 // ============================================================================
 // Ref class to bridge native callbacks to managed delegates
@@ -25,6 +43,31 @@ public:
 
     void OnConnect();
     void OnDisconnect();
+    void OnDataRefsUpdated();
+    void OnAiTrafficAdded(ProSimSDK::AiTrafficObject^ traffic);
+    void OnAiTrafficRemoved(unsigned int objectId);
+};
+
+// ============================================================================
+// Ref class to bridge armed-failure events to the native failure catalog
+// ============================================================================
+
+ref class FailureEventBridge {
+private:
+    ProSimConnectWrapper* _nativeWrapper;
+
+public:
+    FailureEventBridge(ProSimConnectWrapper* wrapper) : _nativeWrapper(wrapper) {}
+
+    // Called by the wrapper destructor; armed failures may outlive the connection wrapper
+    void Detach() { _nativeWrapper = nullptr; }
+
+    // Subscribes to an armed failure's trigger/remove events and records it as armed
+    void Track(ProSimSDK::ArmedFailure^ armed);
+
+    void OnNew(ProSimSDK::ArmedFailure^ armed);
+    void OnTrigger(ProSimSDK::ArmedFailure^ armed);
+    void OnRemove(ProSimSDK::ArmedFailure^ armed);
 };
 
 // ============================================================================
@@ -33,10 +76,10 @@ public:
 
 ref class DataRefEventBridge {
 private:
-    DataRefWrapper* _nativeWrapper;
+    SharedDataRef* _nativeShared;
 
 public:
-    DataRefEventBridge(DataRefWrapper* wrapper) : _nativeWrapper(wrapper) {}
+    DataRefEventBridge(SharedDataRef* shared) : _nativeShared(shared) {}
 
     void OnDataChange(ProSimSDK::DataRef^ dataRef);
 };
@@ -57,9 +100,127 @@ private:
     ConnectionCallback _onDisconnectCallback;
     void* _onDisconnectUserData;
 
+    // Batched change callback: changes are collected per update cycle and delivered together
+    DataRefsUpdatedCallback _onDataRefsUpdatedCallback;
+    void* _onDataRefsUpdatedUserData;
+    SrwLock _changedLock;               // guards the _changed* arrays
+    std::vector<DataRefHandle> _changedRefs;
+    std::vector<double> _changedValues;
+    std::vector<int32_t*> _changedSlots; // each DataRef's index into _changedRefs, -1 when absent
+    SrwLock _deliverLock;               // one delivery at a time
+    std::vector<DataRefHandle> _deliverRefs;
+    std::vector<double> _deliverValues;
+
+    // Buffered (coalesced) writes, used when enabled with ProSim_SetWriteBuffering
+    WriteCoalescer _writeBuffer;
+
+    // Writer thread for DataRef_Set*Async
+    AsyncWriter _asyncWriter;
+
+    // Native mirror of AI traffic, fed by the traffic events
+    TrafficStore _traffic;
+
+    // Failure catalog, loaded by ProSim_LoadFailureCatalog and kept current by armed-failure events
+    FailureCatalog _failures;
+    msclr::gcroot<FailureEventBridge^> _failureBridge;
+    SrwLock _failureLoadLock;
+
+    // Fan-out server receiving this connection's DataRef changes (not owned)
+    FanoutServer* volatile _fanout;
+    SrwLock _fanoutLock;                // held shared while publishing, exclusive to detach
+
+    // Worker pool for DataRef change callbacks; null runs them inline on the SDK thread
+    CallbackDispatcher* _dispatcher;
+    SrwLock _dispatchLock;              // held shared while dispatching, exclusive to replace
+
+    // SDK priority mode is on while either the application or the async writer wants it
+    SrwLock _priorityLock;
+    bool _userPriority;
+    bool _writerPriority;
+
+    // DataRef catalog (name -> description), loaded on first lookup while connected
+    msclr::gcroot<System::Collections::Generic::Dictionary<System::String^, ProSimSDK::DataRefDescription^>^> _descriptions;
+
+    // Storage for this connection's DataRef wrappers and their interned names. The pool is
+    // handed to the DataRef handles still alive when the connection is destroyed, and the
+    // last of their DataRef_Destroy calls deletes it.
+    SlabPool* _dataRefPool;
+    NameArena _names;
+
+    // Every DataRef wrapper created on this connection, released by the destructor if the
+    // application has not destroyed it; each wrapper knows its position
+    SrwLock _liveLock;
+    std::vector<DataRefWrapper*> _liveRefs;
+
+    // One SDK DataRef per name, shared by every DataRef handle created for it (see SharedDataRef)
+    SrwLock _sharedLock;                // guards the map and every SharedDataRef's refs
+    std::unordered_map<uint32_t, SharedDataRef*> _sharedRefs;   // by name id
+
+    // Derived DataRefs (DataRef_CreateDerived). Each input is an internal DataRef shared by
+    // every derived DataRef that reads it; its changes mark the readers dirty, and dirty
+    // readers are evaluated once at the end of the SDK update cycle.
+    struct DerivedInput {
+        DataRefWrapper* wrapper;
+        std::vector<std::pair<DataRefWrapper*, uint32_t>> readers;   // derived DataRef, input index
+    };
+    SrwLock _derivedSetupLock;          // serializes adding and removing derived DataRefs
+    SrwLock _derivedLock;               // guards the maps, the dirty list and every DerivedState's inputs
+    std::unordered_map<uint32_t, DerivedInput> _derivedInputs;      // by input name id
+    std::unordered_map<uint32_t, DataRefWrapper*> _derivedByName;   // by derived name id
+    std::vector<DataRefWrapper*> _dirtyDerived;
+    SrwLock _derivedNotifyLock;         // held while changed derived DataRefs are notified
+    std::vector<DataRefWrapper*> _notifyingDerived;
+    volatile DWORD _derivedNotifyThread;
+
+    // Triggers (Trigger_Create) whose inputs changed or whose delay is running; they are
+    // checked in the same pass as derived DataRefs. Guarded by _derivedNotifyLock.
+    std::vector<Trigger*> _pendingTriggers;
+    std::vector<std::pair<Trigger*, bool>> _firingTriggers;     // trigger, new state
+
+    static const Expression* ResolveDerived(const char* name, void* context);
+
+    // Lazy registration (ProSim_SetLazyRegistration). Lazy DataRefs register on first use;
+    // the sweeper unregisters the idle ones among those in _lazyRegistered.
+    SrwLock _registrationLock;          // guards every DataRef's registration state and the list
+    std::vector<SharedDataRef*> _lazyRegistered;
+    volatile LONG _lazyRegistration;
+    volatile LONG _idleTtlMs;           // 0 = never unregister
+    NativeThread _idleSweeper;
+    SrwLock _sweeperLock;               // serializes starting and stopping the sweeper and tuner
+
+    static void SweeperMain(NativeThread* thread, void* context);
+    BridgeResult RegisterLocked(SharedDataRef* ref);
+    void UnregisterIdle();
+
+    // Adaptive polling intervals (ProSim_SetAdaptiveIntervals). The tuner reviews each DataRef
+    // in _adaptiveRefs once per window; the list is guarded by _registrationLock.
+    std::vector<SharedDataRef*> _adaptiveRefs;
+    volatile LONG _adaptiveIntervals;
+    volatile LONG _minIntervalMs;
+    volatile LONG _maxIntervalMs;
+    volatile LONG _reviewWindowMs;
+    NativeThread _intervalTuner;
+
+    static void TunerMain(NativeThread* thread, void* context);
+    void ReviewIntervals(DWORD elapsedMs);
+
+    // Memory accounting for ProSim_GetMemoryStats; DataRef and name caps live in their allocators
+    volatile LONG64 _historyBytes;      // sample history rings of this connection's DataRefs
+    volatile LONG64 _historyLimit;      // cap on _historyBytes, 0 = unlimited
+    volatile LONG64 _cacheBytes;        // DataRef string caches
+
     // Flag to prevent double-free
     bool _disposed;
 
+    bool LoadDescriptions();
+
+    // Releases the DataRef handles the application has not destroyed (destructor only)
+    void ReleaseLiveDataRefs();
+
+    // Writes the given snapshot values back to back, counting them in result
+    BridgeResult WriteSnapshotValues(const std::vector<const SimSnapshot::Entry*>& values,
+                                     SnapshotRestoreResult* result);
+
 public:
     ProSimConnectWrapper();
     ~ProSimConnectWrapper();
@@ -68,54 +229,466 @@ public:
     BridgeResult Connect(const char* host, bool synchronous);
     bool IsConnected();
     void SetPriorityMode(bool priority);
+    void SetWriterPriority(bool priority);
 
     // Callback registration
     void SetOnConnect(ConnectionCallback callback, void* userData);
     void SetOnDisconnect(ConnectionCallback callback, void* userData);
+    void SetOnDataRefsUpdated(DataRefsUpdatedCallback callback, void* userData);
+
+    // Batched changes; slot is the DataRef's own index storage, initially -1
+    bool WantsBatchedChanges() const { return _onDataRefsUpdatedCallback != nullptr; }
+    void RecordChange(DataRefHandle handle, int32_t* slot, double value);
+    void ForgetChange(int32_t* slot);
 
     // Access to managed connection (for DataRef creation)
     ProSimSDK::ProSimConnect^ GetManagedConnection() { return _connection; }
 
+    // Write buffering
+    WriteCoalescer& GetWriteBuffer() { return _writeBuffer; }
+    AsyncWriter& GetAsyncWriter() { return _asyncWriter; }
+
+    // AI traffic
+    TrafficStore& GetTraffic() { return _traffic; }
+
+    // DataRef storage (see DataRefWrapper::Create)
+    SlabPool& GetDataRefPool() { return *_dataRefPool; }
+    NameArena& GetNames() { return _names; }
+
+    // Adds a constructed wrapper to, or removes it from, the connection's live list
+    void TrackDataRef(DataRefWrapper* wrapper);
+    void UntrackDataRef(DataRefWrapper* wrapper);
+
+    // Adds view to the shared DataRef for nameId, creating it on first use, registering it if
+    // asked and lowering its interval to the view's; throws if the SDK DataRef cannot be created
+    SharedDataRef* AcquireShared(DataRefWrapper* view, const char* name, uint32_t nameId, int interval, bool registerNow);
+
+    // Removes view (which asked for interval); the last view destroys the shared DataRef
+    void ReleaseShared(SharedDataRef* shared, DataRefWrapper* view, int32_t interval);
+
+    // Failures
+    BridgeResult LoadFailureCatalog();
+    FailureCatalog& GetFailureCatalog() { return _failures; }
+    void ApplyArmedFailure(ProSimSDK::ArmedFailure^ armed, int32_t state);
+    BridgeResult ArmFailureScenario(const FailureScenario& scenario, FailureScenarioResult* result);
+
+    // Snapshots: capture reads every DataRef the catalog marks readable and writable;
+    // restore writes the entries whose value differs from the simulator's; applying a diff
+    // writes its after values without reading first
+    BridgeResult CaptureSnapshot(SimSnapshot& snapshot);
+    BridgeResult RestoreSnapshot(const SimSnapshot& snapshot, SnapshotRestoreResult* result);
+    BridgeResult ApplySnapshotDiff(const SnapshotDiff& diff, SnapshotRestoreResult* result);
+
+    // Fan-out; after SetFanout returns, no publish to the previous server is in progress
+    void SetFanout(FanoutServer* server);
+    bool HasFanout() const { return _fanout != nullptr; }
+    void PublishToFanout(const char* name, const BridgeValue& value);
+
+    // Derived DataRefs; expressions may use existing derived DataRefs, which are inlined
+    BridgeResult CompileDerived(Expression& expression, const char* source);
+    BridgeResult AddDerived(DataRefWrapper* derived, int interval);
+    void RemoveDerived(DataRefWrapper* derived);
+    void OnDerivedInput(uint32_t nameId, double value);
+
+    // Lazy registration; pins keep a lazy DataRef registered however long it is idle
+    BridgeResult SetLazyRegistration(bool enabled, int32_t idleTtlMs);
+    bool IsLazyRegistration() const { return _lazyRegistration != 0; }
+    BridgeResult EnsureRegistered(SharedDataRef* ref);
+    void ForgetRegistration(SharedDataRef* ref);
+
+    // Sets or clears pin among a view's pins (guarded here); the DataRef stays registered
+    // while any of its views holds a pin
+    void SetRegistrationPin(SharedDataRef* ref, uint32_t* pins, uint32_t pin, bool pinned);
+
+    // Adaptive polling intervals (NULL options stops adjusting them)
+    BridgeResult SetAdaptiveIntervals(const AdaptiveIntervalOptions* options);
+    bool IsAdaptiveIntervals() const { return _adaptiveIntervals != 0; }
+    int32_t ClampInterval(int32_t interval) const;
+    void TrackAdaptive(SharedDataRef* ref);
+
+    // Triggers; returns null (with the last error set) on failure
+    Trigger* CreateTrigger(const TriggerOptions& options, TriggerCallback callback, void* userData);
+    void DestroyTrigger(Trigger* trigger);
+
+    // Memory accounting and caps (NULL limits removes them)
+    void GetMemoryStats(MemoryStats* stats);
+    // Rejects negative limits (including byte limits past INT64_MAX) with BRIDGE_ERR_INVALID_ARGUMENT
+    BridgeResult SetMemoryLimits(const MemoryLimits* limits);
+
+    // Adds bytes (negative to release); returns false, adding nothing, if the history cap
+    // would be exceeded
+    bool ReserveHistoryBytes(LONG64 bytes);
+    void AdjustCacheBytes(LONG64 bytes) { InterlockedExchangeAdd64(&_cacheBytes, bytes); }
+
+    // Callback dispatch (NULL options runs callbacks inline)
+    BridgeResult SetCallbackDispatch(const CallbackDispatchOptions* options);
+
+    // Queues a DataRef's callback on the pool; returns false when callbacks run inline
+    bool DispatchCallback(CallbackDispatcher::Strand& strand);
+
+    // Looks up the declared DataType of a DataRef in the SDK catalog
+    // Returns one of the DATAREF_TYPE_* values, DATAREF_TYPE_UNKNOWN if unavailable
+    int32_t GetDeclaredValueType(const char* name);
+
     // Called by the event bridge
     void FireOnConnect();
     void FireOnDisconnect();
+    void FireOnDataRefsUpdated();
+
+private:
+    // Evaluates dirty derived DataRefs and notifies those whose value changed, then
+    // advances pending triggers and reports their transitions
+    void EvaluateDerived();
+    void CheckTriggers();
+};
+
+// ============================================================================
+// DerivedState
+// Compiled expression and current inputs of a derived DataRef
+// ============================================================================
+
+struct DerivedState {
+    Expression expression;
+    Trigger* trigger;                   // set on a trigger's unnamed condition and release DataRefs
+
+    // Guarded by the connection's _derivedLock
+    std::vector<uint32_t> inputIds;     // name id of each expression input
+    std::vector<double> inputs;         // latest value of each input (NaN if not numeric)
+    std::vector<bool> seen;             // whether each input has had a value
+    size_t missing;                     // inputs that have not had a value yet
+    bool dirty;                         // queued for evaluation this cycle
+
+    SrwLock valueLock;                  // guards value and ready
+    double value;
+    bool ready;
+
+    DerivedState() : trigger(nullptr), missing(0), dirty(false), value(0.0), ready(false) {}
+
+    // Evaluates the expression once every input has a value; returns true if the value
+    // changed (caller holds the connection's _derivedLock)
+    bool Recompute();
+
+    // Whether the value is non-zero; false until every input has a value, and for NaN
+    bool IsTrue();
+};
+
+// ============================================================================
+// Trigger
+// Edge-triggered condition over DataRefs; its expressions are unnamed derived DataRefs
+// ============================================================================
+
+struct Trigger {
+    ProSimConnectWrapper* connection;
+    DataRefWrapper* condition;
+    DataRefWrapper* release;            // null: the trigger releases when condition is false
+    TriggerCallback callback;
+    void* userData;
+
+    // Guarded by the connection's _derivedNotifyLock
+    TriggerState state;
+    bool pending;                       // listed in the connection's _pendingTriggers
+
+    volatile LONG active;               // last state reported, for Trigger_IsActive
+
+    Trigger(ProSimConnectWrapper* owner, const TriggerOptions& options, TriggerCallback onChange, void* data)
+        : connection(owner)
+        , condition(nullptr)
+        , release(nullptr)
+        , callback(onChange)
+        , userData(data)
+        , state(options.on_delay_ms / 1000.0, options.off_delay_ms / 1000.0)
+        , pending(false)
+        , active(0)
+    {
+    }
+};
+
+// ============================================================================
+// RegistrationState
+// SDK registration and polling interval of a shared DataRef; lastUse and uses aside, guarded
+// by the connection's _registrationLock
+// ============================================================================
+
+struct RegistrationState {
+    enum {
+        PinCallback = 1,                // a change callback is set
+        PinHistory = 2,                 // sample history is enabled
+        PinDerivedInput = 4             // feeds derived DataRefs or triggers
+    };
+
+    bool lazy;                          // registered on use and unregistered when idle
+    volatile LONG registered;
+    volatile DWORD lastUse;             // GetTickCount at the last read or write
+    uint32_t pinnedViews;               // views holding a Pin* reason to stay registered
+    int32_t slot;                       // index in the connection's _lazyRegistered, -1 = absent
+
+    bool adaptive;                      // polling interval tuned by the connection
+    int32_t interval;                   // current polling interval in milliseconds
+    std::vector<int32_t> requested;     // interval each view asked for; the fastest applies
+    volatile LONG uses;                 // reads and writes since the last review (approximate)
+    LONG reviewedVersion;               // change version at the last review
+    int32_t adaptiveSlot;               // index in the connection's _adaptiveRefs, -1 = absent
+
+    RegistrationState()
+        : lazy(false), registered(0), lastUse(0), pinnedViews(0), slot(-1)
+        , adaptive(false), interval(0), uses(0), reviewedVersion(0), adaptiveSlot(-1) {}
+};
+
+// ============================================================================
+// ChangeSample
+// Value of one change, read by the first DataRef handle that needs it and reused by the rest
+// ============================================================================
+
+struct ChangeSample {
+    bool read;
+    bool numeric;                       // value holds the change (false: not ready or not numeric)
+    double time;                        // MonotonicClock::Now at arrival
+    double value;
+
+    ChangeSample() : read(false), numeric(false), time(0.0), value(0.0) {}
+};
+
+// ============================================================================
+// SharedDataRef
+// The one managed DataRef behind every handle a connection created for a name. It is
+// registered at the fastest interval its views asked for, and its change event is fanned
+// out to the views natively, so SDK registrations and event work scale with distinct names.
+// ============================================================================
+
+struct SharedDataRef {
+    ProSimConnectWrapper* connection;
+    msclr::gcroot<ProSimSDK::DataRef^> dataRef;
+    msclr::gcroot<DataRefEventBridge^> eventBridge;
+
+    // Replacement registered by ApplyInterval. Until its first change arrives, dataRef keeps
+    // serving reads and writes with the last value; null when no interval change is pending.
+    msclr::gcroot<ProSimSDK::DataRef^> pendingRef;
+    SrwLock refLock;                    // guards dataRef and pendingRef swaps; held for no SDK call
+
+    // The active DataRef was disposed to unregister it (the SDK's unRegister is internal) and
+    // cannot be registered again; guarded by the connection's _registrationLock
+    bool disposed;
+
+    const char* name;
+    uint32_t nameId;
+    int32_t declaredType;               // DATAREF_TYPE_* from the catalog, seeds each view
+
+    size_t refs;                        // views; guarded by the connection's _sharedLock
+
+    SrwLock notifyLock;                 // held while a change fans out, and to add or remove views
+    std::vector<DataRefWrapper*> views;
+    std::vector<DataRefWrapper*> firing; // views being notified; removed ones are nulled
+    volatile DWORD notifyThread;        // thread fanning out, 0 when none
+    bool retired;                       // last view released during the fan-out, which deletes this
+
+    volatile LONG changeVersion;        // changes seen, for the interval tuner
+    volatile LONG consumed;             // whether a view consumed every change at the last one
+
+    RegistrationState registration;
+
+    // Creates the managed DataRef, unregistered, at interval (clamped when adaptive)
+    SharedDataRef(ProSimConnectWrapper* owner, const char* refName, uint32_t refNameId, int interval);
+
+    // Unsubscribes and disposes the managed DataRef
+    ~SharedDataRef();
+
+    // The DataRef subscribed to and registered with the SDK: pendingRef if set, else dataRef
+    ProSimSDK::DataRef^ ActiveRef();
+
+    // Makes a pending replacement the DataRef values are read from, once it has changed
+    void PromotePending(ProSimSDK::DataRef^ changed);
+
+    void AddView(DataRefWrapper* view);
+    void RemoveView(DataRefWrapper* view);
+
+    // Notes a read or write through a view; registers a lazy DataRef that is not registered
+    void Touch() {
+        if (registration.adaptive) {
+            // Racing readers may lose a count; the tuner only needs the rate
+            registration.uses = registration.uses + 1;
+        }
+        if (registration.lazy) {
+            registration.lastUse = GetTickCount();
+            if (!registration.registered) {
+                connection->EnsureRegistered(this);
+            }
+        }
+    }
+
+    // Registers or unregisters with the SDK (caller holds the connection's _registrationLock).
+    // Unregistering disposes the active DataRef; registering again replaces it first.
+    BridgeResult ApplyRegistration(bool registered);
+
+    // Moves the change subscription to a new unregistered DataRef at interval, which becomes
+    // pendingRef; returns the DataRef it replaces (caller holds the connection's
+    // _registrationLock)
+    ProSimSDK::DataRef^ Replace(int32_t interval);
+
+    // Changes the polling interval by replacing the SDK DataRef, whose interval is fixed at
+    // construction, and re-registering if registered (caller holds the connection's
+    // _registrationLock)
+    BridgeResult ApplyInterval(int32_t interval);
+
+    // Called by the event bridge
+    void FireOnDataChange();
 };
 
 // ============================================================================
 // DataRefWrapper
-// Native class that wraps a managed DataRef instance
+// Native DataRef handle: a view onto its connection's SharedDataRef for the name, or a
+// derived DataRef computed locally
 // ============================================================================
 
 class DataRefWrapper {
 private:
-    msclr::gcroot<ProSimSDK::DataRef^> _dataRef;
-    msclr::gcroot<DataRefEventBridge^> _eventBridge;
+    // SDK DataRef this handle views; null for derived DataRefs
+    SharedDataRef* _shared;
+
+    // Polling interval this handle asked for
+    int32_t _interval;
+
+    // RegistrationState::Pin* reasons this handle keeps the shared DataRef registered
+    uint32_t _pins;
+
+    // Owning connection; null once the connection was destroyed before this handle
+    ProSimConnectWrapper* _connection;
+
+    // Pool holding this wrapper, which outlives the connection while orphaned handles remain
+    SlabPool* _pool;
+
+    // Position in the connection's live list (-1 = not listed)
+    int32_t _liveSlot;
 
     // Native callback storage
     DataRefChangeCallback _onDataChangeCallback;
     void* _onDataChangeUserData;
 
-    // Store the name for C access
-    char* _nameBuffer;
+    // Serializes this DataRef's callbacks when the connection dispatches them to a pool;
+    // retired on release, which may leave it to the worker holding it to free
+    CallbackDispatcher::Strand* _callbackStrand;
+
+    // Position in the connection's batched change list for the current cycle (-1 = none)
+    int32_t _changedSlot;
+
+    // Name for C access, interned in the connection's name arena, and its id there
+    const char* _name;
+    uint32_t _nameId;
+
+    // Runtime value type (DATAREF_TYPE_*), learned once from the catalog or the first value
+    int32_t _valueType;
+
+    // Expression state of a derived DataRef (owned), null for SDK DataRefs
+    DerivedState* _derived;
+
+    // Set on the internal DataRefs that feed derived DataRefs
+    bool _feedsDerived;
+
+    // Notes a read or write on the shared DataRef
+    void Touch() {
+        if (_shared) {
+            _shared->Touch();
+        }
+    }
+
+    // Sets or clears one of this handle's registration pins
+    void SetPin(uint32_t pin, bool pinned);
+
+    // Incremented on every value change; starts at 1 so a caller version of 0 is always stale.
+    // Handles for one name use their shared DataRef's version, so a write through one is seen
+    // by the others; this one counts a derived DataRef's changes.
+    volatile LONG _changeVersion;
+    volatile LONG& ChangeVersion() { return _shared ? _shared->changeVersion : _changeVersion; }
+
+    // UTF-8 encoding of the current value, valid for _utf8Version
+    std::vector<char> _utf8;
+    LONG _utf8Version;
+    SrwLock _utf8Lock;
+
+    // Timestamped values recorded on change, when enabled with DataRef_EnableHistory
+    SampleHistory _history;
 
     // Flag to prevent double-free
     bool _disposed;
 
-public:
-    DataRefWrapper(const char* name, int interval, ProSimConnectWrapper* connection, bool registerNow);
+    // Releases everything the wrapper holds on its connection; the destructor and the
+    // connection's destructor call it, and only the first call does anything
+    void Release();
+
+    // Typed read path helpers
+    static int32_t ValueTypeOf(System::Object^ value);
+    bool UnboxAsDouble(System::Object^ value, double* outValue);
+    bool UnboxAsInt(System::Object^ value, int32_t* outValue);
+    bool UnboxAsBool(System::Object^ value, bool* outValue);
+    static bool RoundToInt(double value, int32_t* outValue);
+    void StoreTypeMismatch(const char* requested);
+    BridgeResult ReadDerived(double* outValue);
+    BridgeResult RejectDerivedWrite();
+    void PublishChange();
+    static void RunCallback(void* context);
+
+    // Re-encodes _utf8 if the value changed since the last encode (caller holds _utf8Lock)
+    BridgeResult RefreshUtf8();
+    BridgeResult CopyUtf8(char* buffer, int32_t bufferSize);
+
+    // Assigns the managed value synchronously; touch counts it as a use (which registers a
+    // lazy DataRef). A failure's message is also copied to error when one is given.
+    BridgeResult WriteManaged(System::Object^ value, bool touch = true, char* error = nullptr, size_t errorSize = 0);
+
+    // Wrappers live in their connection's slab pool; use Create and Destroy
+    // (name must already be interned as nameId)
+    DataRefWrapper(const char* name, uint32_t nameId, int interval, ProSimConnectWrapper* connection, bool registerNow);
+    DataRefWrapper(const char* name, uint32_t nameId, ProSimConnectWrapper* connection, DerivedState* derived);
     ~DataRefWrapper();
 
-    // Registration
+    // Takes a block from the connection's pool; null (with the last error set) at the DataRef limit
+    static void* AllocateBlock(ProSimConnectWrapper* connection);
+    static DataRefWrapper* Construct(const char* name, uint32_t nameId, int interval,
+                                     ProSimConnectWrapper* connection, bool registerNow);
+
+public:
+    static DataRefWrapper* Create(const char* name, int interval, ProSimConnectWrapper* connection, bool registerNow);
+    // Returns null (with the last error set) if nameId was not issued by the connection
+    static DataRefWrapper* CreateById(uint32_t nameId, int interval, ProSimConnectWrapper* connection, bool registerNow);
+    // Returns null (with the last error set) if the expression does not compile; interval
+    // applies to the input DataRefs it creates. A trigger's expressions pass the trigger and
+    // are not registered under their name.
+    static DataRefWrapper* CreateDerived(const char* name, const char* expression, int interval,
+                                         ProSimConnectWrapper* connection, Trigger* trigger = nullptr);
+    static void Destroy(DataRefWrapper* wrapper);
+
+    // Releases the handle because its connection is being destroyed first; a later
+    // DataRef_Destroy only frees its block
+    void Orphan();
+    bool IsOrphaned() const { return _connection == nullptr; }
+
+    // Position in the connection's live list, maintained by the connection
+    int32_t& LiveSlot() { return _liveSlot; }
+
+    // Derived DataRefs
+    DerivedState* GetDerived() { return _derived; }
+    void MarkDerivedInput();
+    bool FeedsDerived() const { return _feedsDerived; }
+
+    // Registration of the shared DataRef; Register does nothing if it is already registered
     BridgeResult Register();
+    int32_t GetInterval() const { return _shared ? _shared->registration.interval : _interval; }
+
+    // Whether something other than a read consumes every change
+    bool HasChangeConsumers();
 
     // Name access
     const char* GetName();
+    uint32_t GetNameId() const { return _nameId; }
+
+    // Value type access (DATAREF_TYPE_*)
+    int32_t GetValueType();
 
     // Value getters
     BridgeResult GetInt(int32_t* outValue);
     BridgeResult GetDouble(double* outValue);
     BridgeResult GetBool(bool* outValue);
     BridgeResult GetString(char* buffer, int32_t bufferSize);
+    BridgeResult GetStringIfChanged(char* buffer, int32_t bufferSize, uint32_t* inOutVersion);
     BridgeResult GetDateTime(DateTime* outValue);
 
     // Value setters
@@ -126,9 +699,22 @@ public:
     BridgeResult SetDateTime(const DateTime* value);
     BridgeResult SetReposition(const RepositionData* data);
 
+    // Queues a write on the connection's writer thread (priority is WRITE_PRIORITY_*)
+    BridgeResult SetAsync(const BridgeValue& value, int32_t priority, WriteToken* outToken);
+
+    // Writes a staged value synchronously (used by the write pipeline). Snapshot writes pass
+    // touch = false so that a write-only handle does not register its DataRef. On failure the
+    // message is copied to error, if given, as well as to the last error.
+    BridgeResult WriteValue(const BridgeValue& value, bool touch = true, char* error = nullptr, size_t errorSize = 0);
+
+    // Sample history
+    BridgeResult EnableHistory(int32_t capacity, double maxExtrapolationSeconds);
+    BridgeResult SampleAt(double time, int32_t mode, double* outValue);
+
     // Callback registration
     void SetOnDataChange(DataRefChangeCallback callback, void* userData);
 
-    // Called by the event bridge
-    void FireOnDataChange();
+    // Called by the shared DataRef's fan-out and by derived evaluation; sample is filled by
+    // the first view that needs the value
+    void FireOnDataChange(ChangeSample& sample);
 };
\ No newline at end of file
@@ -0,0 +1,165 @@
+// NativeSupport.h
+// Small native helpers shared by the wrapper layer
+// <mutex> and <thread> are not available when compiling with /clr, so these wrap
+// the Win32 primitives directly
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+// ============================================================================
+// SrwLock
+// Slim reader/writer lock with RAII guards
+// ============================================================================
+
+class SrwLock {
+private:
+    SRWLOCK _lock;
+
+    SrwLock(const SrwLock&) = delete;
+    SrwLock& operator=(const SrwLock&) = delete;
+
+public:
+    SrwLock() { InitializeSRWLock(&_lock); }
+
+    void LockExclusive() { AcquireSRWLockExclusive(&_lock); }
+    void UnlockExclusive() { ReleaseSRWLockExclusive(&_lock); }
+    void LockShared() { AcquireSRWLockShared(&_lock); }
+    void UnlockShared() { ReleaseSRWLockShared(&_lock); }
+
+    PSRWLOCK Native() { return &_lock; }
+};
+
+class ExclusiveLock {
+private:
+    SrwLock& _lock;
+
+    ExclusiveLock(const ExclusiveLock&) = delete;
+    ExclusiveLock& operator=(const ExclusiveLock&) = delete;
+
+public:
+    explicit ExclusiveLock(SrwLock& lock) : _lock(lock) { _lock.LockExclusive(); }
+    ~ExclusiveLock() { _lock.UnlockExclusive(); }
+};
+
+class SharedLock {
+private:
+    SrwLock& _lock;
+
+    SharedLock(const SharedLock&) = delete;
+    SharedLock& operator=(const SharedLock&) = delete;
+
+public:
+    explicit SharedLock(SrwLock& lock) : _lock(lock) { _lock.LockShared(); }
+    ~SharedLock() { _lock.UnlockShared(); }
+};
+
+// ============================================================================
+// ConditionVariable
+// Condition variable used together with an exclusively held SrwLock
+// ============================================================================
+
+class ConditionVariable {
+private:
+    CONDITION_VARIABLE _cv;
+
+    ConditionVariable(const ConditionVariable&) = delete;
+    ConditionVariable& operator=(const ConditionVariable&) = delete;
+
+public:
+    ConditionVariable() { InitializeConditionVariable(&_cv); }
+
+    // Atomically releases the lock and waits; returns false on timeout
+    bool Wait(SrwLock& lock, DWORD timeoutMs) {
+        return SleepConditionVariableSRW(&_cv, lock.Native(), timeoutMs, 0) != FALSE;
+    }
+
+    void NotifyOne() { WakeConditionVariable(&_cv); }
+    void NotifyAll() { WakeAllConditionVariable(&_cv); }
+};
+
+// ============================================================================
+// MonotonicClock
+// High-resolution monotonic time in seconds (QueryPerformanceCounter)
+// ============================================================================
+
+class MonotonicClock {
+public:
+    static double Now() {
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+        return static_cast<double>(counter.QuadPart) / static_cast<double>(frequency.QuadPart);
+    }
+};
+
+// ============================================================================
+// NativeThread
+// Worker thread with a stop event; Stop() signals the thread and joins it
+// ============================================================================
+
+class NativeThread {
+public:
+    typedef void (*Proc)(NativeThread* thread, void* context);
+
+private:
+    HANDLE _thread;
+    HANDLE _stopEvent;
+    Proc _proc;
+    void* _context;
+
+    NativeThread(const NativeThread&) = delete;
+    NativeThread& operator=(const NativeThread&) = delete;
+
+    static DWORD WINAPI ThreadMain(LPVOID param) {
+        NativeThread* self = static_cast<NativeThread*>(param);
+        self->_proc(self, self->_context);
+        return 0;
+    }
+
+public:
+    NativeThread() : _thread(nullptr), _stopEvent(nullptr), _proc(nullptr), _context(nullptr) {}
+    ~NativeThread() { Stop(); }
+
+    bool Start(Proc proc, void* context) {
+        if (_thread) return false;
+        _proc = proc;
+        _context = context;
+        _stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (!_stopEvent) return false;
+        _thread = CreateThread(nullptr, 0, &NativeThread::ThreadMain, this, 0, nullptr);
+        if (!_thread) {
+            CloseHandle(_stopEvent);
+            _stopEvent = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void Stop() {
+        if (!_thread) return;
+        SetEvent(_stopEvent);
+        if (GetCurrentThreadId() != GetThreadId(_thread)) {
+            WaitForSingleObject(_thread, INFINITE);
+        }
+        CloseHandle(_thread);
+        CloseHandle(_stopEvent);
+        _thread = nullptr;
+        _stopEvent = nullptr;
+    }
+
+    // Waits up to timeoutMs; returns true once Stop() has been requested
+    bool WaitForStop(DWORD timeoutMs) {
+        return WaitForSingleObject(_stopEvent, timeoutMs) == WAIT_OBJECT_0;
+    }
+
+    bool IsRunning() const { return _thread != nullptr; }
+    HANDLE Handle() const { return _thread; }
+};
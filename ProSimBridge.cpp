@@ -1,6 +1,10 @@
 #include "pch.h"
 #include "ProSimBridge.h"
 #include "ManagedWrapper.h"
+#include "Geometry.h"
+#include "ConnectionPool.h"
+#include "FanoutServer.h"
+#include "WireFormat.h"
 
 using namespace System;
 using namespace System::Runtime::InteropServices;
@@ -10,9 +14,10 @@ using namespace ProSimSDK;
 // Error Message Storage
 // ============================================================================
 
-// Static storage for error messages (not thread-safe, but acceptable)
+// Per-thread storage for error messages, so concurrent instances (and the pool's
+// seat workers) do not overwrite each other's errors
 #pragma managed(push, off)
-static char g_lastError[1024] = "";
+static __declspec(thread) char g_lastError[1024] = "";
 
 static void SetLastError(const char* msg) {
     if (msg) {
@@ -23,6 +28,26 @@ static void SetLastError(const char* msg) {
 }
 #pragma managed(pop)
 
+// A handle orphaned by ProSim_Destroy has no connection or SDK DataRef left, so every
+// call but DataRef_Destroy is refused instead of touching them
+static bool RejectOrphanedDataRef(DataRefHandle handle) {
+    if (!static_cast<DataRefWrapper*>(handle)->IsOrphaned()) {
+        return false;
+    }
+    SetLastError("DataRef was released with its connection");
+    return true;
+}
+
+// Splits a snapshot diff value into SnapshotDiffEntry fields: numbers as doubles, strings
+// by pointer into the diff
+static void FlattenDiffValue(const BridgeValue& value, int32_t* type, double* number, const char** str) {
+    *type = value.type;
+    *number = (value.type == DATAREF_TYPE_INT) ? value.intValue :
+              (value.type == DATAREF_TYPE_DOUBLE) ? value.doubleValue :
+              (value.type == DATAREF_TYPE_BOOL && value.boolValue) ? 1.0 : 0.0;
+    *str = (value.type == DATAREF_TYPE_STRING) ? value.stringValue.c_str() : nullptr;
+}
+
 // ============================================================================
 // C API Implementation
 // ============================================================================
@@ -323,7 +348,81 @@ extern "C" {
 
         try {
             auto connWrapper = static_cast<ProSimConnectWrapper*>(connection);
-            auto wrapper = new DataRefWrapper(name, interval, connWrapper, register_now);
+            auto wrapper = DataRefWrapper::Create(name, interval, connWrapper, register_now);
+            return static_cast<DataRefHandle>(wrapper);
+        }
+        catch (Exception^ ex) {
+            String^ message = ex->Message;
+            IntPtr ptr = Marshal::StringToHGlobalAnsi(message);
+            try {
+                SetLastError(static_cast<const char*>(ptr.ToPointer()));
+            }
+            finally {
+                Marshal::FreeHGlobal(ptr);
+            }
+            return nullptr;
+        }
+        catch (...) {
+            SetLastError("Unknown error creating DataRef");
+            return nullptr;
+        }
+    }
+
+    BridgeResult ProSim_InternName(void* instance, const char* name, uint32_t* out_id) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!name || !out_id) {
+            SetLastError("Null name or output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            if (!wrapper->GetNames().Intern(name, out_id)) {
+                SetLastError("Name storage limit reached (max_name_bytes)");
+                return BRIDGE_ERR_LIMIT_EXCEEDED;
+            }
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error interning name");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_GetInternedName(void* instance, uint32_t id, const char** out_name) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_name) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+        const char* name = wrapper->GetNames().Name(id);
+        if (!name) {
+            SetLastError("Unknown name id");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        *out_name = name;
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    DataRefHandle DataRef_CreateById(uint32_t name_id, int32_t interval, void* connection, bool register_now) {
+        if (!connection) {
+            SetLastError("Null connection handle");
+            return nullptr;
+        }
+
+        try {
+            auto connWrapper = static_cast<ProSimConnectWrapper*>(connection);
+            auto wrapper = DataRefWrapper::CreateById(name_id, interval, connWrapper, register_now);
             return static_cast<DataRefHandle>(wrapper);
         }
         catch (Exception^ ex) {
@@ -343,14 +442,45 @@ extern "C" {
         }
     }
 
+    DataRefHandle DataRef_CreateDerived(const char* name, const char* expression, int32_t interval, void* connection) {
+        if (!name || !expression) {
+            SetLastError("Null DataRef name or expression");
+            return nullptr;
+        }
+        if (!connection) {
+            SetLastError("Null connection handle");
+            return nullptr;
+        }
+
+        try {
+            auto connWrapper = static_cast<ProSimConnectWrapper*>(connection);
+            auto wrapper = DataRefWrapper::CreateDerived(name, expression, interval, connWrapper);
+            return static_cast<DataRefHandle>(wrapper);
+        }
+        catch (Exception^ ex) {
+            String^ message = ex->Message;
+            IntPtr ptr = Marshal::StringToHGlobalAnsi(message);
+            try {
+                SetLastError(static_cast<const char*>(ptr.ToPointer()));
+            }
+            finally {
+                Marshal::FreeHGlobal(ptr);
+            }
+            return nullptr;
+        }
+        catch (...) {
+            SetLastError("Unknown error creating derived DataRef");
+            return nullptr;
+        }
+    }
+
     void DataRef_Destroy(DataRefHandle handle) {
         if (!handle) {
             return;
         }
 
         try {
-            auto wrapper = static_cast<DataRefWrapper*>(handle);
-            delete wrapper;
+            DataRefWrapper::Destroy(static_cast<DataRefWrapper*>(handle));
         }
         catch (...) {
             // Ignore exceptions during cleanup
@@ -362,6 +492,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -390,11 +523,77 @@ extern "C" {
         }
     }
 
+    BridgeResult ProSim_SetLazyRegistration(void* instance, bool enabled, int32_t idle_ttl_ms) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->SetLazyRegistration(enabled, idle_ttl_ms);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error configuring lazy registration");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_SetAdaptiveIntervals(void* instance, const AdaptiveIntervalOptions* options) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->SetAdaptiveIntervals(options);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error configuring adaptive intervals");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult DataRef_GetInterval(DataRefHandle handle, int32_t* out_interval_ms) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+        if (!out_interval_ms) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        auto wrapper = static_cast<DataRefWrapper*>(handle);
+        *out_interval_ms = wrapper->GetInterval();
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
     BridgeResult DataRef_GetName(DataRefHandle handle, char* out_buffer, int32_t buffer_size) {
         if (!handle) {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
         if (!out_buffer || buffer_size <= 0) {
             SetLastError("Invalid buffer");
             return BRIDGE_ERR_INVALID_ARGUMENT;
@@ -419,6 +618,50 @@ extern "C" {
         }
     }
 
+    BridgeResult DataRef_GetNameId(DataRefHandle handle, uint32_t* out_id) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+        if (!out_id) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        *out_id = static_cast<DataRefWrapper*>(handle)->GetNameId();
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    BridgeResult DataRef_GetValueType(DataRefHandle handle, int32_t* out_type) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+        if (!out_type) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<DataRefWrapper*>(handle);
+            *out_type = wrapper->GetValueType();
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error getting DataRef value type");
+            *out_type = DATAREF_TYPE_UNKNOWN;
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
     // ============================================================================
     // DataRef Type-Specific Getters
     // ============================================================================
@@ -428,6 +671,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -451,6 +697,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -474,6 +723,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -497,6 +749,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -515,6 +770,31 @@ extern "C" {
         }
     }
 
+    BridgeResult DataRef_GetStringIfChanged(DataRefHandle handle, char* out_buffer, int32_t buffer_size, uint32_t* in_out_version) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+
+        try {
+            auto wrapper = static_cast<DataRefWrapper*>(handle);
+            BridgeResult result = wrapper->GetStringIfChanged(out_buffer, buffer_size, in_out_version);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error getting string value");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
     // ============================================================================
     // DataRef Type-Specific Setters
     // ============================================================================
@@ -524,6 +804,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -546,6 +829,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -568,6 +854,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -590,6 +879,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
@@ -616,6 +908,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
         if (!out_value) {
             SetLastError("Null output pointer");
             return BRIDGE_ERR_INVALID_ARGUMENT;
@@ -642,6 +937,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
         if (!value) {
             SetLastError("Null DateTime pointer");
             return BRIDGE_ERR_INVALID_ARGUMENT;
@@ -668,6 +966,9 @@ extern "C" {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
         if (!data) {
             SetLastError("Null RepositionData pointer");
             return BRIDGE_ERR_INVALID_ARGUMENT;
@@ -712,28 +1013,36 @@ extern "C" {
     }
 
     // ============================================================================
-    // Connection Callbacks
+    // Write Buffering
     // ============================================================================
 
-    BridgeResult ProSim_SetOnConnect(void* instance, ConnectionCallback callback, void* user_data) {
+    BridgeResult ProSim_SetWriteBuffering(void* instance, bool enabled, int32_t flush_interval_ms) {
         if (!instance) {
             SetLastError("Null instance handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (flush_interval_ms < 0) {
+            SetLastError("Flush interval must not be negative");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
 
         try {
             auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
-            wrapper->SetOnConnect(callback, user_data);
-            SetLastError("");
-            return BRIDGE_OK;
+            BridgeResult result = wrapper->GetWriteBuffer().Configure(enabled, flush_interval_ms);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
         }
         catch (...) {
-            SetLastError("Unknown error setting connect callback");
+            SetLastError("Unknown error configuring write buffering");
             return BRIDGE_ERR_EXCEPTION;
         }
     }
 
-    BridgeResult ProSim_SetOnDisconnect(void* instance, ConnectionCallback callback, void* user_data) {
+    BridgeResult ProSim_Flush(void* instance) {
         if (!instance) {
             SetLastError("Null instance handle");
             return BRIDGE_ERR_NULL_HANDLE;
@@ -741,35 +1050,1503 @@ extern "C" {
 
         try {
             auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
-            wrapper->SetOnDisconnect(callback, user_data);
-            SetLastError("");
-            return BRIDGE_OK;
+            BridgeResult result = wrapper->GetWriteBuffer().Flush();
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
         }
         catch (...) {
-            SetLastError("Unknown error setting disconnect callback");
+            SetLastError("Unknown error flushing writes");
             return BRIDGE_ERR_EXCEPTION;
         }
     }
 
     // ============================================================================
-    // DataRef Callbacks
+    // Asynchronous Writes
     // ============================================================================
 
-    BridgeResult DataRef_SetOnDataChange(DataRefHandle handle, DataRefChangeCallback callback, void* user_data) {
+    BridgeResult DataRef_SetIntAsync(DataRefHandle handle, int32_t value, int32_t priority, WriteToken* out_token) {
         if (!handle) {
             SetLastError("Null DataRef handle");
             return BRIDGE_ERR_NULL_HANDLE;
         }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
 
         try {
             auto wrapper = static_cast<DataRefWrapper*>(handle);
-            wrapper->SetOnDataChange(callback, user_data);
-            SetLastError("");
-            return BRIDGE_OK;
-        }
-        catch (...) {
-            SetLastError("Unknown error setting data change callback");
+            BridgeResult result = wrapper->SetAsync(BridgeValue::FromInt(value), priority, out_token);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error queueing int write");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult DataRef_SetDoubleAsync(DataRefHandle handle, double value, int32_t priority, WriteToken* out_token) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+
+        try {
+            auto wrapper = static_cast<DataRefWrapper*>(handle);
+            BridgeResult result = wrapper->SetAsync(BridgeValue::FromDouble(value), priority, out_token);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error queueing double write");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult DataRef_SetBoolAsync(DataRefHandle handle, bool value, int32_t priority, WriteToken* out_token) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+
+        try {
+            auto wrapper = static_cast<DataRefWrapper*>(handle);
+            BridgeResult result = wrapper->SetAsync(BridgeValue::FromBool(value), priority, out_token);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error queueing bool write");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult DataRef_SetStringAsync(DataRefHandle handle, const char* value, int32_t priority, WriteToken* out_token) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+        if (!value) {
+            SetLastError("Null string value");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<DataRefWrapper*>(handle);
+            BridgeResult result = wrapper->SetAsync(BridgeValue::FromString(value), priority, out_token);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error queueing string write");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_SetAsyncWriteLimit(void* instance, int32_t max_in_flight) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (max_in_flight <= 0) {
+            SetLastError("Async write limit must be positive");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->GetAsyncWriter().SetMaxInFlight(max_in_flight);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error setting async write limit");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_PollWrite(void* instance, WriteToken token, bool* out_completed, BridgeResult* out_result) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_completed) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->GetAsyncWriter().Poll(token, out_completed, out_result);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error polling write");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_WaitWrite(void* instance, WriteToken token, int32_t timeout_ms, BridgeResult* out_result) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->GetAsyncWriter().Wait(token, timeout_ms, out_result);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error waiting for write");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_GetWriteError(void* instance, WriteToken token, char* buffer, int32_t buffer_size) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!buffer || buffer_size <= 0) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->GetAsyncWriter().GetError(token, buffer, buffer_size);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error getting write error");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // DataRef Sample History
+    // ============================================================================
+
+    BridgeResult ProSim_GetTime(double* out_seconds) {
+        if (!out_seconds) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        *out_seconds = MonotonicClock::Now();
+        return BRIDGE_OK;
+    }
+
+    BridgeResult DataRef_EnableHistory(DataRefHandle handle, int32_t capacity, double max_extrapolation_s) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+        if (capacity < 0 || !(max_extrapolation_s >= 0.0)) {
+            SetLastError("Invalid history capacity or extrapolation limit");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<DataRefWrapper*>(handle);
+            BridgeResult result = wrapper->EnableHistory(capacity, max_extrapolation_s);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error enabling sample history");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult DataRef_SampleAt(DataRefHandle handle, double time, int32_t mode, double* out_value) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+        if (!out_value) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        if (mode != SAMPLE_MODE_HOLD && mode != SAMPLE_MODE_LINEAR && mode != SAMPLE_MODE_EXTRAPOLATE) {
+            SetLastError("Invalid sample mode");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<DataRefWrapper*>(handle);
+            BridgeResult result = wrapper->SampleAt(time, mode, out_value);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error sampling DataRef history");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // AI Traffic
+    // ============================================================================
+
+    BridgeResult ProSim_GetTrafficCount(void* instance, int32_t* out_count) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_count) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            *out_count = wrapper->GetTraffic().Count();
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error getting traffic count");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_GetTraffic(void* instance, TrafficTarget* buffer, int32_t capacity, int32_t* out_total) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if ((!buffer && capacity > 0) || capacity < 0 || !out_total) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            wrapper->GetTraffic().Snapshot(buffer, capacity, out_total);
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error getting traffic");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_GetTrafficNear(void* instance, double latitude, double longitude, double altitude_ft,
+                                       double radius_nm, double altitude_band_ft,
+                                       TrafficTarget* buffer, int32_t capacity, int32_t* out_total) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if ((!buffer && capacity > 0) || capacity < 0 || !out_total) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        if (!(radius_nm >= 0.0) || !(altitude_band_ft >= 0.0)) {
+            SetLastError("Invalid traffic query range");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            wrapper->GetTraffic().QueryNear(latitude, longitude, altitude_ft, radius_nm, altitude_band_ft,
+                                            buffer, capacity, out_total);
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error querying traffic");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // Relative Geometry
+    // ============================================================================
+
+    BridgeResult ProSim_ComputeRelativeGeometry(const GeoState* ownship,
+                                                const double* latitudes, const double* longitudes,
+                                                const double* altitudes,
+                                                const double* ground_speeds, const double* tracks,
+                                                int32_t count, RelativeGeometry* out) {
+        if (!ownship || count < 0) {
+            SetLastError("Invalid argument");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        if (count > 0 && (!latitudes || !longitudes || !altitudes || !out)) {
+            SetLastError("Null input or output array");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        GeometryKernel::Compute(*ownship, latitudes, longitudes, altitudes, ground_speeds, tracks,
+                                static_cast<size_t>(count), out);
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    BridgeResult ProSim_ComputeRepositionGeometry(const GeoState* ownship, const ::RepositionData* targets,
+                                                  int32_t count, RelativeGeometry* out) {
+        if (!ownship || count < 0) {
+            SetLastError("Invalid argument");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        if (count > 0 && (!targets || !out)) {
+            SetLastError("Null input or output array");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        // Transpose into struct-of-arrays blocks on the stack for the kernel
+        const int32_t Block = 64;
+        double lat[Block], lon[Block], alt[Block], speed[Block], track[Block];
+        for (int32_t start = 0; start < count; start += Block) {
+            int32_t n = (count - start < Block) ? count - start : Block;
+            for (int32_t i = 0; i < n; ++i) {
+                const ::RepositionData& t = targets[start + i];
+                lat[i] = t.latitude;
+                lon[i] = t.longitude;
+                alt[i] = t.altitude;
+                speed[i] = t.ias;
+                track[i] = t.heading_magnetic;
+            }
+            GeometryKernel::Compute(*ownship, lat, lon, alt, speed, track, static_cast<size_t>(n), out + start);
+        }
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    BridgeResult ProSim_GetTrafficGeometry(void* instance, const GeoState* ownship, uint32_t* out_ids,
+                                           RelativeGeometry* out, int32_t capacity, int32_t* out_total) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!ownship || (!out && capacity > 0) || capacity < 0 || !out_total) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            wrapper->GetTraffic().ComputeGeometry(*ownship, out_ids, out, capacity, out_total);
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error computing traffic geometry");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // Failure Catalog
+    // ============================================================================
+
+    BridgeResult ProSim_LoadFailureCatalog(void* instance) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->LoadFailureCatalog();
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error loading failure catalog");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_GetFailureCatalog(void* instance, FailureRecord* records, int32_t record_capacity,
+                                          char* strings, int32_t string_capacity,
+                                          int32_t* out_count, int32_t* out_string_size,
+                                          uint32_t* out_version) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_count || !out_string_size || record_capacity < 0 || string_capacity < 0 ||
+            (!records && record_capacity > 0) || (!strings && string_capacity > 0)) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            FailureCatalog& catalog = wrapper->GetFailureCatalog();
+            if (!catalog.IsLoaded()) {
+                SetLastError("Failure catalog not loaded");
+                return BRIDGE_ERR_DATAREF_NOT_READY;
+            }
+            BridgeResult result = catalog.Copy(records, record_capacity, strings, string_capacity,
+                                               out_count, out_string_size, out_version);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            else {
+                SetLastError("Buffer too small for failure catalog");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error copying failure catalog");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_GetFailureUpdates(void* instance, uint32_t since_version,
+                                          FailureStateUpdate* updates, int32_t capacity,
+                                          int32_t* out_count, uint32_t* out_version) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_count || capacity < 0 || (!updates && capacity > 0)) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            FailureCatalog& catalog = wrapper->GetFailureCatalog();
+            if (!catalog.IsLoaded()) {
+                SetLastError("Failure catalog not loaded");
+                return BRIDGE_ERR_DATAREF_NOT_READY;
+            }
+            BridgeResult result = catalog.GetUpdates(since_version, updates, capacity, out_count, out_version);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            else {
+                SetLastError("Buffer too small for failure updates");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error reading failure updates");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // Failure Scenarios
+    // ============================================================================
+
+    static BridgeResult ArmParsedScenario(void* instance, FailureScenario& scenario, BridgeResult parsed,
+                                          double parseStart, FailureScenarioResult* out_result) {
+        FailureScenarioResult result;
+        memset(&result, 0, sizeof(result));
+        result.parse_ms = (MonotonicClock::Now() - parseStart) * 1000.0;
+
+        BridgeResult status = parsed;
+        if (status != BRIDGE_OK) {
+            SetLastError(scenario.Error().c_str());
+        }
+        else {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            status = wrapper->ArmFailureScenario(scenario, &result);
+            if (status == BRIDGE_OK) {
+                SetLastError("");
+            }
+        }
+
+        if (out_result) {
+            *out_result = result;
+        }
+        return status;
+    }
+
+    BridgeResult ProSim_ArmFailureScenario(void* instance, const char* scenario, FailureScenarioResult* out_result) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!scenario) {
+            SetLastError("Null scenario");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            double start = MonotonicClock::Now();
+            FailureScenario parsed;
+            BridgeResult result = parsed.Parse(scenario, strlen(scenario));
+            return ArmParsedScenario(instance, parsed, result, start, out_result);
+        }
+        catch (...) {
+            SetLastError("Unknown error arming failure scenario");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_ArmFailureScenarioFile(void* instance, const char* path, FailureScenarioResult* out_result) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!path) {
+            SetLastError("Null path");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            double start = MonotonicClock::Now();
+            FailureScenario parsed;
+            BridgeResult result = parsed.ParseFile(path);
+            return ArmParsedScenario(instance, parsed, result, start, out_result);
+        }
+        catch (...) {
+            SetLastError("Unknown error arming failure scenario");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // Snapshots
+    // ============================================================================
+
+    SnapshotHandle ProSim_CaptureSnapshot(void* instance) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return nullptr;
+        }
+
+        SimSnapshot* snapshot = nullptr;
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            snapshot = new SimSnapshot();
+            if (wrapper->CaptureSnapshot(*snapshot) != BRIDGE_OK) {
+                delete snapshot;
+                return nullptr;
+            }
+            return static_cast<SnapshotHandle>(snapshot);
+        }
+        catch (...) {
+            delete snapshot;
+            SetLastError("Unknown error capturing snapshot");
+            return nullptr;
+        }
+    }
+
+    BridgeResult ProSim_RestoreSnapshot(void* instance, SnapshotHandle snapshot, SnapshotRestoreResult* out_result) {
+        if (!instance || !snapshot) {
+            SetLastError("Null instance or snapshot handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        SnapshotRestoreResult result = {};
+        BridgeResult status;
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            status = wrapper->RestoreSnapshot(*static_cast<SimSnapshot*>(snapshot), &result);
+            if (status == BRIDGE_OK) {
+                SetLastError("");
+            }
+        }
+        catch (...) {
+            SetLastError("Unknown error restoring snapshot");
+            status = BRIDGE_ERR_EXCEPTION;
+        }
+
+        if (out_result) {
+            *out_result = result;
+        }
+        return status;
+    }
+
+    BridgeResult Snapshot_GetCount(SnapshotHandle snapshot, int32_t* out_count) {
+        if (!snapshot) {
+            SetLastError("Null snapshot handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_count) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        *out_count = static_cast<int32_t>(static_cast<SimSnapshot*>(snapshot)->Entries().size());
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    BridgeResult Snapshot_Save(SnapshotHandle snapshot, const char* path) {
+        if (!snapshot) {
+            SetLastError("Null snapshot handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!path) {
+            SetLastError("Null path");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            SimSnapshot* native = static_cast<SimSnapshot*>(snapshot);
+            BridgeResult result = native->SaveFile(path);
+            SetLastError(result == BRIDGE_OK ? "" : native->Error().c_str());
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error saving snapshot");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    SnapshotHandle Snapshot_Load(const char* path) {
+        if (!path) {
+            SetLastError("Null path");
+            return nullptr;
+        }
+
+        SimSnapshot* snapshot = nullptr;
+        try {
+            snapshot = new SimSnapshot();
+            if (snapshot->LoadFile(path) != BRIDGE_OK) {
+                SetLastError(snapshot->Error().c_str());
+                delete snapshot;
+                return nullptr;
+            }
+            return static_cast<SnapshotHandle>(snapshot);
+        }
+        catch (...) {
+            delete snapshot;
+            SetLastError("Unknown error loading snapshot");
+            return nullptr;
+        }
+    }
+
+    void Snapshot_Destroy(SnapshotHandle snapshot) {
+        if (!snapshot) {
+            return;
+        }
+
+        try {
+            delete static_cast<SimSnapshot*>(snapshot);
+        }
+        catch (...) {
+            // Ignore exceptions during cleanup
+        }
+    }
+
+    SnapshotDiffHandle Snapshot_Diff(SnapshotHandle before, SnapshotHandle after, const SnapshotDiffOptions* options) {
+        if (!before || !after) {
+            SetLastError("Null snapshot handle");
+            return nullptr;
+        }
+        if (options && (!(options->double_tolerance >= 0.0) || options->int_tolerance < 0)) {
+            SetLastError("Tolerances must not be negative");
+            return nullptr;
+        }
+
+        try {
+            SnapshotDiff* diff = new SnapshotDiff();
+            diff->Compute(*static_cast<SimSnapshot*>(before), *static_cast<SimSnapshot*>(after),
+                          options ? options->double_tolerance : 0.0,
+                          options ? static_cast<double>(options->int_tolerance) : 0.0);
+            SetLastError("");
+            return static_cast<SnapshotDiffHandle>(diff);
+        }
+        catch (...) {
+            SetLastError("Unknown error comparing snapshots");
+            return nullptr;
+        }
+    }
+
+    BridgeResult SnapshotDiff_GetCount(SnapshotDiffHandle diff, int32_t* out_count) {
+        if (!diff) {
+            SetLastError("Null diff handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_count) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        *out_count = static_cast<int32_t>(static_cast<SnapshotDiff*>(diff)->Entries().size());
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    BridgeResult SnapshotDiff_GetEntry(SnapshotDiffHandle diff, int32_t index, SnapshotDiffEntry* out_entry) {
+        if (!diff) {
+            SetLastError("Null diff handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_entry) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        const std::vector<SnapshotDiff::Entry>& entries = static_cast<SnapshotDiff*>(diff)->Entries();
+        if (index < 0 || static_cast<size_t>(index) >= entries.size()) {
+            SetLastError("Diff entry index out of range");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        const SnapshotDiff::Entry& entry = entries[index];
+        out_entry->name = entry.name.c_str();
+        out_entry->kind = entry.kind;
+        FlattenDiffValue(entry.before, &out_entry->before_type, &out_entry->before_value, &out_entry->before_string);
+        FlattenDiffValue(entry.after, &out_entry->after_type, &out_entry->after_value, &out_entry->after_string);
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    BridgeResult ProSim_ApplySnapshotDiff(void* instance, SnapshotDiffHandle diff, SnapshotRestoreResult* out_result) {
+        if (!instance || !diff) {
+            SetLastError("Null instance or diff handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        SnapshotRestoreResult result = {};
+        BridgeResult status;
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            status = wrapper->ApplySnapshotDiff(*static_cast<SnapshotDiff*>(diff), &result);
+            if (status == BRIDGE_OK) {
+                SetLastError("");
+            }
+        }
+        catch (...) {
+            SetLastError("Unknown error applying snapshot diff");
+            status = BRIDGE_ERR_EXCEPTION;
+        }
+
+        if (out_result) {
+            *out_result = result;
+        }
+        return status;
+    }
+
+    void SnapshotDiff_Destroy(SnapshotDiffHandle diff) {
+        if (!diff) {
+            return;
+        }
+
+        try {
+            delete static_cast<SnapshotDiff*>(diff);
+        }
+        catch (...) {
+            // Ignore exceptions during cleanup
+        }
+    }
+
+    // ============================================================================
+    // Connection Pool
+    // ============================================================================
+
+    void* ProSimPool_Create(void) {
+        try {
+            return static_cast<void*>(new ConnectionPool());
+        }
+        catch (...) {
+            SetLastError("Unknown error creating connection pool");
+            return nullptr;
+        }
+    }
+
+    void ProSimPool_Destroy(void* pool) {
+        if (!pool) {
+            return;
+        }
+
+        try {
+            delete static_cast<ConnectionPool*>(pool);
+        }
+        catch (...) {
+            // Ignore exceptions during cleanup
+        }
+    }
+
+    BridgeResult ProSimPool_AddSeat(void* pool, int32_t seat_id, const char* host, void** out_instance) {
+        if (!pool) {
+            SetLastError("Null pool handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!host) {
+            SetLastError("Null host string");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            BridgeResult result = static_cast<ConnectionPool*>(pool)->AddSeat(seat_id, host, out_instance);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error adding seat");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSimPool_RemoveSeat(void* pool, int32_t seat_id) {
+        if (!pool) {
+            SetLastError("Null pool handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            BridgeResult result = static_cast<ConnectionPool*>(pool)->RemoveSeat(seat_id);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error removing seat");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSimPool_GetSeat(void* pool, int32_t seat_id, void** out_instance) {
+        if (!pool) {
+            SetLastError("Null pool handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_instance) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            BridgeResult result = static_cast<ConnectionPool*>(pool)->GetSeat(seat_id, out_instance);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error looking up seat");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSimPool_GetSeatCount(void* pool, int32_t* out_count) {
+        if (!pool) {
+            SetLastError("Null pool handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_count) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            *out_count = static_cast<ConnectionPool*>(pool)->Count();
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error counting seats");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSimPool_ConnectAll(void* pool, bool synchronous, int32_t* out_seat_ids,
+                                       BridgeResult* out_results, int32_t capacity, int32_t* out_count) {
+        if (!pool) {
+            SetLastError("Null pool handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (capacity < 0) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            BridgeResult result = static_cast<ConnectionPool*>(pool)->ConnectAll(synchronous, out_seat_ids,
+                                                                                 out_results, capacity, out_count);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error connecting seats");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSimPool_ForEach(void* pool, SeatTaskCallback callback, void* user_data,
+                                    int32_t* out_seat_ids, BridgeResult* out_results, int32_t capacity,
+                                    int32_t* out_count) {
+        if (!pool) {
+            SetLastError("Null pool handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!callback || capacity < 0) {
+            SetLastError("Invalid argument");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            BridgeResult result = static_cast<ConnectionPool*>(pool)->ForEach(callback, user_data, out_seat_ids,
+                                                                              out_results, capacity, out_count);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error running seat tasks");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSimPool_Post(void* pool, int32_t seat_id, SeatTaskCallback callback, void* user_data) {
+        if (!pool) {
+            SetLastError("Null pool handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!callback) {
+            SetLastError("Null callback");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            BridgeResult result = static_cast<ConnectionPool*>(pool)->Post(seat_id, callback, user_data);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error posting seat task");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // DataRef Fan-out Server
+    // ============================================================================
+
+    void* ProSimFanout_Create(uint16_t port) {
+        FanoutServer* server = nullptr;
+        try {
+            server = new FanoutServer();
+            if (server->Start(port) != BRIDGE_OK) {
+                delete server;
+                return nullptr;
+            }
+            SetLastError("");
+            return static_cast<void*>(server);
+        }
+        catch (...) {
+            delete server;
+            SetLastError("Unknown error creating fan-out server");
+            return nullptr;
+        }
+    }
+
+    void ProSimFanout_Destroy(void* server) {
+        if (!server) {
+            return;
+        }
+
+        try {
+            delete static_cast<FanoutServer*>(server);
+        }
+        catch (...) {
+            // Ignore exceptions during cleanup
+        }
+    }
+
+    BridgeResult ProSimFanout_GetPort(void* server, uint16_t* out_port) {
+        if (!server) {
+            SetLastError("Null server handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_port) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        *out_port = static_cast<FanoutServer*>(server)->Port();
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    BridgeResult ProSimFanout_Attach(void* server, void* instance) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            wrapper->SetFanout(static_cast<FanoutServer*>(server));
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error attaching fan-out server");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    static BridgeResult PublishFanoutValue(void* server, const char* name, const BridgeValue& value) {
+        if (!server) {
+            SetLastError("Null server handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!name) {
+            SetLastError("Null DataRef name");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            BridgeResult result = static_cast<FanoutServer*>(server)->Publish(name, value);
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+            else {
+                SetLastError("Name too long or too many refs for the fan-out server");
+            }
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error publishing value");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSimFanout_PublishInt(void* server, const char* name, int32_t value) {
+        return PublishFanoutValue(server, name, BridgeValue::FromInt(value));
+    }
+
+    BridgeResult ProSimFanout_PublishDouble(void* server, const char* name, double value) {
+        return PublishFanoutValue(server, name, BridgeValue::FromDouble(value));
+    }
+
+    BridgeResult ProSimFanout_PublishBool(void* server, const char* name, bool value) {
+        return PublishFanoutValue(server, name, BridgeValue::FromBool(value));
+    }
+
+    BridgeResult ProSimFanout_PublishString(void* server, const char* name, const char* value) {
+        if (!value) {
+            SetLastError("Null value string");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        return PublishFanoutValue(server, name, BridgeValue::FromString(value));
+    }
+
+    BridgeResult ProSimFanout_GetStats(void* server, FanoutStats* out_stats) {
+        if (!server) {
+            SetLastError("Null server handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_stats) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        static_cast<FanoutServer*>(server)->GetStats(out_stats);
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    // ============================================================================
+    // Wire Format
+    // ============================================================================
+
+    void* ProSimWire_CreateEncoder(uint32_t max_slots) {
+        if (max_slots == 0) {
+            SetLastError("Invalid slot count");
+            return nullptr;
+        }
+
+        try {
+            WireEncoder* encoder = new WireEncoder(max_slots);
+            SetLastError("");
+            return static_cast<void*>(encoder);
+        }
+        catch (...) {
+            SetLastError("Unknown error creating wire encoder");
+            return nullptr;
+        }
+    }
+
+    void ProSimWire_DestroyEncoder(void* encoder) {
+        if (!encoder) {
+            return;
+        }
+
+        delete static_cast<WireEncoder*>(encoder);
+    }
+
+    BridgeResult ProSimWire_Encode(void* encoder, const WireRecord* records, int32_t count, bool keyframe,
+                                   uint8_t* buffer, int32_t capacity, int32_t* out_size) {
+        if (!encoder) {
+            SetLastError("Null encoder handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_size) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        if (count < 0 || (count > 0 && !records) || capacity < 0 || (capacity > 0 && !buffer)) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        size_t size = 0;
+        BridgeResult result = static_cast<WireEncoder*>(encoder)->Encode(
+            records, static_cast<size_t>(count), keyframe, buffer, static_cast<size_t>(capacity), &size);
+        *out_size = static_cast<int32_t>(size);
+        if (result == BRIDGE_OK) {
+            SetLastError("");
+        }
+        else if (size > static_cast<size_t>(capacity)) {
+            SetLastError("Buffer too small");
+        }
+        else {
+            SetLastError("Invalid record");
+        }
+        return result;
+    }
+
+    void* ProSimWire_CreateDecoder(uint32_t max_slots) {
+        if (max_slots == 0) {
+            SetLastError("Invalid slot count");
+            return nullptr;
+        }
+
+        try {
+            WireDecoder* decoder = new WireDecoder(max_slots);
+            SetLastError("");
+            return static_cast<void*>(decoder);
+        }
+        catch (...) {
+            SetLastError("Unknown error creating wire decoder");
+            return nullptr;
+        }
+    }
+
+    void ProSimWire_DestroyDecoder(void* decoder) {
+        if (!decoder) {
+            return;
+        }
+
+        delete static_cast<WireDecoder*>(decoder);
+    }
+
+    BridgeResult ProSimWire_Decode(void* decoder, const uint8_t* frame, int32_t size,
+                                   WireRecord* records, int32_t capacity,
+                                   int32_t* out_count, uint32_t* out_sequence) {
+        if (!decoder) {
+            SetLastError("Null decoder handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_count) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        if (!frame || size < 0 || capacity < 0 || (capacity > 0 && !records)) {
+            SetLastError("Invalid buffer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        size_t count = 0;
+        BridgeResult result = static_cast<WireDecoder*>(decoder)->Decode(
+            frame, static_cast<size_t>(size), records, static_cast<size_t>(capacity), &count, out_sequence);
+        *out_count = static_cast<int32_t>(count);
+        if (result == BRIDGE_OK) {
+            SetLastError("");
+        }
+        else if (result == BRIDGE_ERR_INVALID_ARGUMENT) {
+            SetLastError("Record array too small");
+        }
+        else {
+            SetLastError("Malformed or out-of-sequence frame");
+        }
+        return result;
+    }
+
+    // ============================================================================
+    // Memory Accounting
+    // ============================================================================
+
+    BridgeResult ProSim_GetMemoryStats(void* instance, MemoryStats* out_stats) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_stats) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            wrapper->GetMemoryStats(out_stats);
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error getting memory stats");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_SetMemoryLimits(void* instance, const MemoryLimits* limits) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->SetMemoryLimits(limits);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error setting memory limits");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // Connection Callbacks
+    // ============================================================================
+
+    BridgeResult ProSim_SetOnConnect(void* instance, ConnectionCallback callback, void* user_data) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            wrapper->SetOnConnect(callback, user_data);
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error setting connect callback");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_SetOnDisconnect(void* instance, ConnectionCallback callback, void* user_data) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            wrapper->SetOnDisconnect(callback, user_data);
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error setting disconnect callback");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    // ============================================================================
+    // DataRef Callbacks
+    // ============================================================================
+
+    BridgeResult DataRef_SetOnDataChange(DataRefHandle handle, DataRefChangeCallback callback, void* user_data) {
+        if (!handle) {
+            SetLastError("Null DataRef handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (RejectOrphanedDataRef(handle)) {
+            return BRIDGE_ERR_NOT_CONNECTED;
+        }
+
+        try {
+            auto wrapper = static_cast<DataRefWrapper*>(handle);
+            wrapper->SetOnDataChange(callback, user_data);
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error setting data change callback");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_SetOnDataRefsUpdated(void* instance, DataRefsUpdatedCallback callback, void* user_data) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            wrapper->SetOnDataRefsUpdated(callback, user_data);
+            SetLastError("");
+            return BRIDGE_OK;
+        }
+        catch (...) {
+            SetLastError("Unknown error setting data refs updated callback");
+            return BRIDGE_ERR_EXCEPTION;
+        }
+    }
+
+    BridgeResult ProSim_SetCallbackDispatch(void* instance, const CallbackDispatchOptions* options) {
+        if (!instance) {
+            SetLastError("Null instance handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+
+        try {
+            auto wrapper = static_cast<ProSimConnectWrapper*>(instance);
+            BridgeResult result = wrapper->SetCallbackDispatch(options);
+
+            if (result == BRIDGE_OK) {
+                SetLastError("");
+            }
+
+            return result;
+        }
+        catch (...) {
+            SetLastError("Unknown error configuring callback dispatch");
             return BRIDGE_ERR_EXCEPTION;
         }
     }
+
+    // ============================================================================
+    // Triggers
+    // ============================================================================
+
+    TriggerHandle Trigger_Create(const TriggerOptions* options, TriggerCallback callback, void* user_data, void* connection) {
+        if (!options || !callback) {
+            SetLastError("Null trigger options or callback");
+            return nullptr;
+        }
+        if (!connection) {
+            SetLastError("Null connection handle");
+            return nullptr;
+        }
+
+        try {
+            auto connWrapper = static_cast<ProSimConnectWrapper*>(connection);
+            Trigger* trigger = connWrapper->CreateTrigger(*options, callback, user_data);
+            return static_cast<TriggerHandle>(trigger);
+        }
+        catch (Exception^ ex) {
+            String^ message = ex->Message;
+            IntPtr ptr = Marshal::StringToHGlobalAnsi(message);
+            try {
+                SetLastError(static_cast<const char*>(ptr.ToPointer()));
+            }
+            finally {
+                Marshal::FreeHGlobal(ptr);
+            }
+            return nullptr;
+        }
+        catch (...) {
+            SetLastError("Unknown error creating trigger");
+            return nullptr;
+        }
+    }
+
+    BridgeResult Trigger_IsActive(TriggerHandle trigger, bool* out_active) {
+        if (!trigger) {
+            SetLastError("Null trigger handle");
+            return BRIDGE_ERR_NULL_HANDLE;
+        }
+        if (!out_active) {
+            SetLastError("Null output pointer");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+
+        Trigger* native = static_cast<Trigger*>(trigger);
+        *out_active = InterlockedCompareExchange(&native->active, 0, 0) != 0;
+        SetLastError("");
+        return BRIDGE_OK;
+    }
+
+    void Trigger_Destroy(TriggerHandle trigger) {
+        if (!trigger) {
+            return;
+        }
+
+        try {
+            Trigger* native = static_cast<Trigger*>(trigger);
+            native->connection->DestroyTrigger(native);
+        }
+        catch (...) {
+            // Ignore exceptions during cleanup
+        }
+    }
 }
\ No newline at end of file
@@ -24,8 +24,100 @@ typedef int32_t BridgeResult;
 #define BRIDGE_ERR_DATAREF_NOT_FOUND -5
 #define BRIDGE_ERR_DATAREF_NOT_READY -6
 #define BRIDGE_ERR_INVALID_DATA     -7
+#define BRIDGE_ERR_QUEUE_FULL       -8
+#define BRIDGE_ERR_TIMEOUT          -9
+#define BRIDGE_ERR_LIMIT_EXCEEDED   -10
+#define BRIDGE_ERR_SUPERSEDED       -11
 #define BRIDGE_ERR_EXCEPTION        -99
 
+// ============================================================================
+// DataRef Value Types
+// ============================================================================
+
+// Runtime type of a DataRef value, as reported by DataRef_GetValueType
+#define DATAREF_TYPE_UNKNOWN         0
+#define DATAREF_TYPE_BOOL            1
+#define DATAREF_TYPE_INT             2
+#define DATAREF_TYPE_INT64           3
+#define DATAREF_TYPE_FLOAT           4
+#define DATAREF_TYPE_DOUBLE          5
+#define DATAREF_TYPE_STRING          6
+#define DATAREF_TYPE_DATETIME        7
+#define DATAREF_TYPE_OBJECT          8
+
+// ============================================================================
+// Asynchronous Write Tokens and Priorities
+// ============================================================================
+
+// Identifies an asynchronous write; tokens are never reused by a connection
+typedef uint64_t WriteToken;
+
+#define WRITE_TOKEN_INVALID          0
+
+// Priority class of an asynchronous write
+#define WRITE_PRIORITY_NORMAL        0
+#define WRITE_PRIORITY_HIGH          1
+
+// ============================================================================
+// Sample History Modes
+// ============================================================================
+
+// How DataRef_SampleAt derives a value between and after recorded samples
+#define SAMPLE_MODE_HOLD             0   // most recent sample at or before t
+#define SAMPLE_MODE_LINEAR           1   // linear interpolation, newest value after the last sample
+#define SAMPLE_MODE_EXTRAPOLATE      2   // linear interpolation, bounded extrapolation after it
+
+// ============================================================================
+// Failure Classes and States
+// ============================================================================
+
+// FailureRecord.failure_class
+#define FAILURE_CLASS_DOCUMENTED         0
+#define FAILURE_CLASS_RESET_CONDITION    1
+#define FAILURE_CLASS_CIRCUIT_BREAKER    2
+#define FAILURE_CLASS_MAINTENANCE        3
+
+// FailureRecord.armed_state
+#define FAILURE_STATE_NONE           0   // not part of any armed failure
+#define FAILURE_STATE_ARMED          1   // armed, waiting for its condition
+#define FAILURE_STATE_TRIGGERED      2   // condition met, failure active
+
+// ============================================================================
+// Snapshot Diff Kinds
+// ============================================================================
+
+// SnapshotDiffEntry.kind
+#define SNAPSHOT_DIFF_CHANGED        0   // in both snapshots, values differ
+#define SNAPSHOT_DIFF_ADDED          1   // only in the second snapshot
+#define SNAPSHOT_DIFF_REMOVED        2   // only in the first snapshot
+
+// ============================================================================
+// Fan-out Protocol
+// ============================================================================
+
+// Frames on a fan-out server socket: u8 type, u16 payload length, payload.
+// Integers and doubles are little-endian.
+//
+// Client to server:
+//   FANOUT_MSG_SUBSCRIBE  u16 max_rate_hz (0 = every 10 ms server tick), u16 count,
+//                         count x (u8 name_length, name). count 0 subscribes to every ref.
+//                         A new subscription replaces the previous one and starts with the
+//                         current value of each ref.
+// Server to client:
+//   FANOUT_MSG_DEFINE     u16 ref_id, u8 name_length, name; sent once per ref, before its
+//                         first value
+//   FANOUT_MSG_DELTA      u16 count, count x (u16 ref_id, u8 type, value) for the refs
+//                         that changed since the last update. value by DATAREF_TYPE_*:
+//                         BOOL u8, INT i32, DOUBLE f64, STRING u16 length + UTF-8 bytes
+//                         (strings are cut to 65528 bytes so a record fits in one frame)
+#define FANOUT_MSG_SUBSCRIBE         0x01
+#define FANOUT_MSG_DEFINE            0x81
+#define FANOUT_MSG_DELTA             0x82
+
+// Compact DataRef update frames (ProSimWire_*); layout described in WireFormat.h
+#define WIRE_FORMAT_VERSION          1
+#define WIRE_FLAG_KEYFRAME           0x01
+
 // ============================================================================
 // Connection and Instance Management
 // ============================================================================
@@ -52,6 +144,10 @@ extern "C" {
     BRIDGE_API BridgeResult ProSim_IsConnected(void* instance, bool* out_connected);
 
     // Destroys a ProSimConnect instance and releases resources
+    // DataRef handles still alive are released with it: afterwards they may only be passed
+    // to DataRef_Destroy, which frees them, and other DataRef calls on them return
+    // BRIDGE_ERR_NOT_CONNECTED. Destroy triggers (Trigger_Destroy) before the
+    // connection; a trigger handle cannot outlive it.
     // instance: handle returned from ProSim_Create
     BRIDGE_API void ProSim_Destroy(void* instance);
 
@@ -100,6 +196,167 @@ extern "C" {
         bool on_ground;
     } RepositionData;
 
+    // TrafficTarget structure for AI traffic queries
+    typedef struct {
+        uint32_t object_id;
+        double latitude;
+        double longitude;
+        double altitude;            // feet
+        double altitude_indicated;  // feet
+        double ground_speed;        // knots
+        double heading_true;        // degrees
+        double vertical_speed;
+        double velocity_x;          // world-frame velocity components
+        double velocity_y;
+        double velocity_z;
+        bool on_ground;
+        double distance_nm;         // from the query position (ProSim_GetTrafficNear only)
+    } TrafficTarget;
+
+    // GeoState structure describing the reference aircraft (ownship) for geometry queries
+    typedef struct {
+        double latitude;
+        double longitude;
+        double altitude;            // feet
+        double ground_speed;        // knots
+        double track_true;          // degrees
+    } GeoState;
+
+    // RelativeGeometry structure describing a target as seen from the reference aircraft
+    typedef struct {
+        double range_nm;            // great-circle distance
+        double bearing_deg;         // initial true bearing, 0-360
+        double relative_altitude_ft;// target minus reference
+        double closure_rate_kt;     // positive when the range is decreasing
+    } RelativeGeometry;
+
+    // One failure from the catalog; *_offset fields index NUL-terminated UTF-8 strings
+    // in the string table returned alongside the records
+    typedef struct {
+        uint32_t id_offset;
+        uint32_t name_offset;
+        uint32_t description_offset;
+        uint32_t domain_offset;
+        uint32_t group_offset;
+        uint32_t group_member_offset;
+        int32_t failure_class;      // FAILURE_CLASS_*
+        int32_t armed_state;        // FAILURE_STATE_*
+        int32_t armed_id;           // id of the armed failure, -1 when not armed
+    } FailureRecord;
+
+    // Armed-state change for one failure
+    typedef struct {
+        int32_t index;              // index into the FailureRecord array
+        int32_t armed_state;        // FAILURE_STATE_*
+        int32_t armed_id;
+    } FailureStateUpdate;
+
+    // Outcome of arming a failure scenario; counts are valid even when arming stops early
+    typedef struct {
+        int32_t armed_failures;     // armed failures created (one per scenario line)
+        int32_t failures;           // individual failures across those armed failures
+        double parse_ms;            // reading and parsing the scenario
+        double resolve_ms;          // resolving failure ids against the simulator
+        double push_ms;             // creating the armed failures
+    } FailureScenarioResult;
+
+    // Outcome of restoring a snapshot; counts are valid even when restoring fails
+    typedef struct {
+        int32_t entries;            // values in the snapshot
+        int32_t written;            // values that differed and were written
+        int32_t unchanged;          // values already equal, not written
+        int32_t failed;             // values that could not be written
+        double read_ms;             // reading the current values
+        double write_ms;            // writing the values that differed
+    } SnapshotRestoreResult;
+
+    // Tolerances for Snapshot_Diff; bool and string values must always be equal
+    typedef struct {
+        double double_tolerance;    // doubles differ when further apart than this
+        int32_t int_tolerance;      // ints differ when further apart than this
+    } SnapshotDiffOptions;
+
+    // One difference between two snapshots; strings stay valid until the diff is destroyed
+    typedef struct {
+        const char* name;
+        int32_t kind;               // SNAPSHOT_DIFF_*
+        int32_t before_type;        // DATAREF_TYPE_*, DATAREF_TYPE_UNKNOWN when added
+        int32_t after_type;         // DATAREF_TYPE_*, DATAREF_TYPE_UNKNOWN when removed
+        double before_value;        // int, double and bool (0 or 1) values
+        double after_value;
+        const char* before_string;  // string values, otherwise NULL
+        const char* after_string;
+    } SnapshotDiffEntry;
+
+    // Fan-out server counters
+    typedef struct {
+        int32_t clients;            // connected subscribers
+        int32_t refs;               // distinct refs published
+        uint64_t publishes;         // values published (changed or not)
+        uint64_t frames_sent;
+        uint64_t bytes_sent;
+    } FanoutStats;
+
+    // One DataRef update in a wire frame
+    typedef struct {
+        uint32_t slot;              // application-assigned DataRef id, below the codec's max_slots
+        int32_t type;               // DATAREF_TYPE_BOOL, _INT, _DOUBLE or _STRING
+        double double_value;
+        int32_t int_value;
+        int32_t bool_value;         // 0 or 1
+        const char* string_value;   // UTF-8, not NUL-terminated when decoded
+        int32_t string_length;      // bytes
+    } WireRecord;
+
+    // Worker pool for DataRef change callbacks (ProSim_SetCallbackDispatch)
+    typedef struct {
+        int32_t threads;            // worker threads, 1..64
+        uint64_t affinity_mask;     // processors the workers may run on; 0 = unchanged
+        int32_t priority;           // Win32 THREAD_PRIORITY_* value, e.g. 0 (normal) or 2 (highest)
+    } CallbackDispatchOptions;
+
+    // Memory used by a connection (ProSim_GetMemoryStats); byte counts are approximate
+    typedef struct {
+        uint64_t wrapper_bytes;     // DataRef wrapper slabs
+        uint64_t name_bytes;        // interned DataRef names and their index
+        uint64_t cache_bytes;       // string value caches, AI traffic table, failure catalog
+        uint64_t queue_bytes;       // buffered and async write queues, batched change lists
+        uint64_t history_bytes;     // sample history rings
+        int32_t datarefs;           // live DataRef handles
+        int32_t names;              // distinct names interned
+        int32_t pending_writes;     // buffered plus queued async writes
+        // Managed heap, for the whole process (the CLR does not attribute it to a connection)
+        uint64_t managed_heap_bytes;
+        int32_t gen0_collections;
+        int32_t gen1_collections;
+        int32_t gen2_collections;
+    } MemoryStats;
+
+    // Caps on a connection's memory use (ProSim_SetMemoryLimits); 0 means unlimited
+    typedef struct {
+        int32_t max_datarefs;       // live DataRef handles
+        uint64_t max_name_bytes;    // bytes of distinct DataRef names, including terminators
+        uint64_t max_history_bytes; // sample history rings, 16 bytes per sample
+    } MemoryLimits;
+
+    // Adaptive polling interval bounds (ProSim_SetAdaptiveIntervals)
+    typedef struct {
+        int32_t min_interval_ms;    // fastest interval a DataRef is moved to, > 0
+        int32_t max_interval_ms;    // slowest interval, >= min_interval_ms
+        int32_t window_ms;          // how often intervals are reviewed; 0 = 4 x max_interval_ms,
+                                    // at least 2000
+    } AdaptiveIntervalOptions;
+
+    // Condition trigger settings (Trigger_Create); expressions use the DataRef_CreateDerived syntax
+    typedef struct {
+        const char* condition;      // the trigger turns on while this is non-zero
+        const char* release;        // the trigger turns off while this is non-zero; NULL = when
+                                    // condition is zero. A separate release gives hysteresis.
+        int32_t on_delay_ms;        // how long condition must hold before the trigger turns on
+        int32_t off_delay_ms;       // how long the release must hold before it turns off
+        int32_t interval;           // polling interval in milliseconds for the input DataRefs
+    } TriggerOptions;
+
     // ============================================================================
     // Opaque Handle Types
     // ============================================================================
@@ -107,6 +364,15 @@ extern "C" {
     // Opaque handle type for DataRef instances
     typedef void* DataRefHandle;
 
+    // Opaque handle type for condition triggers
+    typedef void* TriggerHandle;
+
+    // Opaque handle type for sim-state snapshots
+    typedef void* SnapshotHandle;
+
+    // Opaque handle type for differences between two snapshots
+    typedef void* SnapshotDiffHandle;
+
     // ============================================================================
     // Callback Function Pointer Types
     // ============================================================================
@@ -120,6 +386,27 @@ extern "C" {
     // user_data: opaque pointer passed during registration
     typedef void (*DataRefChangeCallback)(DataRefHandle dataref_handle, void* user_data);
 
+    // Batched change callback - called once per SDK update cycle
+    // changed: handles of the DataRefs that changed in this cycle, each listed once
+    // values: their values as double (NaN for strings, DateTime and other non-numeric values)
+    // count: number of entries in changed and values
+    // user_data: opaque pointer passed during registration
+    // The arrays are only valid during the call.
+    typedef void (*DataRefsUpdatedCallback)(const DataRefHandle* changed, const double* values, int32_t count, void* user_data);
+
+    // Trigger callback - called when a trigger turns on or off
+    // trigger: handle returned from Trigger_Create
+    // active: the trigger's new state
+    // user_data: opaque pointer passed during registration
+    typedef void (*TriggerCallback)(TriggerHandle trigger, bool active, void* user_data);
+
+    // Seat task callback - runs on a pool seat's worker thread
+    // seat_id: seat the task runs for
+    // instance: the seat's connection handle (usable with all ProSim_* and DataRef_* calls)
+    // user_data: opaque pointer passed when the task was submitted
+    // Returns: result reported for this seat
+    typedef BridgeResult (*SeatTaskCallback)(int32_t seat_id, void* instance, void* user_data);
+
     // ============================================================================
     // DataRef Lifecycle Management
     // ============================================================================
@@ -129,10 +416,61 @@ extern "C" {
     // interval: polling interval in milliseconds
     // connection: handle returned from ProSim_Create
     // register_now: if true, registers immediately; if false, call DataRef_Register later
+    // Handles created for the same name on one connection share a single SDK DataRef,
+    // polled at the shortest interval any of them asked for; each handle keeps its own
+    // callback, history and batching state. DataRef_GetInterval gives the shared interval.
+    // A shorter interval replaces the shared SDK DataRef with one registered at that interval;
+    // reads keep the last value meanwhile. A handle may be destroyed from its own change
+    // callback, inline or with callback dispatch (see DataRef_Destroy).
     // Returns: Handle to the DataRef, or NULL on failure
     BRIDGE_API DataRefHandle DataRef_Create(const char* name, int32_t interval, void* connection, bool register_now);
 
-    // Destroys a DataRef instance and releases resources
+    // Maps a DataRef name to a dense 32-bit id, unique within the connection. Ids start at 0
+    // and follow first use (by this call or DataRef_Create), so they can index arrays and
+    // serve as wire-format slots and recording keys. An id never changes or goes away
+    // while the connection exists.
+    // instance: handle returned from ProSim_Create
+    // name: null-terminated DataRef name
+    // out_id: receives the id
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_LIMIT_EXCEEDED if a new name would exceed
+    //          max_name_bytes (ProSim_SetMemoryLimits), error code on failure
+    BRIDGE_API BridgeResult ProSim_InternName(void* instance, const char* name, uint32_t* out_id);
+
+    // Gets the name for an id without copying it
+    // instance: handle returned from ProSim_Create
+    // id: id returned from ProSim_InternName or DataRef_GetNameId
+    // out_name: receives the name, valid until the connection is destroyed
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_ARGUMENT for an unknown id
+    BRIDGE_API BridgeResult ProSim_GetInternedName(void* instance, uint32_t id, const char** out_name);
+
+    // Creates a new DataRef instance from an interned name id
+    // name_id: id returned from ProSim_InternName on the same connection
+    // interval, connection, register_now: as for DataRef_Create
+    // Returns: Handle to the DataRef, or NULL on failure
+    BRIDGE_API DataRefHandle DataRef_CreateById(uint32_t name_id, int32_t interval, void* connection, bool register_now);
+
+    // Creates a derived DataRef whose value is computed natively from an expression, e.g.
+    // "fuel.left + fuel.center + fuel.right" or "sqrt(vx*vx + vy*vy) * 1.944"
+    // name: null-terminated name for the derived DataRef, unique among derived DataRefs
+    // expression: arithmetic over DataRef names, numbers, operators and math functions
+    //             (syntax in Expression.h); names of existing derived DataRefs are inlined
+    // interval: polling interval in milliseconds for the input DataRefs this creates
+    // connection: handle returned from ProSim_Create
+    // The expression is compiled once and evaluated at the end of each SDK update cycle in
+    // which an input changed. The result is a read-only double DataRef that works with the
+    // DataRef_Get*, callback, history and batching functions; setters return
+    // BRIDGE_ERR_INVALID_ARGUMENT. Reads return BRIDGE_ERR_DATAREF_NOT_READY until every
+    // input has a value. Non-numeric inputs read as NaN.
+    // Derived DataRefs must be destroyed before their connection, like any DataRef.
+    // Returns: Handle to the DataRef, or NULL on failure (ProSim_GetLastError gives the
+    //          column of an expression error)
+    BRIDGE_API DataRefHandle DataRef_CreateDerived(const char* name, const char* expression, int32_t interval, void* connection);
+
+    // Destroys a DataRef instance and releases resources; may be called before or after
+    // ProSim_Destroy for its connection. With callback dispatch on, change callbacks still
+    // queued for the DataRef are dropped and one running on another worker is waited for.
+    // It may be called from any change callback, the DataRef's own included; two callbacks
+    // running at once must not destroy each other's DataRef.
     // handle: handle returned from DataRef_Create
     BRIDGE_API void DataRef_Destroy(DataRefHandle handle);
 
@@ -141,6 +479,36 @@ extern "C" {
     // Returns: BRIDGE_OK on success, error code on failure
     BRIDGE_API BridgeResult DataRef_Register(DataRefHandle handle);
 
+    // Defers registration of the connection's DataRefs until they are used, and unregisters
+    // them again once idle. Applies to DataRefs created afterwards, whatever register_now says.
+    // A lazy DataRef registers on its first read or write, or when a change callback or
+    // sample history is set on it, which also keeps it registered until removed. One that has
+    // not been read or written for idle_ttl_ms is unregistered and re-registers on next use;
+    // until the SDK delivers a fresh value, that read returns the last value received or
+    // BRIDGE_ERR_DATAREF_NOT_READY.
+    // instance: handle returned from ProSim_Create
+    // enabled: true for lazy registration of new DataRefs; false stops idle unregistration
+    // idle_ttl_ms: idle time before unregistering, 0 = register lazily but never unregister
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_SetLazyRegistration(void* instance, bool enabled, int32_t idle_ttl_ms);
+
+    // Lets the bridge tune the polling interval of the connection's DataRefs created afterwards.
+    // Intervals move in steps of two between the bounds, starting from the interval passed at
+    // creation. Once per window, a DataRef that changed in at least half of its polls and is
+    // read at least every other poll (or has a change callback, sample history or derived
+    // readers) halves its interval; one that changed in fewer than 1 in 8 polls, or is read
+    // that rarely, doubles it. A new interval re-registers the DataRef with the SDK.
+    // instance: handle returned from ProSim_Create
+    // options: interval bounds, or NULL to stop adjusting (intervals stay where they are)
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_ARGUMENT for invalid bounds
+    BRIDGE_API BridgeResult ProSim_SetAdaptiveIntervals(void* instance, const AdaptiveIntervalOptions* options);
+
+    // Gets the DataRef's current polling interval
+    // handle: handle returned from DataRef_Create
+    // out_interval_ms: receives the interval in milliseconds (0 for derived DataRefs)
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult DataRef_GetInterval(DataRefHandle handle, int32_t* out_interval_ms);
+
     // Gets the DataRef name
     // handle: handle returned from DataRef_Create
     // out_buffer: buffer to receive null-terminated string
@@ -148,10 +516,28 @@ extern "C" {
     // Returns: BRIDGE_OK on success, required size if buffer too small, error code on failure
     BRIDGE_API BridgeResult DataRef_GetName(DataRefHandle handle, char* out_buffer, int32_t buffer_size);
 
+    // Gets the DataRef's name id (see ProSim_InternName)
+    // handle: handle returned from DataRef_Create
+    // out_id: receives the id
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult DataRef_GetNameId(DataRefHandle handle, uint32_t* out_id);
+
+    // Gets the runtime value type of the DataRef
+    // handle: handle returned from DataRef_Create
+    // out_type: pointer to receive one of the DATAREF_TYPE_* values
+    // The type is taken from the SDK catalog (DataRefDescription.DataType) when available,
+    // otherwise from the first value received. DATAREF_TYPE_UNKNOWN means no value yet.
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult DataRef_GetValueType(DataRefHandle handle, int32_t* out_type);
+
     // ============================================================================
     // DataRef Type-Specific Getters
     // ============================================================================
 
+    // Getters read the value using the DataRef's runtime type (see DataRef_GetValueType).
+    // Numeric types convert to each other; a value that cannot be represented in the
+    // requested type (e.g. a string read as double) returns BRIDGE_ERR_INVALID_DATA.
+
     // Gets DataRef value as int32
     BRIDGE_API BridgeResult DataRef_GetInt(DataRefHandle handle, int32_t* out_value);
 
@@ -161,9 +547,17 @@ extern "C" {
     // Gets DataRef value as bool
     BRIDGE_API BridgeResult DataRef_GetBool(DataRefHandle handle, bool* out_value);
 
-    // Gets DataRef value as string
+    // Gets DataRef value as a UTF-8 string
+    // Returns: BRIDGE_OK on success, required size if buffer too small, error code on failure
     BRIDGE_API BridgeResult DataRef_GetString(DataRefHandle handle, char* out_buffer, int32_t buffer_size);
 
+    // Gets DataRef value as a UTF-8 string only if it changed since in_out_version
+    // in_out_version: version the caller last received (start with 0); updated when the buffer is written
+    // The value is encoded once per change into a buffer owned by the DataRef. When nothing changed
+    // the call returns BRIDGE_OK without touching out_buffer or in_out_version.
+    // Returns: BRIDGE_OK on success, required size if buffer too small, error code on failure
+    BRIDGE_API BridgeResult DataRef_GetStringIfChanged(DataRefHandle handle, char* out_buffer, int32_t buffer_size, uint32_t* in_out_version);
+
     // ============================================================================
     // DataRef Type-Specific Setters
     // ============================================================================
@@ -177,7 +571,7 @@ extern "C" {
     // Sets DataRef value from bool
     BRIDGE_API BridgeResult DataRef_SetBool(DataRefHandle handle, bool value);
 
-    // Sets DataRef value from string
+    // Sets DataRef value from a UTF-8 string
     BRIDGE_API BridgeResult DataRef_SetString(DataRefHandle handle, const char* value);
 
     // ============================================================================
@@ -200,9 +594,526 @@ extern "C" {
     // Sets SDK priority mode for the connection
     // instance: handle returned from ProSim_Create
     // priority: if true, enables priority mode; if false, disables it
+    // Priority mode also stays on while high-priority async writes are being sent; prefer
+    // WRITE_PRIORITY_HIGH over toggling this around individual writes.
     // Returns: BRIDGE_OK on success, error code on failure
     BRIDGE_API BridgeResult ProSim_SetPriorityMode(void* instance, bool priority);
 
+    // ============================================================================
+    // Write Buffering
+    // ============================================================================
+
+    // Enables or disables buffered (coalesced) writes for the connection
+    // instance: handle returned from ProSim_Create
+    // enabled: if true, DataRef_SetInt/SetDouble/SetBool/SetString record the value in a
+    //          last-writer-wins table instead of writing it immediately
+    // flush_interval_ms: period of the background flush in milliseconds; 0 flushes only
+    //          on ProSim_Flush
+    // Disabling buffering flushes any pending writes. Reads return the last flushed value.
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_SetWriteBuffering(void* instance, bool enabled, int32_t flush_interval_ms);
+
+    // Sends all buffered writes now, one write per DataRef with a pending value
+    // instance: handle returned from ProSim_Create
+    // Called from a change callback raised by a flush in progress, it returns BRIDGE_OK at once
+    // and the running flush sends the newly buffered writes before it returns.
+    // Returns: BRIDGE_OK on success, first error encountered on failure
+    BRIDGE_API BridgeResult ProSim_Flush(void* instance);
+
+    // ============================================================================
+    // Asynchronous Writes
+    // ============================================================================
+
+    // Queues a write to be performed on the connection's writer thread
+    // handle: DataRef handle
+    // value: value to write (strings are copied before returning)
+    // priority: WRITE_PRIORITY_NORMAL or WRITE_PRIORITY_HIGH
+    // out_token: receives a token identifying the write (may be NULL)
+    // Queued high-priority writes always run before normal ones, with SDK priority mode
+    // enabled only for the duration of the high-priority batch. Within a priority,
+    // writes run in submission order. A high-priority write supersedes the normal writes
+    // still queued for the same DataRef: they complete with BRIDGE_ERR_SUPERSEDED without
+    // being sent, so an older value never lands after a newer one.
+    // Async writes bypass write buffering.
+    // Returns: BRIDGE_OK when queued, BRIDGE_ERR_QUEUE_FULL when the in-flight limit is reached
+    BRIDGE_API BridgeResult DataRef_SetIntAsync(DataRefHandle handle, int32_t value, int32_t priority, WriteToken* out_token);
+    BRIDGE_API BridgeResult DataRef_SetDoubleAsync(DataRefHandle handle, double value, int32_t priority, WriteToken* out_token);
+    BRIDGE_API BridgeResult DataRef_SetBoolAsync(DataRefHandle handle, bool value, int32_t priority, WriteToken* out_token);
+    BRIDGE_API BridgeResult DataRef_SetStringAsync(DataRefHandle handle, const char* value, int32_t priority, WriteToken* out_token);
+
+    // Sets the maximum number of queued plus executing async writes (default 256)
+    // instance: handle returned from ProSim_Create
+    // max_in_flight: limit, must be positive; can only be changed while no writes are pending
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_SetAsyncWriteLimit(void* instance, int32_t max_in_flight);
+
+    // Checks whether an async write has completed without blocking
+    // instance: handle returned from ProSim_Create
+    // token: token returned by DataRef_Set*Async
+    // out_completed: receives true once the write has run
+    // out_result: receives the write's result once completed (may be NULL)
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_ARGUMENT for an unknown or expired token
+    BRIDGE_API BridgeResult ProSim_PollWrite(void* instance, WriteToken token, bool* out_completed, BridgeResult* out_result);
+
+    // Blocks until an async write has completed
+    // instance: handle returned from ProSim_Create
+    // token: token returned by DataRef_Set*Async
+    // timeout_ms: maximum wait in milliseconds, or -1 to wait indefinitely
+    // out_result: receives the write's result (may be NULL)
+    // Returns: BRIDGE_OK once completed, BRIDGE_ERR_TIMEOUT on timeout, error code on failure
+    BRIDGE_API BridgeResult ProSim_WaitWrite(void* instance, WriteToken token, int32_t timeout_ms, BridgeResult* out_result);
+
+    // Gets the error message recorded for a failed async write
+    // instance: handle returned from ProSim_Create
+    // token: token returned by DataRef_Set*Async
+    // buffer: buffer to receive the null-terminated message (empty if the write succeeded)
+    // buffer_size: size of the buffer in bytes
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_GetWriteError(void* instance, WriteToken token, char* buffer, int32_t buffer_size);
+
+    // ============================================================================
+    // DataRef Sample History
+    // ============================================================================
+
+    // Gets the current time on the clock used to timestamp history samples
+    // out_seconds: pointer to receive the time in seconds (monotonic, arbitrary epoch)
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_GetTime(double* out_seconds);
+
+    // Enables or disables the sample history of a numeric DataRef
+    // handle: DataRef handle
+    // capacity: number of (timestamp, value) samples to keep; 0 disables history
+    // max_extrapolation_s: how far past the newest sample SAMPLE_MODE_EXTRAPOLATE may project
+    // Storage is allocated here; recording a sample never allocates. Reconfiguring clears
+    // recorded samples.
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_DATA for string or DateTime DataRefs,
+    //          BRIDGE_ERR_LIMIT_EXCEEDED if the ring would exceed max_history_bytes
+    BRIDGE_API BridgeResult DataRef_EnableHistory(DataRefHandle handle, int32_t capacity, double max_extrapolation_s);
+
+    // Gets the DataRef value at a point in time from its sample history
+    // handle: DataRef handle
+    // time: time in ProSim_GetTime seconds (typically the frame's presentation time)
+    // mode: SAMPLE_MODE_HOLD, SAMPLE_MODE_LINEAR or SAMPLE_MODE_EXTRAPOLATE
+    // out_value: pointer to receive the value
+    // Times before the oldest sample return the oldest value.
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_DATAREF_NOT_READY if no samples yet,
+    //          error code on failure
+    BRIDGE_API BridgeResult DataRef_SampleAt(DataRefHandle handle, double time, int32_t mode, double* out_value);
+
+    // ============================================================================
+    // AI Traffic
+    // ============================================================================
+
+    // Gets the number of AI traffic targets currently known
+    // instance: handle returned from ProSim_Create
+    // out_count: pointer to receive the count
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_GetTrafficCount(void* instance, int32_t* out_count);
+
+    // Copies all AI traffic targets into a caller buffer in a single call
+    // instance: handle returned from ProSim_Create
+    // buffer: array of TrafficTarget to fill (distance_nm is 0)
+    // capacity: number of elements in buffer
+    // out_total: receives the number of targets available; if greater than capacity,
+    //            only the first capacity targets were copied
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_GetTraffic(void* instance, TrafficTarget* buffer, int32_t capacity, int32_t* out_total);
+
+    // Copies the AI traffic targets near a position (typically ownship), nearest first
+    // instance: handle returned from ProSim_Create
+    // latitude, longitude: position in degrees
+    // altitude_ft: position altitude in feet
+    // radius_nm: horizontal range in nautical miles
+    // altitude_band_ft: maximum altitude difference in feet
+    // buffer: array of TrafficTarget to fill, with distance_nm set
+    // capacity: number of elements in buffer
+    // out_total: receives the number of matching targets; if greater than capacity,
+    //            the nearest capacity targets were copied
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_GetTrafficNear(void* instance, double latitude, double longitude, double altitude_ft,
+                                                   double radius_nm, double altitude_band_ft,
+                                                   TrafficTarget* buffer, int32_t capacity, int32_t* out_total);
+
+    // ============================================================================
+    // Relative Geometry
+    // ============================================================================
+
+    // Computes range, bearing, relative altitude and closure rate from a reference aircraft
+    // to count targets given as parallel arrays (struct-of-arrays)
+    // ownship: reference position and velocity
+    // latitudes, longitudes: target positions in degrees
+    // altitudes: target altitudes in feet
+    // ground_speeds, tracks: target velocity in knots and degrees true; both may be NULL
+    //                        for stationary targets
+    // count: number of targets
+    // out: array of count RelativeGeometry to fill
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_ComputeRelativeGeometry(const GeoState* ownship,
+                                                           const double* latitudes, const double* longitudes,
+                                                           const double* altitudes,
+                                                           const double* ground_speeds, const double* tracks,
+                                                           int32_t count, RelativeGeometry* out);
+
+    // Computes the geometry from a reference aircraft to planned reposition targets
+    // ownship: reference position and velocity
+    // targets: array of count RepositionData (ias and heading_magnetic are used as
+    //          the target's speed and track)
+    // out: array of count RelativeGeometry to fill
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_ComputeRepositionGeometry(const GeoState* ownship, const RepositionData* targets,
+                                                             int32_t count, RelativeGeometry* out);
+
+    // Computes the geometry from a reference aircraft to every AI traffic target
+    // instance: handle returned from ProSim_Create
+    // ownship: reference position and velocity
+    // out_ids: array receiving the target object ids (may be NULL)
+    // out: array of RelativeGeometry to fill, parallel to out_ids
+    // capacity: number of elements in out (and out_ids)
+    // out_total: receives the number of targets available
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_GetTrafficGeometry(void* instance, const GeoState* ownship, uint32_t* out_ids,
+                                                      RelativeGeometry* out, int32_t capacity, int32_t* out_total);
+
+    // ============================================================================
+    // Failure Catalog
+    // ============================================================================
+
+    // Reads every failure from the simulator into the native catalog and starts
+    // tracking armed failures; call again to pick up a changed failure list
+    // instance: handle returned from ProSim_Create
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_LoadFailureCatalog(void* instance);
+
+    // Copies the failure catalog in one call. Call with NULL buffers and zero capacities
+    // to get the required sizes; if either buffer is too small nothing is copied and
+    // BRIDGE_ERR_INVALID_ARGUMENT is returned with the sizes filled in.
+    // instance: handle returned from ProSim_Create
+    // records: array of FailureRecord to fill
+    // record_capacity: number of elements in records
+    // strings: buffer receiving the string table
+    // string_capacity: size of strings in bytes
+    // out_count: receives the number of failures
+    // out_string_size: receives the string table size in bytes
+    // out_version: receives the catalog version to pass to ProSim_GetFailureUpdates (may be NULL)
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_GetFailureCatalog(void* instance, FailureRecord* records, int32_t record_capacity,
+                                                     char* strings, int32_t string_capacity,
+                                                     int32_t* out_count, int32_t* out_string_size,
+                                                     uint32_t* out_version);
+
+    // Gets the armed-state changes made after a catalog version. A reload reports every
+    // record; re-fetch the catalog if out_count equals the catalog size.
+    // instance: handle returned from ProSim_Create
+    // since_version: version from a previous catalog or update call
+    // updates: array of FailureStateUpdate to fill
+    // capacity: number of elements in updates
+    // out_count: receives the number of changed failures
+    // out_version: receives the current version (may be NULL; unchanged on error)
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_ARGUMENT if updates is too small
+    BRIDGE_API BridgeResult ProSim_GetFailureUpdates(void* instance, uint32_t since_version,
+                                                     FailureStateUpdate* updates, int32_t capacity,
+                                                     int32_t* out_count, uint32_t* out_version);
+
+    // ============================================================================
+    // Failure Scenarios
+    // ============================================================================
+
+    // Arms a scenario of failures in one call. The scenario is parsed and every failure
+    // id resolved before anything is armed; a parse error or unknown id arms nothing
+    // and ProSim_GetLastError names the offending line.
+    // Scenario format, one armed failure per line ('#' comments):
+    //   arm <id>[,<id>...] [above <ft> | below <ft>] [speed <kt>]
+    //                      [after v1|takeoff|landing <seconds>] [delay <seconds>]
+    // instance: handle returned from ProSim_Create
+    // scenario: NUL-terminated UTF-8 scenario text
+    // out_result: receives counts and timings (may be NULL)
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_ArmFailureScenario(void* instance, const char* scenario,
+                                                      FailureScenarioResult* out_result);
+
+    // Same as ProSim_ArmFailureScenario, reading the scenario from a file
+    // instance: handle returned from ProSim_Create
+    // path: scenario file path
+    // out_result: receives counts and timings (may be NULL)
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_ArmFailureScenarioFile(void* instance, const char* path,
+                                                          FailureScenarioResult* out_result);
+
+    // ============================================================================
+    // Snapshots
+    // ============================================================================
+
+    // Captures the value of every DataRef the catalog marks readable and writable, for
+    // training resets. DataRefs that cannot be read in the current state, and DateTime or
+    // object values, are left out. Capturing reads each DataRef from the simulator once.
+    // instance: handle returned from ProSim_Create
+    // Returns: Snapshot handle, or NULL on failure (not connected)
+    BRIDGE_API SnapshotHandle ProSim_CaptureSnapshot(void* instance);
+
+    // Writes the snapshot values that differ from the simulator's current ones. Current
+    // values are read first, then the differing ones are written in one pass; values
+    // already equal are skipped. Writing continues past failures.
+    // instance: handle returned from ProSim_Create
+    // snapshot: handle from ProSim_CaptureSnapshot or Snapshot_Load, from any connection
+    // out_result: receives counts and timings (may be NULL)
+    // Returns: BRIDGE_OK if every differing value was written, otherwise the first
+    //          failure's code (ProSim_GetLastError describes the last failure)
+    BRIDGE_API BridgeResult ProSim_RestoreSnapshot(void* instance, SnapshotHandle snapshot,
+                                                   SnapshotRestoreResult* out_result);
+
+    // Gets the number of values in a snapshot
+    // snapshot: snapshot handle
+    // out_count: receives the count
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult Snapshot_GetCount(SnapshotHandle snapshot, int32_t* out_count);
+
+    // Saves a snapshot to a compact binary file (layout in Snapshot.h)
+    // snapshot: snapshot handle
+    // path: file path, replaced if it exists
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult Snapshot_Save(SnapshotHandle snapshot, const char* path);
+
+    // Loads a snapshot saved with Snapshot_Save
+    // path: file path
+    // Returns: Snapshot handle, or NULL on failure (ProSim_GetLastError says whether the
+    //          file could not be opened or is not a valid snapshot)
+    BRIDGE_API SnapshotHandle Snapshot_Load(const char* path);
+
+    // Destroys a snapshot
+    // snapshot: snapshot handle
+    BRIDGE_API void Snapshot_Destroy(SnapshotHandle snapshot);
+
+    // Compares two snapshots without touching the simulator, for checking that a restore
+    // took or comparing checkpoints. Entries are ordered by name.
+    // before: the earlier snapshot
+    // after: the later snapshot
+    // options: tolerances (NULL = values must be equal)
+    // Returns: Diff handle, or NULL on failure
+    BRIDGE_API SnapshotDiffHandle Snapshot_Diff(SnapshotHandle before, SnapshotHandle after,
+                                                const SnapshotDiffOptions* options);
+
+    // Gets the number of differences; 0 means the snapshots match
+    // diff: diff handle
+    // out_count: receives the count
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult SnapshotDiff_GetCount(SnapshotDiffHandle diff, int32_t* out_count);
+
+    // Gets one difference
+    // diff: diff handle
+    // index: 0 to count - 1
+    // out_entry: receives the difference
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult SnapshotDiff_GetEntry(SnapshotDiffHandle diff, int32_t index,
+                                                  SnapshotDiffEntry* out_entry);
+
+    // Writes the after value of every changed and added entry, in one pass and without
+    // reading the simulator first. Removed entries are skipped. Writing continues past
+    // failures; out_result.entries counts the values written or attempted.
+    // instance: handle returned from ProSim_Create
+    // diff: diff handle
+    // out_result: receives counts and timings; read_ms is 0 (may be NULL)
+    // Returns: BRIDGE_OK if every value was written, otherwise the first failure's code
+    BRIDGE_API BridgeResult ProSim_ApplySnapshotDiff(void* instance, SnapshotDiffHandle diff,
+                                                     SnapshotRestoreResult* out_result);
+
+    // Destroys a diff
+    // diff: diff handle
+    BRIDGE_API void SnapshotDiff_Destroy(SnapshotDiffHandle diff);
+
+    // ============================================================================
+    // Connection Pool
+    // ============================================================================
+
+    // Several simulator connections addressed by seat id. Each seat has its own
+    // connection and worker thread; batch calls run on every seat in parallel.
+    // Seat tasks must not call ProSimPool_* functions.
+
+    // Creates an empty connection pool
+    // Returns: pool handle, or NULL on failure
+    BRIDGE_API void* ProSimPool_Create(void);
+
+    // Destroys a pool and every seat connection it owns
+    // pool: handle returned from ProSimPool_Create
+    BRIDGE_API void ProSimPool_Destroy(void* pool);
+
+    // Adds a seat with its own (not yet connected) connection and worker thread
+    // pool: handle returned from ProSimPool_Create
+    // seat_id: caller-chosen id, unique within the pool
+    // host: host name or IP address used by ProSimPool_ConnectAll
+    // out_instance: receives the seat's connection handle (may be NULL); owned by the
+    //               pool, do not pass it to ProSim_Destroy
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSimPool_AddSeat(void* pool, int32_t seat_id, const char* host, void** out_instance);
+
+    // Runs the seat's queued tasks, then destroys its connection
+    // pool: handle returned from ProSimPool_Create
+    // seat_id: seat to remove
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSimPool_RemoveSeat(void* pool, int32_t seat_id);
+
+    // Gets the connection handle of a seat
+    // pool: handle returned from ProSimPool_Create
+    // seat_id: seat to look up
+    // out_instance: receives the seat's connection handle
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSimPool_GetSeat(void* pool, int32_t seat_id, void** out_instance);
+
+    // Gets the number of seats
+    // pool: handle returned from ProSimPool_Create
+    // out_count: receives the number of seats
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSimPool_GetSeatCount(void* pool, int32_t* out_count);
+
+    // Connects every seat to its host in parallel and waits for all of them
+    // pool: handle returned from ProSimPool_Create
+    // synchronous: passed to each seat's connect, as in ProSim_Connect
+    // out_seat_ids, out_results: per-seat ids and results in seat order (may be NULL)
+    // capacity: number of elements in out_seat_ids and out_results
+    // out_count: receives the number of seats (may be NULL)
+    // Returns: BRIDGE_OK if every seat connected, otherwise the first seat's error
+    BRIDGE_API BridgeResult ProSimPool_ConnectAll(void* pool, bool synchronous, int32_t* out_seat_ids,
+                                                  BridgeResult* out_results, int32_t capacity, int32_t* out_count);
+
+    // Runs a callback once per seat, each on that seat's worker thread, and waits for all of them
+    // pool: handle returned from ProSimPool_Create
+    // callback: function to run for each seat
+    // user_data: opaque pointer passed to callback
+    // out_seat_ids, out_results: per-seat ids and callback results in seat order (may be NULL)
+    // capacity: number of elements in out_seat_ids and out_results
+    // out_count: receives the number of seats (may be NULL)
+    // Returns: BRIDGE_OK if every callback succeeded, otherwise the first seat's error
+    BRIDGE_API BridgeResult ProSimPool_ForEach(void* pool, SeatTaskCallback callback, void* user_data,
+                                               int32_t* out_seat_ids, BridgeResult* out_results, int32_t capacity,
+                                               int32_t* out_count);
+
+    // Queues a callback on one seat's worker thread without waiting for it
+    // pool: handle returned from ProSimPool_Create
+    // seat_id: seat to run the callback for
+    // callback: function to run
+    // user_data: opaque pointer passed to callback
+    // Returns: BRIDGE_OK if queued, error code on failure
+    BRIDGE_API BridgeResult ProSimPool_Post(void* pool, int32_t seat_id, SeatTaskCallback callback, void* user_data);
+
+    // ============================================================================
+    // DataRef Fan-out Server
+    // ============================================================================
+
+    // An embedded loopback TCP server that rebroadcasts DataRef changes to local
+    // subscribers (dashboards, tools) using the FANOUT_MSG_* protocol, so they do not
+    // each need an SDK connection. Values come from attached connections or from the
+    // ProSimFanout_Publish* calls (e.g. a simulated source). A server takes up to 255
+    // subscribers; it closes further connections as soon as they arrive.
+
+    // Creates a fan-out server listening on 127.0.0.1
+    // port: TCP port, or 0 to pick a free one (see ProSimFanout_GetPort)
+    // Returns: server handle, or NULL on failure
+    BRIDGE_API void* ProSimFanout_Create(uint16_t port);
+
+    // Stops the server and disconnects its subscribers. Detach every connection first.
+    // server: handle returned from ProSimFanout_Create
+    BRIDGE_API void ProSimFanout_Destroy(void* server);
+
+    // Gets the port the server listens on
+    // server: handle returned from ProSimFanout_Create
+    // out_port: receives the port
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSimFanout_GetPort(void* server, uint16_t* out_port);
+
+    // Publishes every DataRef change of a connection to a server; DataRefs must exist
+    // (DataRef_Create) for their changes to be seen
+    // server: handle returned from ProSimFanout_Create, or NULL to detach
+    // instance: handle returned from ProSim_Create
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSimFanout_Attach(void* server, void* instance);
+
+    // Publishes a value directly; subscribers receive it if it changed
+    // server: handle returned from ProSimFanout_Create
+    // name: DataRef name (at most 255 bytes)
+    // value: value to publish
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSimFanout_PublishInt(void* server, const char* name, int32_t value);
+    BRIDGE_API BridgeResult ProSimFanout_PublishDouble(void* server, const char* name, double value);
+    BRIDGE_API BridgeResult ProSimFanout_PublishBool(void* server, const char* name, bool value);
+    BRIDGE_API BridgeResult ProSimFanout_PublishString(void* server, const char* name, const char* value);
+
+    // Gets server counters
+    // server: handle returned from ProSimFanout_Create
+    // out_stats: receives the counters
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSimFanout_GetStats(void* server, FanoutStats* out_stats);
+
+    // ============================================================================
+    // Wire Format
+    // ============================================================================
+
+    // Compact delta-encoded frames for streaming DataRef updates over a network or into
+    // a recording. An encoder and its decoder each keep the previous value of every slot,
+    // so frames must be decoded in order; a keyframe starts a new stream.
+
+    // Creates an encoder
+    // max_slots: number of slot ids (0 .. max_slots - 1) the stream uses
+    // Returns: encoder handle, or NULL on failure
+    BRIDGE_API void* ProSimWire_CreateEncoder(uint32_t max_slots);
+
+    // Destroys an encoder
+    // encoder: handle returned from ProSimWire_CreateEncoder
+    BRIDGE_API void ProSimWire_DestroyEncoder(void* encoder);
+
+    // Encodes a batch of updates into one frame
+    // encoder: handle returned from ProSimWire_CreateEncoder
+    // records: updates to encode
+    // count: number of records
+    // keyframe: reset the stream so a decoder can join (or recover) at this frame
+    // buffer: receives the frame
+    // capacity: size of buffer in bytes
+    // out_size: receives the frame size, or the required capacity if buffer is too small
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_ARGUMENT if buffer is too small
+    BRIDGE_API BridgeResult ProSimWire_Encode(void* encoder, const WireRecord* records, int32_t count, bool keyframe,
+                                              uint8_t* buffer, int32_t capacity, int32_t* out_size);
+
+    // Creates a decoder; it accepts frames from the next keyframe on
+    // max_slots: must match the encoder
+    // Returns: decoder handle, or NULL on failure
+    BRIDGE_API void* ProSimWire_CreateDecoder(uint32_t max_slots);
+
+    // Destroys a decoder
+    // decoder: handle returned from ProSimWire_CreateDecoder
+    BRIDGE_API void ProSimWire_DestroyDecoder(void* decoder);
+
+    // Decodes one frame. String values stay valid until the next decode.
+    // decoder: handle returned from ProSimWire_CreateDecoder
+    // frame: frame bytes
+    // size: frame size in bytes
+    // records: receives the updates
+    // capacity: number of records the array can hold
+    // out_count: receives the number of records (the required capacity if too small)
+    // out_sequence: receives the frame sequence number (can be NULL)
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_ARGUMENT if records is too small,
+    // BRIDGE_ERR_INVALID_DATA for a malformed frame or a missed frame (until a keyframe)
+    BRIDGE_API BridgeResult ProSimWire_Decode(void* decoder, const uint8_t* frame, int32_t size,
+                                              WireRecord* records, int32_t capacity,
+                                              int32_t* out_count, uint32_t* out_sequence);
+
+    // ============================================================================
+    // Memory Accounting
+    // ============================================================================
+
+    // Reports the memory used by a connection
+    // instance: handle returned from ProSim_Create
+    // out_stats: receives the figures
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_GetMemoryStats(void* instance, MemoryStats* out_stats);
+
+    // Sets caps on a connection's memory use; they apply to later creation calls only
+    // instance: handle returned from ProSim_Create
+    // limits: new caps, or NULL to remove all caps
+    // When a cap would be exceeded, ProSim_InternName and DataRef_EnableHistory return
+    // BRIDGE_ERR_LIMIT_EXCEEDED, and DataRef_Create/DataRef_CreateById return NULL with
+    // ProSim_GetLastError naming the limit.
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_ARGUMENT if max_datarefs is negative
+    //          or a byte limit exceeds INT64_MAX (a negative value converted to unsigned)
+    BRIDGE_API BridgeResult ProSim_SetMemoryLimits(void* instance, const MemoryLimits* limits);
+
     // ============================================================================
     // Connection Callbacks
     // ============================================================================
@@ -232,6 +1143,56 @@ extern "C" {
     // Returns: BRIDGE_OK on success, error code on failure
     BRIDGE_API BridgeResult DataRef_SetOnDataChange(DataRefHandle handle, DataRefChangeCallback callback, void* user_data);
 
+    // Registers one callback per update cycle carrying every DataRef of the connection that
+    // changed, with its value inline. It runs on the SDK event thread when the SDK reports the
+    // end of an update cycle and lists the changes recorded since the previous call. Its order
+    // relative to individual change callbacks is not defined (with callback dispatch they run
+    // on other threads), so it can replace them but should not depend on them.
+    // instance: handle returned from ProSim_Create
+    // callback: function pointer to call after each update cycle, or NULL to stop
+    // user_data: opaque pointer passed to callback
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult ProSim_SetOnDataRefsUpdated(void* instance, DataRefsUpdatedCallback callback, void* user_data);
+
+    // Runs the connection's DataRef change callbacks on a worker pool instead of the SDK
+    // event thread, so a slow callback only delays its own DataRef. Callbacks for one
+    // DataRef still never overlap and run in order. Queued callbacks finish before the
+    // previous pool stops. Must not be called from a DataRef callback.
+    // instance: handle returned from ProSim_Create
+    // options: pool settings, or NULL to run callbacks inline again
+    // Returns: BRIDGE_OK on success, BRIDGE_ERR_INVALID_ARGUMENT for invalid options
+    BRIDGE_API BridgeResult ProSim_SetCallbackDispatch(void* instance, const CallbackDispatchOptions* options);
+
+    // ============================================================================
+    // Triggers
+    // ============================================================================
+
+    // Creates a trigger that calls back when a condition over DataRefs turns on or off,
+    // e.g. condition "radio.alt < 50 && gear.down == 0" with release "radio.alt > 60"
+    // options: expressions, delays and polling interval
+    // callback: function pointer to call on each transition
+    // user_data: opaque pointer passed to callback
+    // connection: handle returned from ProSim_Create
+    // The expressions are compiled once and evaluated only in update cycles where one of
+    // their inputs changed. Delays are checked once per update cycle. The callback runs on
+    // the SDK event thread, after the cycle's DataRef change callbacks. A condition that is
+    // already true when the trigger is created turns it on in the next update cycle.
+    // Each expression counts as one DataRef against max_datarefs.
+    // Triggers must be destroyed before their connection.
+    // Returns: Handle to the trigger, or NULL on failure (ProSim_GetLastError gives the
+    //          column of an expression error)
+    BRIDGE_API TriggerHandle Trigger_Create(const TriggerOptions* options, TriggerCallback callback, void* user_data, void* connection);
+
+    // Gets whether a trigger is on
+    // trigger: handle returned from Trigger_Create
+    // out_active: receives the state last reported to the callback
+    // Returns: BRIDGE_OK on success, error code on failure
+    BRIDGE_API BridgeResult Trigger_IsActive(TriggerHandle trigger, bool* out_active);
+
+    // Destroys a trigger; may be called from its own callback
+    // trigger: handle returned from Trigger_Create
+    BRIDGE_API void Trigger_Destroy(TriggerHandle trigger);
+
     // ============================================================================
     // Error Handling
     // ============================================================================
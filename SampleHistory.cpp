@@ -0,0 +1,117 @@
+// SampleHistory.cpp
+// Implementation of the DataRef sample history ring
+
+#include "pch.h"
+#include "SampleHistory.h"
+
+SampleHistory::SampleHistory()
+    : _head(0)
+    , _count(0)
+    , _maxExtrapolation(0.0)
+    , _enabled(0)
+{
+}
+
+BridgeResult SampleHistory::Configure(int32_t capacity, double maxExtrapolationSeconds) {
+    if (capacity < 0 || !(maxExtrapolationSeconds >= 0.0)) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    ExclusiveLock guard(_lock);
+    std::vector<Sample>(static_cast<size_t>(capacity)).swap(_samples);
+    _head = 0;
+    _count = 0;
+    _maxExtrapolation = maxExtrapolationSeconds;
+    InterlockedExchange(&_enabled, capacity > 0 ? 1 : 0);
+    return BRIDGE_OK;
+}
+
+size_t SampleHistory::Bytes() {
+    SharedLock guard(_lock);
+    return _samples.capacity() * sizeof(Sample);
+}
+
+void SampleHistory::Push(double time, double value) {
+    ExclusiveLock guard(_lock);
+    if (_samples.empty()) {
+        return;
+    }
+
+    if (_count < _samples.size()) {
+        Sample& slot = _samples[(_head + _count) % _samples.size()];
+        slot.time = time;
+        slot.value = value;
+        ++_count;
+    }
+    else {
+        Sample& slot = _samples[_head];
+        slot.time = time;
+        slot.value = value;
+        _head = (_head + 1) % _samples.size();
+    }
+}
+
+BridgeResult SampleHistory::SampleAt(double time, int32_t mode, double* outValue) {
+    if (!outValue) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    if (mode != SAMPLE_MODE_HOLD && mode != SAMPLE_MODE_LINEAR && mode != SAMPLE_MODE_EXTRAPOLATE) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    SharedLock guard(_lock);
+    if (_count == 0) {
+        return BRIDGE_ERR_DATAREF_NOT_READY;
+    }
+
+    const Sample& oldest = At(0);
+    const Sample& newest = At(_count - 1);
+
+    // Before the recorded window: never extrapolate backwards
+    if (time <= oldest.time) {
+        *outValue = oldest.value;
+        return BRIDGE_OK;
+    }
+
+    // After the newest sample: hold, or continue the last segment's slope for at most
+    // _maxExtrapolation seconds so a stalled DataRef does not run away
+    if (time >= newest.time) {
+        *outValue = newest.value;
+        if (mode == SAMPLE_MODE_EXTRAPOLATE && _count >= 2) {
+            const Sample& previous = At(_count - 2);
+            double span = newest.time - previous.time;
+            if (span > 0.0) {
+                double ahead = time - newest.time;
+                if (ahead > _maxExtrapolation) {
+                    ahead = _maxExtrapolation;
+                }
+                *outValue = newest.value + (newest.value - previous.value) * (ahead / span);
+            }
+        }
+        return BRIDGE_OK;
+    }
+
+    // Binary search for the last sample at or before time; oldest.time < time < newest.time
+    size_t lo = 0;
+    size_t hi = _count - 1;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (At(mid).time <= time) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    const Sample& before = At(lo);
+    const Sample& after = At(hi);
+    double span = after.time - before.time;
+    if (mode == SAMPLE_MODE_HOLD || span <= 0.0) {
+        *outValue = before.value;
+    }
+    else {
+        *outValue = before.value + (after.value - before.value) * ((time - before.time) / span);
+    }
+    return BRIDGE_OK;
+}
@@ -0,0 +1,50 @@
+// SampleHistory.h
+// Fixed-size ring of timestamped DataRef samples
+// Lets a renderer running faster than the DataRef update rate read smoothly
+// interpolated (or briefly extrapolated) values for any time it chooses
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "ProSimBridge.h"
+#include "NativeSupport.h"
+
+class SampleHistory {
+private:
+    struct Sample {
+        double time;                    // MonotonicClock seconds
+        double value;
+    };
+
+    SrwLock _lock;                      // guards everything below
+    std::vector<Sample> _samples;       // ring buffer, preallocated to capacity
+    size_t _head;                       // oldest sample
+    size_t _count;
+    double _maxExtrapolation;           // seconds
+    volatile LONG _enabled;
+
+    const Sample& At(size_t index) const { return _samples[(_head + index) % _samples.size()]; }
+
+    SampleHistory(const SampleHistory&) = delete;
+    SampleHistory& operator=(const SampleHistory&) = delete;
+
+public:
+    SampleHistory();
+
+    // Allocates room for capacity samples (0 disables history and frees the ring)
+    // and clears any recorded samples
+    BridgeResult Configure(int32_t capacity, double maxExtrapolationSeconds);
+    bool IsEnabled() const { return _enabled != 0; }
+
+    // Bytes held by the ring, and the bytes a ring of capacity samples would hold
+    size_t Bytes();
+    static size_t BytesFor(int32_t capacity) { return capacity > 0 ? static_cast<size_t>(capacity) * sizeof(Sample) : 0; }
+
+    // Appends a sample, overwriting the oldest when the ring is full
+    void Push(double time, double value);
+
+    // Value at time t using a SAMPLE_MODE_* mode
+    // Returns BRIDGE_ERR_DATAREF_NOT_READY if no samples have been recorded yet
+    BridgeResult SampleAt(double time, int32_t mode, double* outValue);
+};
@@ -0,0 +1,204 @@
+// SlabPool.cpp
+// Implementation of the DataRef slab pool and name arena
+
+#include "pch.h"
+#include "SlabPool.h"
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+// ============================================================================
+// SlabPool Implementation
+// ============================================================================
+
+SlabPool::SlabPool(size_t blockSize, size_t blocksPerSlab)
+    : _freeList(nullptr)
+    , _blocksPerSlab(blocksPerSlab)
+    , _inUse(0)
+    , _limit(0)
+{
+    // Keep every block aligned for any type, and large enough to hold the free-list link
+    const size_t alignment = alignof(std::max_align_t);
+    if (blockSize < sizeof(FreeBlock)) {
+        blockSize = sizeof(FreeBlock);
+    }
+    _blockSize = (blockSize + alignment - 1) & ~(alignment - 1);
+}
+
+SlabPool::~SlabPool() {
+    for (size_t i = 0; i < _slabs.size(); ++i) {
+        ::operator delete(_slabs[i]);
+    }
+}
+
+void* SlabPool::Allocate() {
+    ExclusiveLock guard(_lock);
+    if (_limit != 0 && _inUse >= _limit) {
+        return nullptr;
+    }
+    if (!_freeList) {
+        // Thread the new slab onto the free list, first block on top
+        char* slab = static_cast<char*>(::operator new(_blockSize * _blocksPerSlab));
+        _slabs.push_back(slab);
+        for (size_t i = _blocksPerSlab; i > 0; --i) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + (i - 1) * _blockSize);
+            block->next = _freeList;
+            _freeList = block;
+        }
+    }
+
+    FreeBlock* block = _freeList;
+    _freeList = block->next;
+    ++_inUse;
+    return block;
+}
+
+size_t SlabPool::Free(void* block) {
+    ExclusiveLock guard(_lock);
+    if (block) {
+        FreeBlock* freed = static_cast<FreeBlock*>(block);
+        freed->next = _freeList;
+        _freeList = freed;
+        --_inUse;
+    }
+    return _inUse;
+}
+
+size_t SlabPool::SlabCount() {
+    SharedLock guard(_lock);
+    return _slabs.size();
+}
+
+size_t SlabPool::InUse() {
+    SharedLock guard(_lock);
+    return _inUse;
+}
+
+size_t SlabPool::Bytes() {
+    SharedLock guard(_lock);
+    return _slabs.size() * _blockSize * _blocksPerSlab;
+}
+
+void SlabPool::SetLimit(size_t maxBlocks) {
+    ExclusiveLock guard(_lock);
+    _limit = maxBlocks;
+}
+
+// ============================================================================
+// NameArena Implementation
+// ============================================================================
+
+size_t NameArena::NameHash::operator()(const char* name) const {
+    // FNV-1a
+    size_t hash = static_cast<size_t>(2166136261u);
+    for (; *name; ++name) {
+        hash = (hash ^ static_cast<unsigned char>(*name)) * static_cast<size_t>(16777619u);
+    }
+    return hash;
+}
+
+bool NameArena::NameEqual::operator()(const char* a, const char* b) const {
+    return strcmp(a, b) == 0;
+}
+
+NameArena::NameArena()
+    : _current(nullptr)
+    , _chunkUsed(ChunkSize)
+    , _bytes(0)
+    , _reserved(0)
+    , _limit(0)
+{
+}
+
+NameArena::~NameArena() {
+    for (size_t i = 0; i < _chunks.size(); ++i) {
+        delete[] _chunks[i];
+    }
+}
+
+const char* NameArena::Intern(const char* name, uint32_t* outId) {
+    {
+        SharedLock guard(_lock);
+        auto found = _ids.find(name);
+        if (found != _ids.end()) {
+            *outId = found->second;
+            return found->first;
+        }
+    }
+
+    ExclusiveLock guard(_lock);
+    auto found = _ids.find(name);
+    if (found != _ids.end()) {
+        // Added by another thread in between
+        *outId = found->second;
+        return found->first;
+    }
+
+    size_t length = strlen(name) + 1;
+    if (_limit != 0 && _bytes + length > _limit) {
+        return nullptr;
+    }
+
+    char* copy;
+    if (length > ChunkSize / 4) {
+        // Long names get their own chunk rather than wasting the rest of the current one
+        copy = new char[length];
+        _chunks.push_back(copy);
+        _reserved += length;
+    }
+    else {
+        if (_chunkUsed + length > ChunkSize) {
+            _current = new char[ChunkSize];
+            _chunks.push_back(_current);
+            _chunkUsed = 0;
+            _reserved += ChunkSize;
+        }
+        copy = _current + _chunkUsed;
+        _chunkUsed += length;
+    }
+    memcpy(copy, name, length);
+    _bytes += length;
+
+    uint32_t id = static_cast<uint32_t>(_names.size());
+    _names.push_back(copy);
+    _ids.emplace(copy, id);
+    *outId = id;
+    return copy;
+}
+
+bool NameArena::Find(const char* name, uint32_t* outId) {
+    SharedLock guard(_lock);
+    auto found = _ids.find(name);
+    if (found == _ids.end()) {
+        return false;
+    }
+    *outId = found->second;
+    return true;
+}
+
+const char* NameArena::Name(uint32_t id) {
+    SharedLock guard(_lock);
+    return (id < _names.size()) ? _names[id] : nullptr;
+}
+
+size_t NameArena::Count() {
+    SharedLock guard(_lock);
+    return _names.size();
+}
+
+size_t NameArena::Bytes() {
+    SharedLock guard(_lock);
+    return _bytes;
+}
+
+size_t NameArena::ReservedBytes() {
+    SharedLock guard(_lock);
+    // Hash nodes are approximated as the entry plus a next pointer and a bucket pointer
+    size_t index = _ids.size() * (sizeof(std::pair<const char*, uint32_t>) + 2 * sizeof(void*));
+    return _reserved + _chunks.capacity() * sizeof(char*) + _names.capacity() * sizeof(const char*) + index;
+}
+
+void NameArena::SetLimit(size_t maxBytes) {
+    ExclusiveLock guard(_lock);
+    _limit = maxBytes;
+}
@@ -0,0 +1,110 @@
+// SlabPool.h
+// Per-connection allocators for DataRef wrappers and their names
+// SlabPool hands out fixed-size blocks carved from large slabs and recycles freed
+// blocks through a free list, so creating and destroying thousands of DataRefs does
+// not touch the heap once the slabs exist. NameArena stores each distinct name once in
+// large chunks and numbers them densely from 0 in the order they were first seen; names
+// and ids stay valid until the arena is destroyed.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "NativeSupport.h"
+
+// ============================================================================
+// SlabPool
+// ============================================================================
+
+class SlabPool {
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    SrwLock _lock;                      // guards everything below
+    std::vector<char*> _slabs;
+    FreeBlock* _freeList;
+    size_t _blockSize;
+    size_t _blocksPerSlab;
+    size_t _inUse;
+    size_t _limit;                      // cap on _inUse, 0 = unlimited
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+public:
+    SlabPool(size_t blockSize, size_t blocksPerSlab);
+    ~SlabPool();
+
+    // Returns an uninitialized block, or null if the block limit is reached;
+    // throws std::bad_alloc if a new slab cannot be allocated
+    void* Allocate();
+
+    // Returns a block to the pool and the number of blocks still in use
+    size_t Free(void* block);
+
+    size_t BlockSize() const { return _blockSize; }
+    size_t SlabCount();
+    size_t InUse();
+
+    // Bytes held in slabs, used or free
+    size_t Bytes();
+
+    // Caps the number of blocks in use (0 = unlimited); blocks already handed out stay
+    void SetLimit(size_t maxBlocks);
+};
+
+// ============================================================================
+// NameArena
+// ============================================================================
+
+class NameArena {
+private:
+    static const size_t ChunkSize = 64 * 1024;
+
+    struct NameHash {
+        size_t operator()(const char* name) const;
+    };
+    struct NameEqual {
+        bool operator()(const char* a, const char* b) const;
+    };
+
+    SrwLock _lock;                      // guards everything below
+    std::vector<char*> _chunks;
+    char* _current;                     // chunk that new names are appended to
+    size_t _chunkUsed;                  // bytes used in _current
+    size_t _bytes;                      // bytes used by names across all chunks
+    size_t _reserved;                   // bytes allocated for chunks
+    size_t _limit;                      // cap on _bytes, 0 = unlimited
+    std::unordered_map<const char*, uint32_t, NameHash, NameEqual> _ids;
+    std::vector<const char*> _names;    // by id
+
+    NameArena(const NameArena&) = delete;
+    NameArena& operator=(const NameArena&) = delete;
+
+public:
+    NameArena();
+    ~NameArena();
+
+    // Returns the arena's copy of name and its id, adding it on first use
+    // Returns null if adding the name would exceed the byte limit
+    const char* Intern(const char* name, uint32_t* outId);
+
+    // Looks up a name without adding it; returns false if it has not been interned
+    bool Find(const char* name, uint32_t* outId);
+
+    // Returns the name with this id, or null if no such id has been issued
+    const char* Name(uint32_t id);
+
+    size_t Count();
+    size_t Bytes();
+
+    // Bytes allocated for chunks and the id index
+    size_t ReservedBytes();
+
+    // Caps the bytes of distinct names stored (0 = unlimited); names already stored stay
+    void SetLimit(size_t maxBytes);
+};
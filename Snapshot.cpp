@@ -0,0 +1,222 @@
+// Snapshot.cpp
+// Implementation of sim-state snapshots and their file format
+
+#include "pch.h"
+#include "Snapshot.h"
+#include <cstdio>
+#include <cstring>
+
+// Byte packing only; compile it native rather than to IL
+#pragma managed(push, off)
+
+namespace {
+
+const uint32_t SnapshotMagic = 0x504E5350;     // "PSNP"
+const uint16_t SnapshotVersion = 1;
+const size_t HeaderSize = 12;
+
+void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void PutU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void PutU64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// Bounds-checked reader over a loaded file; every Get fails once the data runs out
+class Reader {
+private:
+    const uint8_t* _p;
+    const uint8_t* _end;
+
+public:
+    Reader(const uint8_t* data, size_t size) : _p(data), _end(data + size) {}
+
+    bool AtEnd() const { return _p == _end; }
+
+    bool Get(uint64_t* out, int bytes) {
+        if (_end - _p < bytes) {
+            return false;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(_p[i]) << (8 * i);
+        }
+        _p += bytes;
+        *out = value;
+        return true;
+    }
+
+    bool GetBytes(std::string* out, size_t length) {
+        if (static_cast<size_t>(_end - _p) < length) {
+            return false;
+        }
+        out->assign(reinterpret_cast<const char*>(_p), length);
+        _p += length;
+        return true;
+    }
+};
+
+} // namespace
+
+// ============================================================================
+// SimSnapshot Implementation
+// ============================================================================
+
+bool SimSnapshot::Add(const char* name, size_t nameLength, const BridgeValue& value) {
+    if (nameLength > MaxNameLength) {
+        return false;
+    }
+    _entries.push_back(Entry());
+    Entry& entry = _entries.back();
+    entry.name.assign(name, nameLength);
+    entry.value = value;
+    return true;
+}
+
+bool SimSnapshot::SameValue(const BridgeValue& a, const BridgeValue& b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    switch (a.type) {
+    case DATAREF_TYPE_INT:    return a.intValue == b.intValue;
+    case DATAREF_TYPE_DOUBLE: return a.doubleValue == b.doubleValue ||
+                                     (a.doubleValue != a.doubleValue && b.doubleValue != b.doubleValue);
+    case DATAREF_TYPE_BOOL:   return a.boolValue == b.boolValue;
+    case DATAREF_TYPE_STRING: return a.stringValue == b.stringValue;
+    default:                  return false;
+    }
+}
+
+BridgeResult SimSnapshot::SaveFile(const char* path) {
+    std::vector<uint8_t> data;
+    data.reserve(HeaderSize + _entries.size() * 32);
+    PutU32(data, SnapshotMagic);
+    PutU16(data, SnapshotVersion);
+    PutU16(data, 0);
+    PutU32(data, static_cast<uint32_t>(_entries.size()));
+
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        const Entry& entry = _entries[i];
+        PutU16(data, static_cast<uint16_t>(entry.name.size()));
+        data.insert(data.end(), entry.name.begin(), entry.name.end());
+        data.push_back(static_cast<uint8_t>(entry.value.type));
+        switch (entry.value.type) {
+        case DATAREF_TYPE_INT:
+            PutU32(data, static_cast<uint32_t>(entry.value.intValue));
+            break;
+        case DATAREF_TYPE_DOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, &entry.value.doubleValue, sizeof(bits));
+            PutU64(data, bits);
+            break;
+        }
+        case DATAREF_TYPE_BOOL:
+            data.push_back(entry.value.boolValue ? 1 : 0);
+            break;
+        default: {
+            const std::string& str = entry.value.stringValue;
+            PutU32(data, static_cast<uint32_t>(str.size()));
+            data.insert(data.end(), str.begin(), str.end());
+            break;
+        }
+        }
+    }
+
+    FILE* file = nullptr;
+    if (fopen_s(&file, path, "wb") != 0 || !file) {
+        _error = std::string("cannot create snapshot file '") + path + "'";
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = (fclose(file) == 0) && written;
+    if (!written) {
+        _error = std::string("cannot write snapshot file '") + path + "'";
+        return BRIDGE_ERR_EXCEPTION;
+    }
+    return BRIDGE_OK;
+}
+
+BridgeResult SimSnapshot::LoadFile(const char* path) {
+    FILE* file = nullptr;
+    if (fopen_s(&file, path, "rb") != 0 || !file) {
+        _error = std::string("cannot open snapshot file '") + path + "'";
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(file);
+
+    Reader reader(data.data(), data.size());
+    uint64_t magic, version, reserved, count;
+    if (!reader.Get(&magic, 4) || magic != SnapshotMagic || !reader.Get(&version, 2) ||
+        !reader.Get(&reserved, 2) || !reader.Get(&count, 4)) {
+        _error = std::string("'") + path + "' is not a snapshot file";
+        return BRIDGE_ERR_INVALID_DATA;
+    }
+    if (version != SnapshotVersion) {
+        _error = std::string("'") + path + "' has unsupported snapshot version " + std::to_string(version);
+        return BRIDGE_ERR_INVALID_DATA;
+    }
+
+    // Every entry takes at least 4 bytes, so a corrupt count cannot reserve much
+    std::vector<Entry> entries;
+    entries.reserve((count < data.size() / 4) ? static_cast<size_t>(count) : data.size() / 4);
+    for (uint64_t i = 0; i < count; ++i) {
+        entries.push_back(Entry());
+        Entry& entry = entries.back();
+        uint64_t nameLength, type, value;
+        bool ok = reader.Get(&nameLength, 2) && reader.GetBytes(&entry.name, static_cast<size_t>(nameLength)) &&
+                  reader.Get(&type, 1);
+        if (ok) {
+            entry.value.type = static_cast<int32_t>(type);
+            switch (entry.value.type) {
+            case DATAREF_TYPE_INT:
+                ok = reader.Get(&value, 4);
+                entry.value.intValue = static_cast<int32_t>(static_cast<uint32_t>(value));
+                break;
+            case DATAREF_TYPE_DOUBLE:
+                ok = reader.Get(&value, 8);
+                memcpy(&entry.value.doubleValue, &value, sizeof(value));
+                break;
+            case DATAREF_TYPE_BOOL:
+                ok = reader.Get(&value, 1);
+                entry.value.boolValue = (value != 0);
+                break;
+            case DATAREF_TYPE_STRING:
+                ok = reader.Get(&value, 4) && reader.GetBytes(&entry.value.stringValue, static_cast<size_t>(value));
+                break;
+            default:
+                ok = false;
+                break;
+            }
+        }
+        if (!ok) {
+            _error = std::string("snapshot file '") + path + "' is truncated or corrupt at entry " + std::to_string(i);
+            return BRIDGE_ERR_INVALID_DATA;
+        }
+    }
+    if (!reader.AtEnd()) {
+        _error = std::string("snapshot file '") + path + "' has trailing data";
+        return BRIDGE_ERR_INVALID_DATA;
+    }
+
+    _entries.swap(entries);
+    return BRIDGE_OK;
+}
+
+#pragma managed(pop)
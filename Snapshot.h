@@ -0,0 +1,51 @@
+// Snapshot.h
+// Captured values of a simulator's writable DataRefs, for training resets
+// A snapshot is a list of (name, value) pairs taken by ProSim_CaptureSnapshot. It can be
+// saved to and loaded from a compact binary file, and ProSim_RestoreSnapshot writes back
+// the values that differ from the simulator's current ones.
+//
+// File layout (little-endian):
+//   u32 magic 'PSNP', u16 version, u16 reserved (0), u32 entry_count, then per entry:
+//   u16 name_length, name (UTF-8, not terminated), u8 type (DATAREF_TYPE_*), value
+//   value: int i32, double f64, bool u8, string u32 length + UTF-8 bytes
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "ProSimBridge.h"
+#include "WritePipeline.h"
+
+class SimSnapshot {
+public:
+    struct Entry {
+        std::string name;
+        BridgeValue value;              // DATAREF_TYPE_INT, _DOUBLE, _BOOL or _STRING
+    };
+
+    static const size_t MaxNameLength = 0xFFFF;
+
+private:
+    std::vector<Entry> _entries;
+    std::string _error;
+
+public:
+    // Adds an entry; names longer than MaxNameLength are rejected
+    bool Add(const char* name, size_t nameLength, const BridgeValue& value);
+
+    const std::vector<Entry>& Entries() const { return _entries; }
+
+    // Whether two values are the same type and value (NaN equals NaN)
+    static bool SameValue(const BridgeValue& a, const BridgeValue& b);
+
+    // Writes the snapshot; on failure Error() says why
+    BridgeResult SaveFile(const char* path);
+
+    // Replaces the entries with a saved snapshot; BRIDGE_ERR_INVALID_DATA for a file that
+    // is not a snapshot or is truncated
+    BridgeResult LoadFile(const char* path);
+
+    const std::string& Error() const { return _error; }
+};
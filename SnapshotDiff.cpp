@@ -0,0 +1,187 @@
+// SnapshotDiff.cpp
+// Implementation of the snapshot diff and its column comparison kernel
+// Compiled as native code: SSE2 intrinsics are not available in managed functions.
+
+#include "pch.h"
+#include "SnapshotDiff.h"
+#include <algorithm>
+#include <math.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SNAPSHOT_DIFF_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#pragma managed(push, off)
+
+namespace {
+    // Positions of a snapshot's entries, ordered by name
+    std::vector<uint32_t> OrderByName(const std::vector<SimSnapshot::Entry>& entries) {
+        std::vector<uint32_t> order(entries.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        auto byName = [&entries](uint32_t a, uint32_t b) { return entries[a].name < entries[b].name; };
+        // Skip the sort when the entries are already in order
+        if (!std::is_sorted(order.begin(), order.end(), byName)) {
+            std::sort(order.begin(), order.end(), byName);
+        }
+        return order;
+    }
+
+    // One numeric type's matched values, one row per name present in both snapshots
+    struct Columns {
+        std::vector<double> before;
+        std::vector<double> after;
+        std::vector<uint32_t> pair;     // index into the merged pair list
+        std::vector<uint32_t> hits;
+
+        void Add(double b, double a, size_t pairIndex) {
+            before.push_back(b);
+            after.push_back(a);
+            pair.push_back(static_cast<uint32_t>(pairIndex));
+        }
+
+        void MarkDiffering(double tolerance, std::vector<uint8_t>& differs) {
+            hits.resize(before.size());
+            size_t count = SnapshotDiff::CompareColumns(before.data(), after.data(), before.size(),
+                                                        tolerance, hits.data());
+            for (size_t i = 0; i < count; ++i) {
+                differs[pair[hits[i]]] = 1;
+            }
+        }
+    };
+
+    const uint32_t Missing = 0xFFFFFFFFu;
+}
+
+// ============================================================================
+// SnapshotDiff Implementation
+// ============================================================================
+
+void SnapshotDiff::Compute(const SimSnapshot& before, const SimSnapshot& after,
+                           double doubleTolerance, double intTolerance) {
+    const std::vector<SimSnapshot::Entry>& left = before.Entries();
+    const std::vector<SimSnapshot::Entry>& right = after.Entries();
+    std::vector<uint32_t> leftOrder = OrderByName(left);
+    std::vector<uint32_t> rightOrder = OrderByName(right);
+
+    // Merge by name. Numeric pairs go to their type's columns for the batch compare; every
+    // other pair is decided here.
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    pairs.reserve(std::max(left.size(), right.size()));
+    std::vector<uint8_t> differs;
+    differs.reserve(pairs.capacity());
+    Columns doubles, ints;
+    size_t l = 0, r = 0;
+    _compared = 0;
+    while (l < leftOrder.size() || r < rightOrder.size()) {
+        int order;
+        if (l == leftOrder.size()) order = 1;
+        else if (r == rightOrder.size()) order = -1;
+        else order = left[leftOrder[l]].name.compare(right[rightOrder[r]].name);
+
+        if (order < 0) {
+            pairs.push_back(std::make_pair(leftOrder[l++], Missing));
+            differs.push_back(1);
+            continue;
+        }
+        if (order > 0) {
+            pairs.push_back(std::make_pair(Missing, rightOrder[r++]));
+            differs.push_back(1);
+            continue;
+        }
+
+        const BridgeValue& a = left[leftOrder[l]].value;
+        const BridgeValue& b = right[rightOrder[r]].value;
+        pairs.push_back(std::make_pair(leftOrder[l++], rightOrder[r++]));
+        differs.push_back(0);
+        ++_compared;
+        if (a.type != b.type) {
+            differs.back() = 1;
+        }
+        else if (a.type == DATAREF_TYPE_DOUBLE) {
+            doubles.Add(a.doubleValue, b.doubleValue, pairs.size() - 1);
+        }
+        else if (a.type == DATAREF_TYPE_INT) {
+            // Every int32 is exact as a double, so ints share the double kernel
+            ints.Add(a.intValue, b.intValue, pairs.size() - 1);
+        }
+        else if (!SimSnapshot::SameValue(a, b)) {
+            differs.back() = 1;
+        }
+    }
+    doubles.MarkDiffering(doubleTolerance, differs);
+    ints.MarkDiffering(intTolerance, differs);
+
+    _entries.clear();
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (!differs[i]) {
+            continue;
+        }
+        _entries.push_back(Entry());
+        Entry& entry = _entries.back();
+        if (pairs[i].first != Missing) {
+            entry.name = left[pairs[i].first].name;
+            entry.before = left[pairs[i].first].value;
+        }
+        if (pairs[i].second != Missing) {
+            entry.name = right[pairs[i].second].name;
+            entry.after = right[pairs[i].second].value;
+        }
+        entry.kind = (pairs[i].first == Missing) ? SNAPSHOT_DIFF_ADDED :
+                     (pairs[i].second == Missing) ? SNAPSHOT_DIFF_REMOVED : SNAPSHOT_DIFF_CHANGED;
+    }
+}
+
+size_t SnapshotDiff::CompareColumnsScalar(const double* a, const double* b, size_t count,
+                                          double tolerance, uint32_t* outIndices) {
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // A NaN difference (NaN on either side, or inf - inf) never exceeds the tolerance
+        bool apart = fabs(a[i] - b[i]) > tolerance;
+        bool oneNan = (a[i] != a[i]) != (b[i] != b[i]);
+        if (apart || oneNan) {
+            outIndices[found++] = static_cast<uint32_t>(i);
+        }
+    }
+    return found;
+}
+
+size_t SnapshotDiff::CompareColumns(const double* a, const double* b, size_t count,
+                                    double tolerance, uint32_t* outIndices) {
+#ifdef SNAPSHOT_DIFF_SSE2
+    const __m128d signBit = _mm_set1_pd(-0.0);
+    const __m128d limit = _mm_set1_pd(tolerance);
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d va = _mm_loadu_pd(a + i);
+        __m128d vb = _mm_loadu_pd(b + i);
+        __m128d apart = _mm_cmpgt_pd(_mm_andnot_pd(signBit, _mm_sub_pd(va, vb)), limit);
+        __m128d oneNan = _mm_xor_pd(_mm_cmpunord_pd(va, va), _mm_cmpunord_pd(vb, vb));
+        int mask = _mm_movemask_pd(_mm_or_pd(apart, oneNan));
+        if (mask) {
+            // Most pairs match, so the branch is rarely taken
+            if (mask & 1) outIndices[found++] = static_cast<uint32_t>(i);
+            if (mask & 2) outIndices[found++] = static_cast<uint32_t>(i + 1);
+        }
+    }
+    if (i < count && CompareColumnsScalar(a + i, b + i, 1, tolerance, outIndices + found)) {
+        outIndices[found++] = static_cast<uint32_t>(i);
+    }
+    return found;
+#else
+    return CompareColumnsScalar(a, b, count, tolerance, outIndices);
+#endif
+}
+
+bool SnapshotDiff::IsVectorized() {
+#ifdef SNAPSHOT_DIFF_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+#pragma managed(pop)
@@ -0,0 +1,54 @@
+// SnapshotDiff.h
+// Differences between two sim-state snapshots, for debriefs and reset checks
+// Both snapshots are ordered by name and merged. Matched int and double values are gathered
+// into struct-of-arrays columns and compared two per SSE2 register; builds without SSE2 use
+// the scalar loop. Bool and string values are compared one by one.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "ProSimBridge.h"
+#include "Snapshot.h"
+
+class SnapshotDiff {
+public:
+    struct Entry {
+        std::string name;
+        int32_t kind;                   // SNAPSHOT_DIFF_*
+        BridgeValue before;             // type DATAREF_TYPE_UNKNOWN when added
+        BridgeValue after;              // type DATAREF_TYPE_UNKNOWN when removed
+    };
+
+private:
+    std::vector<Entry> _entries;        // ordered by name
+    size_t _compared;
+
+public:
+    SnapshotDiff() : _compared(0) {}
+
+    // Replaces the diff with the differences from before to after. Doubles differ when more
+    // than doubleTolerance apart and ints when more than intTolerance apart; bools and strings
+    // must be equal. A value whose type changed always differs, and NaN only equals NaN.
+    void Compute(const SimSnapshot& before, const SimSnapshot& after,
+                 double doubleTolerance, double intTolerance);
+
+    const std::vector<Entry>& Entries() const { return _entries; }
+
+    // Names present in both snapshots
+    size_t Compared() const { return _compared; }
+
+    // Stores in outIndices the positions where a[i] and b[i] differ by more than tolerance,
+    // or where exactly one of them is NaN, and returns how many were stored
+    static size_t CompareColumns(const double* a, const double* b, size_t count,
+                                 double tolerance, uint32_t* outIndices);
+
+    // Same as CompareColumns without SIMD
+    static size_t CompareColumnsScalar(const double* a, const double* b, size_t count,
+                                       double tolerance, uint32_t* outIndices);
+
+    // True if CompareColumns uses the SIMD kernel in this build
+    static bool IsVectorized();
+};
@@ -0,0 +1,294 @@
+// TrafficStore.cpp
+// Implementation of the native AI traffic table
+
+#include "pch.h"
+#include "TrafficStore.h"
+#include "Geometry.h"
+#include <algorithm>
+#include <math.h>
+
+namespace {
+    const double DegToRad = 3.14159265358979323846 / 180.0;
+    const double NmPerDegree = 60.0;
+}
+
+int32_t TrafficStore::LatIndex(double latitude) {
+    int32_t index = static_cast<int32_t>(floor((latitude + 90.0) * CellsPerDegree));
+    return (std::max)(0, (std::min)(LatCells - 1, index));
+}
+
+int32_t TrafficStore::LonIndex(double longitude) {
+    int32_t index = static_cast<int32_t>(floor((longitude + 180.0) * CellsPerDegree)) % LonCells;
+    return index < 0 ? index + LonCells : index;
+}
+
+int32_t TrafficStore::CellOf(double latitude, double longitude) {
+    return LatIndex(latitude) * LonCells + LonIndex(longitude);
+}
+
+void TrafficStore::AddToCell(int32_t cell, uint32_t slot) {
+    _grid[cell].push_back(slot);
+}
+
+void TrafficStore::RemoveFromCell(int32_t cell, uint32_t slot) {
+    auto it = _grid.find(cell);
+    if (it == _grid.end()) {
+        return;
+    }
+    std::vector<uint32_t>& slots = it->second;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i] == slot) {
+            slots[i] = slots.back();
+            slots.pop_back();
+            break;
+        }
+    }
+    // Empty cells are kept: busy areas keep reusing the same few cells
+}
+
+void TrafficStore::Upsert(const TrafficTarget& target) {
+    int32_t cell = CellOf(target.latitude, target.longitude);
+
+    ExclusiveLock guard(_lock);
+    uint32_t slot;
+    auto it = _slotById.find(target.object_id);
+    if (it != _slotById.end()) {
+        slot = it->second;
+        if (_cell[slot] != cell) {
+            RemoveFromCell(_cell[slot], slot);
+            AddToCell(cell, slot);
+            _cell[slot] = cell;
+        }
+    }
+    else {
+        slot = static_cast<uint32_t>(_id.size());
+        _id.push_back(target.object_id);
+        _latitude.push_back(0.0);
+        _longitude.push_back(0.0);
+        _altitude.push_back(0.0);
+        _altitudeIndicated.push_back(0.0);
+        _groundSpeed.push_back(0.0);
+        _headingTrue.push_back(0.0);
+        _verticalSpeed.push_back(0.0);
+        _velocityX.push_back(0.0);
+        _velocityY.push_back(0.0);
+        _velocityZ.push_back(0.0);
+        _onGround.push_back(0);
+        _cell.push_back(cell);
+        _slotById.emplace(target.object_id, slot);
+        AddToCell(cell, slot);
+    }
+
+    _latitude[slot] = target.latitude;
+    _longitude[slot] = target.longitude;
+    _altitude[slot] = target.altitude;
+    _altitudeIndicated[slot] = target.altitude_indicated;
+    _groundSpeed[slot] = target.ground_speed;
+    _headingTrue[slot] = target.heading_true;
+    _verticalSpeed[slot] = target.vertical_speed;
+    _velocityX[slot] = target.velocity_x;
+    _velocityY[slot] = target.velocity_y;
+    _velocityZ[slot] = target.velocity_z;
+    _onGround[slot] = target.on_ground ? 1 : 0;
+}
+
+void TrafficStore::Remove(uint32_t objectId) {
+    ExclusiveLock guard(_lock);
+    auto it = _slotById.find(objectId);
+    if (it == _slotById.end()) {
+        return;
+    }
+    uint32_t slot = it->second;
+    uint32_t last = static_cast<uint32_t>(_id.size() - 1);
+    _slotById.erase(it);
+    RemoveFromCell(_cell[slot], slot);
+
+    // Swap-remove: move the last row into the hole so the columns stay dense
+    if (slot != last) {
+        RemoveFromCell(_cell[last], last);
+        _id[slot] = _id[last];
+        _latitude[slot] = _latitude[last];
+        _longitude[slot] = _longitude[last];
+        _altitude[slot] = _altitude[last];
+        _altitudeIndicated[slot] = _altitudeIndicated[last];
+        _groundSpeed[slot] = _groundSpeed[last];
+        _headingTrue[slot] = _headingTrue[last];
+        _verticalSpeed[slot] = _verticalSpeed[last];
+        _velocityX[slot] = _velocityX[last];
+        _velocityY[slot] = _velocityY[last];
+        _velocityZ[slot] = _velocityZ[last];
+        _onGround[slot] = _onGround[last];
+        _cell[slot] = _cell[last];
+        _slotById[_id[slot]] = slot;
+        AddToCell(_cell[slot], slot);
+    }
+
+    _id.pop_back();
+    _latitude.pop_back();
+    _longitude.pop_back();
+    _altitude.pop_back();
+    _altitudeIndicated.pop_back();
+    _groundSpeed.pop_back();
+    _headingTrue.pop_back();
+    _verticalSpeed.pop_back();
+    _velocityX.pop_back();
+    _velocityY.pop_back();
+    _velocityZ.pop_back();
+    _onGround.pop_back();
+    _cell.pop_back();
+}
+
+void TrafficStore::Clear() {
+    ExclusiveLock guard(_lock);
+    _id.clear();
+    _latitude.clear();
+    _longitude.clear();
+    _altitude.clear();
+    _altitudeIndicated.clear();
+    _groundSpeed.clear();
+    _headingTrue.clear();
+    _verticalSpeed.clear();
+    _velocityX.clear();
+    _velocityY.clear();
+    _velocityZ.clear();
+    _onGround.clear();
+    _cell.clear();
+    _slotById.clear();
+    _grid.clear();
+}
+
+int32_t TrafficStore::Count() {
+    SharedLock guard(_lock);
+    return static_cast<int32_t>(_id.size());
+}
+
+size_t TrafficStore::MemoryBytes() {
+    const size_t nodeOverhead = 2 * sizeof(void*);
+    size_t bytes = 0;
+    {
+        SharedLock guard(_lock);
+        bytes += _id.capacity() * sizeof(uint32_t);
+        bytes += (_latitude.capacity() + _longitude.capacity() + _altitude.capacity() +
+                  _altitudeIndicated.capacity() + _groundSpeed.capacity() + _headingTrue.capacity() +
+                  _verticalSpeed.capacity() + _velocityX.capacity() + _velocityY.capacity() +
+                  _velocityZ.capacity()) * sizeof(double);
+        bytes += _onGround.capacity() * sizeof(uint8_t);
+        bytes += _cell.capacity() * sizeof(int32_t);
+        bytes += _slotById.size() * (sizeof(std::pair<uint32_t, uint32_t>) + nodeOverhead);
+        for (auto it = _grid.begin(); it != _grid.end(); ++it) {
+            bytes += sizeof(*it) + nodeOverhead + it->second.capacity() * sizeof(uint32_t);
+        }
+    }
+    {
+        SharedLock guard(_queryLock);
+        bytes += _matches.capacity() * sizeof(std::pair<double, uint32_t>);
+    }
+    return bytes;
+}
+
+void TrafficStore::CopyOut(uint32_t slot, double distanceNm, TrafficTarget* out) const {
+    out->object_id = _id[slot];
+    out->latitude = _latitude[slot];
+    out->longitude = _longitude[slot];
+    out->altitude = _altitude[slot];
+    out->altitude_indicated = _altitudeIndicated[slot];
+    out->ground_speed = _groundSpeed[slot];
+    out->heading_true = _headingTrue[slot];
+    out->vertical_speed = _verticalSpeed[slot];
+    out->velocity_x = _velocityX[slot];
+    out->velocity_y = _velocityY[slot];
+    out->velocity_z = _velocityZ[slot];
+    out->on_ground = _onGround[slot] != 0;
+    out->distance_nm = distanceNm;
+}
+
+void TrafficStore::Snapshot(TrafficTarget* buffer, int32_t capacity, int32_t* outTotal) {
+    SharedLock guard(_lock);
+    uint32_t count = static_cast<uint32_t>(_id.size());
+    uint32_t copied = (std::min)(count, static_cast<uint32_t>(capacity));
+    for (uint32_t slot = 0; slot < copied; ++slot) {
+        CopyOut(slot, 0.0, &buffer[slot]);
+    }
+    *outTotal = static_cast<int32_t>(count);
+}
+
+void TrafficStore::QueryNear(double latitude, double longitude, double altitudeFt,
+                             double radiusNm, double altitudeBandFt,
+                             TrafficTarget* buffer, int32_t capacity, int32_t* outTotal) {
+    ExclusiveLock queryGuard(_queryLock);
+    SharedLock guard(_lock);
+    _matches.clear();
+
+    // Bounding box in cells. Longitude degrees shrink with cos(latitude); near the poles
+    // (or for very large radii) the box covers every longitude.
+    double latSpan = radiusNm / NmPerDegree;
+    double cosLat = cos(latitude * DegToRad);
+    double lonSpan = (cosLat > 1e-6) ? latSpan / cosLat : 360.0;
+
+    int32_t latLo = LatIndex(latitude - latSpan);
+    int32_t latHi = LatIndex(latitude + latSpan);
+    int32_t lonLo = 0;
+    int32_t lonCount = LonCells;
+    if (lonSpan < 180.0) {
+        lonLo = LonIndex(longitude - lonSpan);
+        int32_t lonHi = LonIndex(longitude + lonSpan);
+        lonCount = ((lonHi - lonLo + LonCells) % LonCells) + 1;
+    }
+
+    // Equirectangular distance at the midpoint latitude: well under 0.5% error at
+    // TCAS/visual ranges, and cheap enough to run on every candidate
+    double radiusSq = radiusNm * radiusNm;
+    for (int32_t latIdx = latLo; latIdx <= latHi; ++latIdx) {
+        for (int32_t step = 0; step < lonCount; ++step) {
+            int32_t cell = latIdx * LonCells + (lonLo + step) % LonCells;
+            auto it = _grid.find(cell);
+            if (it == _grid.end()) {
+                continue;
+            }
+            const std::vector<uint32_t>& slots = it->second;
+            for (size_t i = 0; i < slots.size(); ++i) {
+                uint32_t slot = slots[i];
+                if (fabs(_altitude[slot] - altitudeFt) > altitudeBandFt) {
+                    continue;
+                }
+                double dLon = _longitude[slot] - longitude;
+                if (dLon > 180.0) dLon -= 360.0;
+                else if (dLon < -180.0) dLon += 360.0;
+                double midCos = cos((_latitude[slot] + latitude) * 0.5 * DegToRad);
+                double x = dLon * midCos * NmPerDegree;
+                double y = (_latitude[slot] - latitude) * NmPerDegree;
+                double distSq = x * x + y * y;
+                if (distSq <= radiusSq) {
+                    _matches.push_back(std::make_pair(distSq, slot));
+                }
+            }
+        }
+    }
+
+    // Nearest first, so a short buffer still receives the most relevant targets
+    size_t copied = (std::min)(_matches.size(), static_cast<size_t>(capacity));
+    if (copied < _matches.size()) {
+        std::partial_sort(_matches.begin(), _matches.begin() + copied, _matches.end());
+    }
+    else {
+        std::sort(_matches.begin(), _matches.end());
+    }
+    for (size_t i = 0; i < copied; ++i) {
+        CopyOut(_matches[i].second, sqrt(_matches[i].first), &buffer[i]);
+    }
+    *outTotal = static_cast<int32_t>(_matches.size());
+}
+
+void TrafficStore::ComputeGeometry(const GeoState& ownship, uint32_t* outIds, RelativeGeometry* outGeometry,
+                                   int32_t capacity, int32_t* outTotal) {
+    SharedLock guard(_lock);
+    size_t count = (std::min)(_id.size(), static_cast<size_t>(capacity));
+
+    // The columns are already the kernel's input layout; heading stands in for track
+    GeometryKernel::Compute(ownship, _latitude.data(), _longitude.data(), _altitude.data(),
+                            _groundSpeed.data(), _headingTrue.data(), count, outGeometry);
+    if (outIds && count > 0) {
+        memcpy(outIds, _id.data(), count * sizeof(uint32_t));
+    }
+    *outTotal = static_cast<int32_t>(_id.size());
+}
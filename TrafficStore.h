@@ -0,0 +1,83 @@
+// TrafficStore.h
+// Native mirror of the simulator's AI traffic
+// Targets are kept as a struct-of-arrays table (one column per field) so bulk copies
+// and range scans touch only the columns they need. A fixed lat/lon grid indexes the
+// table for "targets near ownship" queries.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "ProSimBridge.h"
+#include "NativeSupport.h"
+
+class TrafficStore {
+private:
+    // Grid cell edge in degrees; 0.25 deg is 15 nm of latitude, so a typical TCAS
+    // query touches a handful of cells
+    static const int CellsPerDegree = 4;
+    static const int LatCells = 180 * CellsPerDegree;
+    static const int LonCells = 360 * CellsPerDegree;
+
+    SrwLock _lock;                      // guards the table and the grid
+
+    // Table columns, all indexed by slot
+    std::vector<uint32_t> _id;
+    std::vector<double> _latitude;
+    std::vector<double> _longitude;
+    std::vector<double> _altitude;
+    std::vector<double> _altitudeIndicated;
+    std::vector<double> _groundSpeed;
+    std::vector<double> _headingTrue;
+    std::vector<double> _verticalSpeed;
+    std::vector<double> _velocityX;
+    std::vector<double> _velocityY;
+    std::vector<double> _velocityZ;
+    std::vector<uint8_t> _onGround;
+    std::vector<int32_t> _cell;
+
+    std::unordered_map<uint32_t, uint32_t> _slotById;
+    std::unordered_map<int32_t, std::vector<uint32_t>> _grid;  // cell -> slots
+
+    // Scratch space for near queries (distance, slot), reused under _queryLock
+    SrwLock _queryLock;
+    std::vector<std::pair<double, uint32_t>> _matches;
+
+    static int32_t LatIndex(double latitude);
+    static int32_t LonIndex(double longitude);
+    static int32_t CellOf(double latitude, double longitude);
+
+    void AddToCell(int32_t cell, uint32_t slot);
+    void RemoveFromCell(int32_t cell, uint32_t slot);
+    void CopyOut(uint32_t slot, double distanceNm, TrafficTarget* out) const;
+
+    TrafficStore(const TrafficStore&) = delete;
+    TrafficStore& operator=(const TrafficStore&) = delete;
+
+public:
+    TrafficStore() {}
+
+    // Inserts a target or updates it in place (the SDK re-raises "added" for updates)
+    void Upsert(const TrafficTarget& target);
+    void Remove(uint32_t objectId);
+    void Clear();
+
+    int32_t Count();
+
+    // Bytes held by the table, the grid and the query scratch space (hash nodes approximated)
+    size_t MemoryBytes();
+
+    // Copies up to capacity targets; outTotal receives the number of targets available
+    void Snapshot(TrafficTarget* buffer, int32_t capacity, int32_t* outTotal);
+
+    // Runs the geometry kernel from ownship over the table columns; outIds and outGeometry
+    // receive up to capacity entries, outTotal the number of targets available
+    void ComputeGeometry(const GeoState& ownship, uint32_t* outIds, RelativeGeometry* outGeometry,
+                         int32_t capacity, int32_t* outTotal);
+
+    // Copies targets within radiusNm and +/- altitudeBandFt of a position, nearest first
+    void QueryNear(double latitude, double longitude, double altitudeFt,
+                   double radiusNm, double altitudeBandFt,
+                   TrafficTarget* buffer, int32_t capacity, int32_t* outTotal);
+};
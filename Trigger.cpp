@@ -0,0 +1,39 @@
+// Trigger.cpp
+// Implementation of trigger edge detection
+
+#include "pch.h"
+#include "Trigger.h"
+
+#pragma managed(push, off)
+
+TriggerState::TriggerState(double onDelaySeconds, double offDelaySeconds)
+    : _onDelay(onDelaySeconds)
+    , _offDelay(offDelaySeconds)
+    , _active(false)
+    , _holding(false)
+    , _holdStart(0.0)
+{
+}
+
+bool TriggerState::Update(bool set, bool clear, double now) {
+    bool wanted = _active ? clear : set;
+    if (!wanted) {
+        // The input dropped before its delay ran out; the next one starts from zero
+        _holding = false;
+        return false;
+    }
+
+    if (!_holding) {
+        _holding = true;
+        _holdStart = now;
+    }
+    if (now - _holdStart < (_active ? _offDelay : _onDelay)) {
+        return false;
+    }
+
+    _active = !_active;
+    _holding = false;
+    return true;
+}
+
+#pragma managed(pop)
@@ -0,0 +1,30 @@
+// Trigger.h
+// Edge detection for condition triggers (Trigger_Create)
+// A trigger turns on once its condition has held for the on-delay and turns off once
+// its release has held for the off-delay. The release is either a separate expression,
+// which gives hysteresis (e.g. on below 50 ft, off above 60 ft), or the condition
+// becoming false. Only the transitions are reported.
+
+#pragma once
+
+class TriggerState {
+private:
+    double _onDelay;                    // seconds
+    double _offDelay;
+    bool _active;
+    bool _holding;                      // the awaited input is true, waiting out its delay
+    double _holdStart;
+
+public:
+    TriggerState(double onDelaySeconds, double offDelaySeconds);
+
+    // Feeds the inputs at time now (seconds); set turns the trigger on, clear turns it off
+    // Returns true if the trigger changed state
+    bool Update(bool set, bool clear, double now);
+
+    bool IsActive() const { return _active; }
+
+    // True while a transition waits on its delay, so Update must be called again later
+    // even if the inputs stay the same
+    bool IsHolding() const { return _holding; }
+};
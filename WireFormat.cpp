@@ -0,0 +1,447 @@
+// WireFormat.cpp
+// Implementation of the DataRef update wire format
+
+#include "pch.h"
+#include "WireFormat.h"
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Pure integer code; compile it native rather than to IL
+#pragma managed(push, off)
+
+namespace {
+
+const uint16_t WireMagic = 0x5750;      // "PW"
+
+// Record kinds, in the low two bits of each record head
+const uint32_t KindDouble = 0;
+const uint32_t KindInt = 1;
+const uint32_t KindBool = 2;
+const uint32_t KindString = 3;
+
+// String tags, in the low two bits of the string head
+const uint32_t StringInterned = 0;      // head >> 2 is an intern index
+const uint32_t StringNew = 1;           // head >> 2 is a length; added to the intern table
+const uint32_t StringLiteral = 2;       // head >> 2 is a length; not interned
+
+inline uint32_t ZigZag32(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t UnZigZag32(uint32_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+}
+
+inline uint8_t* PutVarint(uint8_t* p, uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = static_cast<uint8_t>(value);
+    return p;
+}
+
+inline const uint8_t* GetVarint(const uint8_t* p, const uint8_t* end, uint32_t* out) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) {
+            return nullptr;
+        }
+        uint8_t byte = *p++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            *out = value;
+            return p;
+        }
+    }
+    return nullptr; // more than five bytes
+}
+
+inline void PutU16(uint8_t* p, uint16_t value) { memcpy(p, &value, 2); }
+inline void PutU32(uint8_t* p, uint32_t value) { memcpy(p, &value, 4); }
+inline uint16_t GetU16(const uint8_t* p) { uint16_t v; memcpy(&v, p, 2); return v; }
+inline uint32_t GetU32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+inline int CountTrailingZeroBytes(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index) >> 3;
+#elif defined(__GNUC__)
+    return __builtin_ctzll(value) >> 3;
+#else
+    int bytes = 0;
+    while ((value & 0xFF) == 0) { value >>= 8; ++bytes; }
+    return bytes;
+#endif
+}
+
+inline int CountLeadingZeroBytes(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(63 - index) >> 3;
+#elif defined(__GNUC__)
+    return __builtin_clzll(value) >> 3;
+#else
+    int bytes = 0;
+    while ((value >> 56) == 0) { value <<= 8; ++bytes; }
+    return bytes;
+#endif
+}
+
+inline bool IsWireType(int32_t type) {
+    return type == DATAREF_TYPE_DOUBLE || type == DATAREF_TYPE_INT ||
+           type == DATAREF_TYPE_BOOL || type == DATAREF_TYPE_STRING;
+}
+
+} // namespace
+
+// ============================================================================
+// WireState Implementation
+// ============================================================================
+
+WireState::WireState(uint32_t maxSlots)
+    : _last(maxSlots, 0)
+    , _strings(MaxInternedStrings)
+    , _buckets(MaxInternedStrings * 2, 0)
+    , _arena(InternArenaSize)
+    , _stringCount(0)
+    , _arenaUsed(0)
+{
+}
+
+void WireState::Reset() {
+    memset(_last.data(), 0, _last.size() * sizeof(uint64_t));
+    memset(_buckets.data(), 0, _buckets.size() * sizeof(uint32_t));
+    _stringCount = 0;
+    _arenaUsed = 0;
+}
+
+uint32_t WireState::Hash(const char* data, uint32_t length) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+bool WireState::FindString(const char* data, uint32_t length, uint32_t hash, uint32_t* outIndex) const {
+    uint32_t mask = static_cast<uint32_t>(_buckets.size()) - 1;
+    for (uint32_t bucket = hash & mask;; bucket = (bucket + 1) & mask) {
+        uint32_t entry = _buckets[bucket];
+        if (entry == 0) {
+            return false;
+        }
+        const InternedString& s = _strings[entry - 1];
+        if (s.hash == hash && s.length == length && memcmp(&_arena[s.offset], data, length) == 0) {
+            *outIndex = entry - 1;
+            return true;
+        }
+    }
+}
+
+bool WireState::AddString(const char* data, uint32_t length, uint32_t hash) {
+    if (_stringCount >= MaxInternedStrings || length > MaxInternedLength ||
+        _arenaUsed + length > InternArenaSize) {
+        return false;
+    }
+
+    InternedString& s = _strings[_stringCount];
+    s.offset = _arenaUsed;
+    s.length = length;
+    s.hash = hash;
+    memcpy(&_arena[_arenaUsed], data, length);
+    _arenaUsed += length;
+
+    // The table is at most half full, so probing always ends
+    uint32_t mask = static_cast<uint32_t>(_buckets.size()) - 1;
+    uint32_t bucket = hash & mask;
+    while (_buckets[bucket] != 0) {
+        bucket = (bucket + 1) & mask;
+    }
+    _buckets[bucket] = ++_stringCount;
+    return true;
+}
+
+// ============================================================================
+// WireEncoder Implementation
+// ============================================================================
+
+size_t WireEncoder::MaxFrameSize(const WireRecord* records, size_t count) {
+    size_t size = HeaderSize + (count + 7) / 8;
+    for (size_t i = 0; i < count; ++i) {
+        size += 5; // record head
+        switch (records[i].type) {
+        case DATAREF_TYPE_DOUBLE: size += 9; break;
+        case DATAREF_TYPE_INT:    size += 5; break;
+        case DATAREF_TYPE_STRING: size += 5 + static_cast<size_t>(records[i].string_length); break;
+        default: break;
+        }
+    }
+    return size;
+}
+
+BridgeResult WireEncoder::Encode(const WireRecord* records, size_t count, bool keyframe,
+                                 uint8_t* buffer, size_t capacity, size_t* outSize) {
+    // Validate everything first so a rejected batch leaves the stream state untouched
+    size_t boolCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const WireRecord& r = records[i];
+        if (r.slot >= _state.MaxSlots() || !IsWireType(r.type) ||
+            (r.type == DATAREF_TYPE_STRING && (r.string_length < 0 || (!r.string_value && r.string_length > 0)))) {
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        if (r.type == DATAREF_TYPE_BOOL) {
+            ++boolCount;
+        }
+    }
+    size_t required = MaxFrameSize(records, count);
+    if (capacity < required) {
+        *outSize = required;
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    if (keyframe) {
+        _state.Reset();
+    }
+
+    uint8_t* bools = buffer + HeaderSize;
+    size_t boolBytes = (boolCount + 7) / 8;
+    memset(bools, 0, boolBytes);
+    uint8_t* p = bools + boolBytes;
+
+    size_t boolIndex = 0;
+    uint32_t previousSlot = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const WireRecord& r = records[i];
+        uint32_t slotDelta = ZigZag32(static_cast<int32_t>(r.slot - previousSlot));
+        previousSlot = r.slot;
+        uint64_t& last = _state.Last(r.slot);
+
+        switch (r.type) {
+        case DATAREF_TYPE_DOUBLE: {
+            p = PutVarint(p, (slotDelta << 2) | KindDouble);
+            uint64_t bits;
+            memcpy(&bits, &r.double_value, sizeof(bits));
+            uint64_t x = bits ^ last;
+            last = bits;
+            if (x == 0) {
+                *p++ = 0;
+                break;
+            }
+            // Control byte: significant byte count (high nibble), trailing zero bytes (low)
+            int trailing = CountTrailingZeroBytes(x);
+            int significant = 8 - trailing - CountLeadingZeroBytes(x);
+            *p++ = static_cast<uint8_t>((significant << 4) | trailing);
+            x >>= trailing * 8;
+            for (int b = 0; b < significant; ++b) {
+                *p++ = static_cast<uint8_t>(x);
+                x >>= 8;
+            }
+            break;
+        }
+        case DATAREF_TYPE_INT: {
+            p = PutVarint(p, (slotDelta << 2) | KindInt);
+            int32_t previous = static_cast<int32_t>(static_cast<uint32_t>(last));
+            p = PutVarint(p, ZigZag32(static_cast<int32_t>(static_cast<uint32_t>(r.int_value) -
+                                                           static_cast<uint32_t>(previous))));
+            last = static_cast<uint32_t>(r.int_value);
+            break;
+        }
+        case DATAREF_TYPE_BOOL:
+            p = PutVarint(p, (slotDelta << 2) | KindBool);
+            if (r.bool_value) {
+                bools[boolIndex >> 3] |= static_cast<uint8_t>(1u << (boolIndex & 7));
+            }
+            ++boolIndex;
+            break;
+        case DATAREF_TYPE_STRING: {
+            p = PutVarint(p, (slotDelta << 2) | KindString);
+            uint32_t length = static_cast<uint32_t>(r.string_length);
+            uint32_t hash = WireState::Hash(r.string_value, length);
+            uint32_t index;
+            if (_state.FindString(r.string_value, length, hash, &index)) {
+                p = PutVarint(p, (index << 2) | StringInterned);
+                break;
+            }
+            bool interned = _state.AddString(r.string_value, length, hash);
+            p = PutVarint(p, (length << 2) | (interned ? StringNew : StringLiteral));
+            memcpy(p, r.string_value, length);
+            p += length;
+            break;
+        }
+        }
+    }
+
+    size_t payloadLength = static_cast<size_t>(p - bools);
+    PutU16(buffer, WireMagic);
+    buffer[2] = WIRE_FORMAT_VERSION;
+    buffer[3] = keyframe ? WIRE_FLAG_KEYFRAME : 0;
+    PutU32(buffer + 4, _sequence++);
+    PutU32(buffer + 8, static_cast<uint32_t>(count));
+    PutU32(buffer + 12, static_cast<uint32_t>(boolCount));
+    PutU32(buffer + 16, static_cast<uint32_t>(payloadLength));
+    *outSize = HeaderSize + payloadLength;
+    return BRIDGE_OK;
+}
+
+// ============================================================================
+// WireDecoder Implementation
+// ============================================================================
+
+BridgeResult WireDecoder::Decode(const uint8_t* frame, size_t size, WireRecord* records, size_t capacity,
+                                 size_t* outCount, uint32_t* outSequence) {
+    if (size < WireEncoder::HeaderSize || GetU16(frame) != WireMagic || frame[2] != WIRE_FORMAT_VERSION) {
+        return BRIDGE_ERR_INVALID_DATA;
+    }
+    uint8_t flags = frame[3];
+    uint32_t sequence = GetU32(frame + 4);
+    uint32_t count = GetU32(frame + 8);
+    uint32_t boolCount = GetU32(frame + 12);
+    uint32_t payloadLength = GetU32(frame + 16);
+    // Every record takes at least its head byte
+    if (payloadLength != size - WireEncoder::HeaderSize || count > payloadLength || boolCount > count) {
+        return BRIDGE_ERR_INVALID_DATA;
+    }
+
+    *outCount = count;
+    if (outSequence) {
+        *outSequence = sequence;
+    }
+    if (count > capacity) {
+        return BRIDGE_ERR_INVALID_ARGUMENT; // nothing consumed; retry with a larger array
+    }
+
+    bool keyframe = (flags & WIRE_FLAG_KEYFRAME) != 0;
+    if (keyframe) {
+        _state.Reset();
+    }
+    else if (!_synchronized || sequence != _sequence + 1) {
+        _synchronized = false;
+        return BRIDGE_ERR_INVALID_DATA; // missed a frame; wait for a keyframe
+    }
+
+    // Any failure below leaves the state half-updated, so it also desynchronises
+    _synchronized = false;
+
+    const uint8_t* bools = frame + WireEncoder::HeaderSize;
+    const uint8_t* end = frame + size;
+    size_t boolBytes = (static_cast<size_t>(boolCount) + 7) / 8;
+    if (boolBytes > payloadLength) {
+        return BRIDGE_ERR_INVALID_DATA;
+    }
+    const uint8_t* p = bools + boolBytes;
+
+    uint32_t boolIndex = 0;
+    uint32_t slot = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t head;
+        if (!(p = GetVarint(p, end, &head))) {
+            return BRIDGE_ERR_INVALID_DATA;
+        }
+        slot += static_cast<uint32_t>(UnZigZag32(head >> 2));
+        if (slot >= _state.MaxSlots()) {
+            return BRIDGE_ERR_INVALID_DATA;
+        }
+        uint64_t& last = _state.Last(slot);
+
+        WireRecord& r = records[i];
+        r.slot = slot;
+        r.double_value = 0.0;
+        r.int_value = 0;
+        r.bool_value = 0;
+        r.string_value = nullptr;
+        r.string_length = 0;
+
+        switch (head & 3) {
+        case KindDouble: {
+            if (p == end) {
+                return BRIDGE_ERR_INVALID_DATA;
+            }
+            uint8_t control = *p++;
+            int significant = control >> 4;
+            int trailing = control & 0x0F;
+            if (significant + trailing > 8 || (significant == 0 && trailing != 0) ||
+                end - p < significant) {
+                return BRIDGE_ERR_INVALID_DATA;
+            }
+            uint64_t x = 0;
+            for (int b = significant - 1; b >= 0; --b) {
+                x = (x << 8) | p[b];
+            }
+            p += significant;
+            last ^= (significant > 0) ? (x << (trailing * 8)) : 0;
+            r.type = DATAREF_TYPE_DOUBLE;
+            memcpy(&r.double_value, &last, sizeof(double));
+            break;
+        }
+        case KindInt: {
+            uint32_t delta;
+            if (!(p = GetVarint(p, end, &delta))) {
+                return BRIDGE_ERR_INVALID_DATA;
+            }
+            uint32_t value = static_cast<uint32_t>(last) + static_cast<uint32_t>(UnZigZag32(delta));
+            last = value;
+            r.type = DATAREF_TYPE_INT;
+            r.int_value = static_cast<int32_t>(value);
+            break;
+        }
+        case KindBool:
+            if (boolIndex >= boolCount) {
+                return BRIDGE_ERR_INVALID_DATA;
+            }
+            r.type = DATAREF_TYPE_BOOL;
+            r.bool_value = (bools[boolIndex >> 3] >> (boolIndex & 7)) & 1;
+            ++boolIndex;
+            break;
+        case KindString: {
+            uint32_t stringHead;
+            if (!(p = GetVarint(p, end, &stringHead))) {
+                return BRIDGE_ERR_INVALID_DATA;
+            }
+            uint32_t tag = stringHead & 3;
+            uint32_t value = stringHead >> 2;
+            r.type = DATAREF_TYPE_STRING;
+            if (tag == StringInterned) {
+                if (value >= _state.StringCount()) {
+                    return BRIDGE_ERR_INVALID_DATA;
+                }
+                r.string_value = _state.StringData(value);
+                r.string_length = static_cast<int32_t>(_state.StringLength(value));
+            }
+            else if (tag == StringNew || tag == StringLiteral) {
+                if (static_cast<size_t>(end - p) < value) {
+                    return BRIDGE_ERR_INVALID_DATA;
+                }
+                const char* data = reinterpret_cast<const char*>(p);
+                if (tag == StringNew &&
+                    !_state.AddString(data, value, WireState::Hash(data, value))) {
+                    return BRIDGE_ERR_INVALID_DATA; // encoder and decoder tables disagree
+                }
+                r.string_value = data;
+                r.string_length = static_cast<int32_t>(value);
+                p += value;
+            }
+            else {
+                return BRIDGE_ERR_INVALID_DATA;
+            }
+            break;
+        }
+        }
+    }
+
+    if (p != end || boolIndex != boolCount) {
+        return BRIDGE_ERR_INVALID_DATA;
+    }
+
+    _sequence = sequence;
+    _synchronized = true;
+    return BRIDGE_OK;
+}
+
+#pragma managed(pop)
@@ -0,0 +1,108 @@
+// WireFormat.h
+// Compact binary encoding for batches of DataRef updates
+// Records carry a slot id (a small integer the application assigns to each DataRef)
+// and a value. Encoders and decoders keep per-stream state (the last value of every
+// slot and a string intern table), so a frame only carries what changed in bits:
+//   - slot ids are varint deltas from the previous record
+//   - doubles are XORed with the slot's previous value and sent without the zero bytes
+//   - ints are zigzag varint deltas from the slot's previous value
+//   - bools are bit-packed at the start of the payload
+//   - a string seen before on the stream is sent as its intern index
+// All buffers are preallocated when the codec is created; Encode and Decode do not
+// allocate.
+//
+// Frame layout (little-endian):
+//   u16 magic 'PW', u8 version, u8 flags (WIRE_FLAG_*), u32 sequence,
+//   u32 record_count, u32 bool_count, u32 payload_length, payload
+//   payload: ceil(bool_count / 8) bytes of bool bits, then the records
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "ProSimBridge.h"
+
+// ============================================================================
+// WireState
+// Per-stream state shared by the encoder and decoder logic
+// ============================================================================
+
+class WireState {
+public:
+    static const uint32_t MaxInternedStrings = 4096;
+    static const uint32_t InternArenaSize = 256 * 1024;
+    static const uint32_t MaxInternedLength = 255;
+
+    explicit WireState(uint32_t maxSlots);
+
+    void Reset();
+    uint32_t MaxSlots() const { return static_cast<uint32_t>(_last.size()); }
+
+    // Previous value of each slot: double bits, or an int in the low 32 bits
+    uint64_t& Last(uint32_t slot) { return _last[slot]; }
+
+    // Interned strings, indexed in the order they were added
+    bool FindString(const char* data, uint32_t length, uint32_t hash, uint32_t* outIndex) const;
+    bool AddString(const char* data, uint32_t length, uint32_t hash);
+    const char* StringData(uint32_t index) const { return &_arena[_strings[index].offset]; }
+    uint32_t StringLength(uint32_t index) const { return _strings[index].length; }
+    uint32_t StringCount() const { return _stringCount; }
+
+    static uint32_t Hash(const char* data, uint32_t length);
+
+private:
+    struct InternedString {
+        uint32_t offset;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    std::vector<uint64_t> _last;
+    std::vector<InternedString> _strings;
+    std::vector<uint32_t> _buckets;     // open addressing, index + 1 (0 = empty)
+    std::vector<char> _arena;
+    uint32_t _stringCount;
+    uint32_t _arenaUsed;
+};
+
+// ============================================================================
+// WireEncoder / WireDecoder
+// ============================================================================
+
+class WireEncoder {
+public:
+    static const size_t HeaderSize = 20;
+
+    explicit WireEncoder(uint32_t maxSlots) : _state(maxSlots), _sequence(0) {}
+
+    // Largest frame Encode can produce for these records
+    static size_t MaxFrameSize(const WireRecord* records, size_t count);
+
+    // Encodes records into buffer. A keyframe resets the stream state on both sides so a
+    // decoder can start (or resynchronise) there. If capacity is below MaxFrameSize
+    // nothing is encoded, BRIDGE_ERR_INVALID_ARGUMENT is returned and *outSize is the
+    // required capacity.
+    BridgeResult Encode(const WireRecord* records, size_t count, bool keyframe,
+                        uint8_t* buffer, size_t capacity, size_t* outSize);
+
+private:
+    WireState _state;
+    uint32_t _sequence;
+};
+
+class WireDecoder {
+public:
+    explicit WireDecoder(uint32_t maxSlots) : _state(maxSlots), _sequence(0), _synchronized(false) {}
+
+    // Decodes one frame. String values point into the frame or into the decoder's intern
+    // table and stay valid until the next Decode. A malformed frame or a sequence gap
+    // returns BRIDGE_ERR_INVALID_DATA, and frames are then rejected until a keyframe.
+    BridgeResult Decode(const uint8_t* frame, size_t size, WireRecord* records, size_t capacity,
+                        size_t* outCount, uint32_t* outSequence);
+
+private:
+    WireState _state;
+    uint32_t _sequence;
+    bool _synchronized;
+};
@@ -0,0 +1,492 @@
+// WritePipeline.cpp
+// Implementation of the deferred DataRef write paths
+
+#include "pch.h"
+#include "WritePipeline.h"
+#include "ManagedWrapper.h"
+
+// ============================================================================
+// WriteCoalescer Implementation
+// ============================================================================
+
+WriteCoalescer::WriteCoalescer()
+    : _flushThreadId(0)
+    , _flushAgain(0)
+    , _intervalMs(0)
+    , _enabled(0)
+{
+}
+
+WriteCoalescer::~WriteCoalescer() {
+    Shutdown();
+}
+
+void WriteCoalescer::TickerMain(NativeThread* thread, void* context) {
+    WriteCoalescer* self = static_cast<WriteCoalescer*>(context);
+    while (!thread->WaitForStop(self->_intervalMs)) {
+        self->Flush();
+    }
+}
+
+BridgeResult WriteCoalescer::Configure(bool enabled, int32_t intervalMs) {
+    if (intervalMs < 0) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    // Restart the ticker with the new period (or stop it)
+    _ticker.Stop();
+    _intervalMs = static_cast<DWORD>(intervalMs);
+    InterlockedExchange(&_enabled, enabled ? 1 : 0);
+
+    if (!enabled) {
+        return Flush();
+    }
+    if (intervalMs > 0 && !_ticker.Start(&WriteCoalescer::TickerMain, this)) {
+        InterlockedExchange(&_enabled, 0);
+        ProSim_SetLastError("Failed to start write flush thread");
+        return BRIDGE_ERR_EXCEPTION;
+    }
+    return BRIDGE_OK;
+}
+
+void WriteCoalescer::Stage(DataRefWrapper* target, const BridgeValue& value) {
+    ExclusiveLock guard(_lock);
+    auto it = _index.find(target);
+    if (it != _index.end()) {
+        _pending[it->second].value = value;
+        return;
+    }
+    _index.emplace(target, _pending.size());
+    _pending.push_back(PendingWrite{ target, value });
+}
+
+BridgeResult WriteCoalescer::Flush() {
+    if (_flushThreadId == GetCurrentThreadId()) {
+        // Re-entered from a change callback raised by our own flush. _flushLock is not
+        // recursive, so the outer flush picks up the new writes once its batch is sent.
+        InterlockedExchange(&_flushAgain, 1);
+        return BRIDGE_OK;
+    }
+
+    ExclusiveLock flushGuard(_flushLock);
+    BridgeResult first = BRIDGE_OK;
+    do {
+        InterlockedExchange(&_flushAgain, 0);
+        {
+            ExclusiveLock guard(_lock);
+            if (_pending.empty()) {
+                break;
+            }
+            _flushing.swap(_pending);
+            _index.clear();
+        }
+
+        // The SDK has no multi-value write, so the batch is one setter per DataRef with
+        // a pending value; intermediate values written since the last flush are never sent
+        _flushThreadId = GetCurrentThreadId();
+        for (size_t i = 0; i < _flushing.size(); ++i) {
+            DataRefWrapper* target = _flushing[i].target;
+            if (!target) {
+                continue; // destroyed from a callback during this flush
+            }
+            BridgeResult result = target->WriteValue(_flushing[i].value);
+            if (result != BRIDGE_OK && first == BRIDGE_OK) {
+                first = result;
+            }
+        }
+        _flushThreadId = 0;
+
+        _flushing.clear();
+    } while (_flushAgain);
+    return first;
+}
+
+void WriteCoalescer::Discard(DataRefWrapper* target) {
+    if (_flushThreadId == GetCurrentThreadId()) {
+        // Re-entered from a change callback raised by our own flush
+        for (size_t i = 0; i < _flushing.size(); ++i) {
+            if (_flushing[i].target == target) {
+                _flushing[i].target = nullptr;
+            }
+        }
+    }
+    else {
+        // Wait for an in-progress flush that may still reference the DataRef
+        ExclusiveLock flushGuard(_flushLock);
+    }
+
+    ExclusiveLock guard(_lock);
+    auto it = _index.find(target);
+    if (it == _index.end()) {
+        return;
+    }
+    size_t slot = it->second;
+    _index.erase(it);
+    if (slot != _pending.size() - 1) {
+        _pending[slot] = std::move(_pending.back());
+        _index[_pending[slot].target] = slot;
+    }
+    _pending.pop_back();
+}
+
+size_t WriteCoalescer::PendingCount() {
+    SharedLock guard(_lock);
+    return _pending.size();
+}
+
+size_t WriteCoalescer::MemoryBytes() {
+    // _flushing is not counted: its lock is held for a whole flush, and the two
+    // buffers swap every flush so _pending's capacity is representative
+    SharedLock guard(_lock);
+    size_t bytes = _pending.capacity() * sizeof(PendingWrite);
+    for (size_t i = 0; i < _pending.size(); ++i) {
+        bytes += _pending[i].value.stringValue.capacity();
+    }
+    bytes += _index.size() * (sizeof(std::pair<DataRefWrapper* const, size_t>) + 2 * sizeof(void*));
+    return bytes;
+}
+
+void WriteCoalescer::Shutdown() {
+    _ticker.Stop();
+    InterlockedExchange(&_enabled, 0);
+}
+
+// ============================================================================
+// AsyncWriter Implementation
+// ============================================================================
+
+AsyncWriter::AsyncWriter(ProSimConnectWrapper* owner)
+    : _owner(owner)
+    , _maxInFlight(0)
+    , _queued(0)
+    , _nextToken(1)
+    , _executing(nullptr)
+    , _priorityActive(false)
+    , _stopping(false)
+{
+    SetMaxInFlight(DefaultMaxInFlight);
+}
+
+AsyncWriter::~AsyncWriter() {
+    Shutdown();
+}
+
+BridgeResult AsyncWriter::SetMaxInFlight(int32_t maxInFlight) {
+    if (maxInFlight <= 0) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    ExclusiveLock guard(_lock);
+    if (_queued > 0 || _executing) {
+        ProSim_SetLastError("Cannot resize the async write queue while writes are in flight");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    // Completion slots are reused every tableSize tokens; keeping the table several times
+    // larger than the queue leaves results readable well after the write completed
+    size_t tableSize = 1;
+    while (tableSize < static_cast<size_t>(maxInFlight) * 4) {
+        tableSize <<= 1;
+    }
+
+    // Either lane may use the whole budget, so each ring is sized to the full limit
+    _maxInFlight = static_cast<size_t>(maxInFlight);
+    for (int i = 0; i < 2; ++i) {
+        _lanes[i].queue.clear();
+        _lanes[i].queue.resize(_maxInFlight);
+        _lanes[i].head = 0;
+        _lanes[i].count = 0;
+    }
+    _completions.assign(tableSize, Completion());
+    for (size_t i = 0; i < _completions.size(); ++i) {
+        _completions[i].token = WRITE_TOKEN_INVALID;
+    }
+    return BRIDGE_OK;
+}
+
+BridgeResult AsyncWriter::EnsureStarted() {
+    // Caller holds _lock
+    if (_thread.IsRunning()) {
+        return BRIDGE_OK;
+    }
+    _stopping = false;
+    if (!_thread.Start(&AsyncWriter::WriterMain, this)) {
+        ProSim_SetLastError("Failed to start async writer thread");
+        return BRIDGE_ERR_EXCEPTION;
+    }
+    return BRIDGE_OK;
+}
+
+AsyncWriter::Completion* AsyncWriter::FindCompletion(WriteToken token) {
+    // Caller holds _lock
+    if (token == WRITE_TOKEN_INVALID || token >= _nextToken) {
+        return nullptr;
+    }
+    Completion& slot = _completions[static_cast<size_t>(token) & (_completions.size() - 1)];
+    return (slot.token == token) ? &slot : nullptr;
+}
+
+void AsyncWriter::Supersede(DataRefWrapper* target) {
+    // Caller holds _lock. Queued normal writes to the DataRef would run after the high write
+    // and overwrite it with an older value, so they are completed without being sent.
+    Lane& lane = _lanes[WRITE_PRIORITY_NORMAL];
+    size_t kept = 0;
+    for (size_t i = 0; i < lane.count; ++i) {
+        QueuedWrite& queued = lane.queue[(lane.head + i) % lane.queue.size()];
+        if (queued.target == target) {
+            Completion* completion = FindCompletion(queued.token);
+            if (completion) {
+                completion->completed = true;
+                completion->result = BRIDGE_ERR_SUPERSEDED;
+                strncpy_s(completion->error, sizeof(completion->error),
+                          "Superseded by a high-priority write to the same DataRef", _TRUNCATE);
+            }
+            continue;
+        }
+        if (kept != i) {
+            std::swap(lane.queue[(lane.head + kept) % lane.queue.size()], queued);
+        }
+        ++kept;
+    }
+    if (kept != lane.count) {
+        _queued -= lane.count - kept;
+        lane.count = kept;
+        _writeCompleted.NotifyAll();
+    }
+}
+
+BridgeResult AsyncWriter::Submit(DataRefWrapper* target, const BridgeValue& value, int32_t priority, WriteToken* outToken) {
+    if (priority != WRITE_PRIORITY_NORMAL && priority != WRITE_PRIORITY_HIGH) {
+        ProSim_SetLastError("Invalid write priority");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    ExclusiveLock guard(_lock);
+
+    // Superseding first frees the slots of the writes it replaces
+    if (priority == WRITE_PRIORITY_HIGH) {
+        Supersede(target);
+    }
+
+    size_t inFlight = _queued + (_executing ? 1 : 0);
+    if (inFlight >= _maxInFlight) {
+        ProSim_SetLastError("Async write queue is full");
+        return BRIDGE_ERR_QUEUE_FULL;
+    }
+
+    BridgeResult started = EnsureStarted();
+    if (started != BRIDGE_OK) {
+        return started;
+    }
+
+    WriteToken token = _nextToken++;
+    Completion& completion = _completions[static_cast<size_t>(token) & (_completions.size() - 1)];
+    completion.token = token;
+    completion.completed = false;
+    completion.result = BRIDGE_OK;
+    completion.error[0] = '\0';
+
+    // Assigning into the preallocated slot reuses its string capacity
+    Lane& lane = _lanes[priority];
+    QueuedWrite& slot = lane.queue[(lane.head + lane.count) % lane.queue.size()];
+    slot.token = token;
+    slot.target = target;
+    slot.value = value;
+    ++lane.count;
+    ++_queued;
+
+    _workAvailable.NotifyOne();
+    if (outToken) {
+        *outToken = token;
+    }
+    return BRIDGE_OK;
+}
+
+void AsyncWriter::WriterMain(NativeThread* thread, void* context) {
+    static_cast<AsyncWriter*>(context)->Run();
+}
+
+void AsyncWriter::Run() {
+    QueuedWrite item;
+
+    for (;;) {
+        bool stopping;
+        bool wantPriority;
+        {
+            ExclusiveLock guard(_lock);
+            // With nothing queued the high lane is empty, so priority mode is dropped before
+            // sleeping rather than left on until the next write arrives
+            while (_queued == 0 && !_stopping && !_priorityActive) {
+                _workAvailable.Wait(_lock, INFINITE);
+            }
+            wantPriority = _lanes[WRITE_PRIORITY_HIGH].count > 0;
+        }
+
+        // Priority mode is raised when a high-priority batch starts and dropped once the
+        // lane is empty, rather than toggled per write
+        if (wantPriority != _priorityActive) {
+            _priorityActive = wantPriority;
+            _owner->SetWriterPriority(wantPriority);
+        }
+
+        {
+            ExclusiveLock guard(_lock);
+            if (_queued == 0 && _stopping) {
+                return; // stopping and drained
+            }
+            if (_queued == 0 || (_lanes[WRITE_PRIORITY_HIGH].count > 0) != _priorityActive) {
+                continue; // a high-priority write arrived meanwhile; raise priority mode first
+            }
+
+            Lane& lane = _priorityActive ? _lanes[WRITE_PRIORITY_HIGH] : _lanes[WRITE_PRIORITY_NORMAL];
+            QueuedWrite& front = lane.queue[lane.head];
+            item.token = front.token;
+            item.target = front.target;
+            item.value.type = front.value.type;
+            item.value.intValue = front.value.intValue;
+            item.value.doubleValue = front.value.doubleValue;
+            item.value.boolValue = front.value.boolValue;
+            item.value.stringValue.swap(front.value.stringValue);
+            lane.head = (lane.head + 1) % lane.queue.size();
+            --lane.count;
+            --_queued;
+            _executing = item.target;
+            stopping = _stopping;
+        }
+
+        // WriteValue hands back its failure message directly, so the completion never depends
+        // on what the last-error slot holds
+        BridgeResult result;
+        char error[sizeof(Completion::error)] = "";
+        if (stopping) {
+            result = BRIDGE_ERR_NOT_CONNECTED;
+            strncpy_s(error, sizeof(error), "Connection destroyed before the write was sent", _TRUNCATE);
+        }
+        else if (!item.target) {
+            result = BRIDGE_ERR_NULL_HANDLE;
+            strncpy_s(error, sizeof(error), "DataRef destroyed before the write was sent", _TRUNCATE);
+        }
+        else {
+            result = item.target->WriteValue(item.value, true, error, sizeof(error));
+        }
+
+        {
+            ExclusiveLock guard(_lock);
+            Completion* completion = FindCompletion(item.token);
+            if (completion) {
+                completion->completed = true;
+                completion->result = result;
+                strncpy_s(completion->error, sizeof(completion->error), error, _TRUNCATE);
+            }
+            _executing = nullptr;
+            _writeCompleted.NotifyAll();
+        }
+    }
+}
+
+BridgeResult AsyncWriter::Poll(WriteToken token, bool* outCompleted, BridgeResult* outResult) {
+    if (!outCompleted) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    SharedLock guard(_lock);
+    Completion* completion = FindCompletion(token);
+    if (!completion) {
+        ProSim_SetLastError("Unknown or expired write token");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    *outCompleted = completion->completed;
+    if (outResult) {
+        *outResult = completion->completed ? completion->result : BRIDGE_OK;
+    }
+    return BRIDGE_OK;
+}
+
+BridgeResult AsyncWriter::Wait(WriteToken token, int32_t timeoutMs, BridgeResult* outResult) {
+    DWORD deadline = GetTickCount() + static_cast<DWORD>(timeoutMs);
+
+    ExclusiveLock guard(_lock);
+    for (;;) {
+        Completion* completion = FindCompletion(token);
+        if (!completion) {
+            ProSim_SetLastError("Unknown or expired write token");
+            return BRIDGE_ERR_INVALID_ARGUMENT;
+        }
+        if (completion->completed) {
+            if (outResult) {
+                *outResult = completion->result;
+            }
+            return BRIDGE_OK;
+        }
+
+        DWORD waitMs = INFINITE;
+        if (timeoutMs >= 0) {
+            DWORD now = GetTickCount();
+            if (static_cast<LONG>(deadline - now) <= 0) {
+                ProSim_SetLastError("Timed out waiting for write");
+                return BRIDGE_ERR_TIMEOUT;
+            }
+            waitMs = deadline - now;
+        }
+        _writeCompleted.Wait(_lock, waitMs);
+    }
+}
+
+BridgeResult AsyncWriter::GetError(WriteToken token, char* buffer, int32_t bufferSize) {
+    if (!buffer || bufferSize <= 0) {
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+
+    SharedLock guard(_lock);
+    Completion* completion = FindCompletion(token);
+    if (!completion) {
+        ProSim_SetLastError("Unknown or expired write token");
+        return BRIDGE_ERR_INVALID_ARGUMENT;
+    }
+    strncpy_s(buffer, bufferSize, completion->error, _TRUNCATE);
+    return BRIDGE_OK;
+}
+
+void AsyncWriter::Discard(DataRefWrapper* target) {
+    ExclusiveLock guard(_lock);
+    for (int l = 0; l < 2; ++l) {
+        Lane& lane = _lanes[l];
+        for (size_t i = 0; i < lane.count; ++i) {
+            QueuedWrite& queued = lane.queue[(lane.head + i) % lane.queue.size()];
+            if (queued.target == target) {
+                queued.target = nullptr;
+            }
+        }
+    }
+
+    // A change callback raised by the running write may destroy its own DataRef
+    if (_thread.IsRunning() && GetCurrentThreadId() == GetThreadId(_thread.Handle())) {
+        return;
+    }
+    while (_executing == target) {
+        _writeCompleted.Wait(_lock, INFINITE);
+    }
+}
+
+size_t AsyncWriter::PendingCount() {
+    SharedLock guard(_lock);
+    return _queued;
+}
+
+size_t AsyncWriter::MemoryBytes() {
+    SharedLock guard(_lock);
+    size_t bytes = _completions.capacity() * sizeof(Completion);
+    for (int lane = 0; lane < 2; ++lane) {
+        bytes += _lanes[lane].queue.capacity() * sizeof(QueuedWrite);
+    }
+    return bytes;
+}
+
+void AsyncWriter::Shutdown() {
+    {
+        ExclusiveLock guard(_lock);
+        _stopping = true;
+        _workAvailable.NotifyAll();
+    }
+    _thread.Stop();
+}
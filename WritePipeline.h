@@ -0,0 +1,189 @@
+// WritePipeline.h
+// Deferred write paths for DataRefs
+// WriteCoalescer keeps the last value written to each DataRef and sends the table
+// once per tick (or on demand) instead of once per DataRef_Set* call
+// AsyncWriter runs writes on a dedicated thread and reports completion through tokens
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "ProSimBridge.h"
+#include "NativeSupport.h"
+
+class DataRefWrapper;
+class ProSimConnectWrapper;
+
+// ============================================================================
+// BridgeValue
+// Native copy of a value to be written to a DataRef
+// ============================================================================
+
+struct BridgeValue {
+    int32_t type;               // DATAREF_TYPE_INT, _DOUBLE, _BOOL or _STRING
+    int32_t intValue;
+    double doubleValue;
+    bool boolValue;
+    std::string stringValue;    // UTF-8
+
+    BridgeValue() : type(DATAREF_TYPE_UNKNOWN), intValue(0), doubleValue(0.0), boolValue(false) {}
+
+    static BridgeValue FromInt(int32_t value) {
+        BridgeValue v; v.type = DATAREF_TYPE_INT; v.intValue = value; return v;
+    }
+    static BridgeValue FromDouble(double value) {
+        BridgeValue v; v.type = DATAREF_TYPE_DOUBLE; v.doubleValue = value; return v;
+    }
+    static BridgeValue FromBool(bool value) {
+        BridgeValue v; v.type = DATAREF_TYPE_BOOL; v.boolValue = value; return v;
+    }
+    static BridgeValue FromString(const char* value) {
+        BridgeValue v; v.type = DATAREF_TYPE_STRING; v.stringValue = value; return v;
+    }
+};
+
+// ============================================================================
+// WriteCoalescer
+// Last-writer-wins table of pending DataRef writes
+// ============================================================================
+
+class WriteCoalescer {
+private:
+    struct PendingWrite {
+        DataRefWrapper* target;
+        BridgeValue value;
+    };
+
+    SrwLock _lock;                      // guards _pending and _index
+    SrwLock _flushLock;                 // held while a flush applies writes
+    std::vector<PendingWrite> _pending;
+    std::vector<PendingWrite> _flushing;
+    std::unordered_map<DataRefWrapper*, size_t> _index;
+    volatile DWORD _flushThreadId;
+    volatile LONG _flushAgain;          // a flush was requested from inside a flush
+
+    NativeThread _ticker;
+    DWORD _intervalMs;
+    volatile LONG _enabled;
+
+    static void TickerMain(NativeThread* thread, void* context);
+
+    WriteCoalescer(const WriteCoalescer&) = delete;
+    WriteCoalescer& operator=(const WriteCoalescer&) = delete;
+
+public:
+    WriteCoalescer();
+    ~WriteCoalescer();
+
+    // Enables or disables buffering. intervalMs > 0 starts a flush thread with that
+    // period; 0 means writes are only sent by Flush(). Disabling flushes pending writes.
+    BridgeResult Configure(bool enabled, int32_t intervalMs);
+    bool IsEnabled() const { return _enabled != 0; }
+
+    // Records a write, replacing any pending value for the same DataRef
+    void Stage(DataRefWrapper* target, const BridgeValue& value);
+
+    // Sends all pending writes; returns the first error encountered. A call made on the
+    // flushing thread (from a change callback) is deferred to the end of the running flush.
+    BridgeResult Flush();
+
+    // Drops any pending write for a DataRef that is being destroyed
+    void Discard(DataRefWrapper* target);
+
+    // Pending writes and the bytes holding them (hash nodes approximated)
+    size_t PendingCount();
+    size_t MemoryBytes();
+
+    // Stops the flush thread (pending writes are kept)
+    void Shutdown();
+};
+
+// ============================================================================
+// AsyncWriter
+// Bounded write queues executed on a dedicated thread
+// Each priority lane is a FIFO, so writes to the same DataRef in the same lane never
+// reorder. The high lane is always drained first, with SDK priority mode held on for
+// the duration of the batch; a high write supersedes the queued normal writes to its
+// DataRef so that they cannot land after it.
+// Each write gets a token (a sequence number); its result stays queryable until
+// the completion table slot is reused, several max-in-flight generations later.
+// ============================================================================
+
+class AsyncWriter {
+private:
+    struct QueuedWrite {
+        WriteToken token;
+        DataRefWrapper* target;
+        BridgeValue value;
+    };
+
+    struct Lane {
+        std::vector<QueuedWrite> queue; // ring buffer, capacity = max in flight
+        size_t head;
+        size_t count;
+
+        Lane() : head(0), count(0) {}
+    };
+
+    struct Completion {
+        WriteToken token;               // token this slot currently describes
+        bool completed;
+        BridgeResult result;
+        char error[256];
+    };
+
+    SrwLock _lock;                      // guards everything below
+    ConditionVariable _workAvailable;
+    ConditionVariable _writeCompleted;
+
+    ProSimConnectWrapper* _owner;
+    Lane _lanes[2];                     // indexed by WRITE_PRIORITY_*
+    size_t _maxInFlight;
+    size_t _queued;                     // total across lanes
+    std::vector<Completion> _completions;
+    WriteToken _nextToken;
+    DataRefWrapper* _executing;         // target of the write currently running
+    bool _priorityActive;               // writer currently holds SDK priority mode
+    bool _stopping;
+
+    NativeThread _thread;
+
+    static void WriterMain(NativeThread* thread, void* context);
+    void Run();
+    Completion* FindCompletion(WriteToken token);
+    BridgeResult EnsureStarted();
+    void Supersede(DataRefWrapper* target);
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+public:
+    static const int32_t DefaultMaxInFlight = 256;
+
+    explicit AsyncWriter(ProSimConnectWrapper* owner);
+    ~AsyncWriter();
+
+    // Sets the maximum number of queued plus executing writes; only allowed while idle
+    BridgeResult SetMaxInFlight(int32_t maxInFlight);
+
+    // Queues a write in a WRITE_PRIORITY_* lane; returns BRIDGE_ERR_QUEUE_FULL when max
+    // in flight (shared by both lanes) is reached
+    BridgeResult Submit(DataRefWrapper* target, const BridgeValue& value, int32_t priority, WriteToken* outToken);
+
+    // Result of a write: BRIDGE_ERR_INVALID_ARGUMENT if the token is unknown or expired
+    BridgeResult Poll(WriteToken token, bool* outCompleted, BridgeResult* outResult);
+    BridgeResult Wait(WriteToken token, int32_t timeoutMs, BridgeResult* outResult);
+    BridgeResult GetError(WriteToken token, char* buffer, int32_t bufferSize);
+
+    // Cancels queued writes for a DataRef that is being destroyed and waits if one is running
+    void Discard(DataRefWrapper* target);
+
+    // Queued writes and the bytes held by the queues and the completion table
+    size_t PendingCount();
+    size_t MemoryBytes();
+
+    // Stops the writer thread; queued writes complete with BRIDGE_ERR_NOT_CONNECTED
+    void Shutdown();
+};
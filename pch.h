@@ -11,10 +11,12 @@
 // Windows headers
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
+#include <windows.h>
 
 // C++ Standard Library
 #include <cstring>
 #include <string>
+#include <vector>
 
 // Managed/Native interop headers
 #include <vcclr.h>
@@ -1,10 +1,363 @@
+#include <winsock2.h>
 #include "ProSimBridge.h"
+#include "Trigger.h"
 #include <stdio.h>
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <atomic>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#pragma comment(lib, "ws2_32.lib")
+
+// Reference great-circle range (nm) and initial bearing (deg) for the geometry checks
+static void ReferenceGeometry(double lat1, double lon1, double lat2, double lon2,
+                              double* rangeNm, double* bearingDeg) {
+    const double rad = 3.14159265358979323846 / 180.0;
+    double a = pow(sin((lat2 - lat1) * rad / 2), 2) +
+               cos(lat1 * rad) * cos(lat2 * rad) * pow(sin((lon2 - lon1) * rad / 2), 2);
+    *rangeNm = 2.0 * asin(sqrt(a)) * (6371.0088 / 1.852);
+    double y = sin((lon2 - lon1) * rad) * cos(lat2 * rad);
+    double x = cos(lat1 * rad) * sin(lat2 * rad) - sin(lat1 * rad) * cos(lat2 * rad) * cos((lon2 - lon1) * rad);
+    double b = atan2(y, x) / rad;
+    *bearingDeg = b < 0.0 ? b + 360.0 : b;
+}
+
+// Seat task for the pool check: sleeps so serial and parallel execution are easy to tell apart
+static BridgeResult SlowSeatTask(int32_t seat_id, void* instance, void* user_data) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return instance ? BRIDGE_OK : BRIDGE_ERR_NULL_HANDLE;
+}
 
 int main() {
+    // ===== OFFLINE CHECKS (no connection required) =====
+    printf("Checking relative geometry kernel against reference haversine...\n");
+    {
+        const int count = 257;  // odd, so the scalar tail is exercised too
+        double lats[count], lons[count], alts[count], speeds[count], tracks[count];
+        RelativeGeometry geometry[count];
+        unsigned int seed = 12345;
+        for (int i = 0; i < count; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            lats[i] = (seed % 17800) / 100.0 - 89.0;
+            seed = seed * 1103515245u + 12345u;
+            lons[i] = (seed % 36000) / 100.0 - 180.0;
+            alts[i] = (i * 137) % 40000;
+            speeds[i] = (i * 31) % 500;
+            tracks[i] = (i * 7) % 360;
+        }
+        GeoState ownship = { 47.4502, -122.3088, 10000.0, 250.0, 90.0 };
+
+        double maxRangeError = 0.0, maxBearingError = 0.0;
+        if (ProSim_ComputeRelativeGeometry(&ownship, lats, lons, alts, speeds, tracks, count, geometry) == BRIDGE_OK) {
+            for (int i = 0; i < count; ++i) {
+                double range, bearing;
+                ReferenceGeometry(ownship.latitude, ownship.longitude, lats[i], lons[i], &range, &bearing);
+                double bearingError = fabs(geometry[i].bearing_deg - bearing);
+                if (bearingError > 180.0) bearingError = 360.0 - bearingError;
+                if (fabs(geometry[i].range_nm - range) > maxRangeError) maxRangeError = fabs(geometry[i].range_nm - range);
+                if (bearingError > maxBearingError) maxBearingError = bearingError;
+            }
+        }
+        printf("Max range error: %.3g nm, max bearing error: %.3g deg (%s)\n",
+               maxRangeError, maxBearingError,
+               (maxRangeError < 1e-6 && maxBearingError < 1e-6) ? "PASS" : "FAIL");
+
+        // Head-on target 10 nm east flying west at 250 kt: closure is 500 kt
+        double eastLat = ownship.latitude, eastLon = ownship.longitude + 10.0 / (60.0 * cos(ownship.latitude * 3.14159265358979323846 / 180.0));
+        double eastAlt = 11000.0, eastSpeed = 250.0, eastTrack = 270.0;
+        RelativeGeometry headOn;
+        ProSim_ComputeRelativeGeometry(&ownship, &eastLat, &eastLon, &eastAlt, &eastSpeed, &eastTrack, 1, &headOn);
+        printf("Head-on closure: %.1f kt, relative altitude %+.0f ft (%s)\n", headOn.closure_rate_kt,
+               headOn.relative_altitude_ft, fabs(headOn.closure_rate_kt - 500.0) < 1.0 ? "PASS" : "FAIL");
+    }
+
+    printf("Checking trigger hysteresis, delays and edges...\n");
+    {
+        // Radio-altitude callout: on below 50 ft, off above 60 ft, no delays. The dips to
+        // 55 and 58 ft sit inside the band and must not toggle the trigger.
+        TriggerState band(0.0, 0.0);
+        const double altitudes[] = { 100, 55, 45, 55, 58, 65, 55, 45, 49 };
+        std::vector<double> bandEdges;
+        for (int i = 0; i < 9; ++i) {
+            if (band.Update(altitudes[i] < 50.0, altitudes[i] > 60.0, i)) {
+                bandEdges.push_back(i);
+            }
+        }
+        bool bandOk = bandEdges.size() == 3 && bandEdges[0] == 2 && bandEdges[1] == 5 && bandEdges[2] == 7 &&
+                      band.IsActive();
+
+        // 2 s on-delay and 1 s off-delay, with the condition as its own release. The drop at
+        // 1.5 s restarts the on-delay, so the trigger turns on at 4 s rather than 2 s.
+        TriggerState delayed(2.0, 1.0);
+        struct Step { double now; bool condition; } steps[] = {
+            { 0.0, true }, { 1.0, true }, { 1.5, false }, { 2.0, true }, { 3.9, true }, { 4.0, true },
+            { 5.0, false }, { 5.5, true }, { 6.0, false }, { 6.9, false }, { 7.0, false }, { 8.0, false } };
+        std::vector<double> delayEdges;
+        bool holdingOk = true;
+        for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i) {
+            if (delayed.Update(steps[i].condition, !steps[i].condition, steps[i].now)) {
+                delayEdges.push_back(steps[i].now);
+            }
+            // Waiting out a delay at 3.9 s (on) and 6.9 s (off)
+            if ((steps[i].now == 3.9 || steps[i].now == 6.9) && !delayed.IsHolding()) {
+                holdingOk = false;
+            }
+        }
+        bool delayOk = delayEdges.size() == 2 && delayEdges[0] == 4.0 && delayEdges[1] == 7.0 &&
+                       !delayed.IsActive() && !delayed.IsHolding() && holdingOk;
+
+        printf("Hysteresis edges: %d, delayed edges: %d (%s)\n", static_cast<int>(bandEdges.size()),
+               static_cast<int>(delayEdges.size()), (bandOk && delayOk) ? "PASS" : "FAIL");
+    }
+
+    printf("Checking connection pool fan-out...\n");
+    {
+        void* pool = ProSimPool_Create();
+        for (int32_t seat = 1; seat <= 4; ++seat) {
+            ProSimPool_AddSeat(pool, seat, "localhost", NULL);
+        }
+        int32_t seatIds[4];
+        BridgeResult seatResults[4];
+        int32_t seatCount = 0;
+        auto start = std::chrono::steady_clock::now();
+        BridgeResult poolResult = ProSimPool_ForEach(pool, SlowSeatTask, NULL, seatIds, seatResults, 4, &seatCount);
+        long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        // Four 200 ms tasks on four seat threads should take about 200 ms, not 800 ms
+        printf("%d seats in %lld ms (%s)\n", seatCount, elapsedMs,
+               (poolResult == BRIDGE_OK && seatCount == 4 && elapsedMs < 600) ? "PASS" : "FAIL");
+        ProSimPool_Destroy(pool);
+    }
+
+    printf("Checking DataRef handles outliving their connection...\n");
+    {
+        // DataRefs need no simulator to be created unregistered, so this runs offline
+        void* owner = ProSim_Create();
+        DataRefHandle plain = DataRef_Create("Aircraft.Altitude", 100, owner, false);
+        DataRefHandle shared = DataRef_Create("Aircraft.Altitude", 50, owner, false);
+        DataRefHandle derived = DataRef_CreateDerived("Test.Gs", "sqrt(Aircraft.Vx * Aircraft.Vx + Aircraft.Vy * Aircraft.Vy)",
+                                                      100, owner);
+        MemoryStats before = {};
+        ProSim_GetMemoryStats(owner, &before);
+
+        // Connection first: the handles are released with it and DataRef_Destroy only frees them.
+        // Two handles for the altitude, the derived one and its two inputs make five wrappers.
+        ProSim_Destroy(owner);
+        double orphanValue = 0.0;
+        BridgeResult plainRead = plain ? DataRef_GetDouble(plain, &orphanValue) : BRIDGE_ERR_NULL_HANDLE;
+        BridgeResult derivedRead = derived ? DataRef_GetDouble(derived, &orphanValue) : BRIDGE_ERR_NULL_HANDLE;
+        DataRef_Destroy(derived);
+        DataRef_Destroy(shared);
+        DataRef_Destroy(plain);
+        bool refused = plainRead == BRIDGE_ERR_NOT_CONNECTED && derivedRead == BRIDGE_ERR_NOT_CONNECTED;
+        printf("%d DataRef wrappers (expected 5), inputs included, outlived their connection; reads afterwards "
+               "returned %d and %d (%s)\n", before.datarefs, plainRead, derivedRead,
+               (plain && shared && derived && before.datarefs == 5 && refused) ? "PASS" : "FAIL");
+    }
+
+    printf("Checking fan-out server against a simulated source...\n");
+    {
+        void* fanout = ProSimFanout_Create(0);
+        uint16_t port = 0;
+        ProSimFanout_GetPort(fanout, &port);
+
+        // Winsock is already initialized for this process by the server
+        SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+        // Subscribe to Sim.Altitude only, at most 20 updates per second
+        const char name[] = "Sim.Altitude";
+        std::vector<char> request;
+        request.push_back(FANOUT_MSG_SUBSCRIBE);
+        uint16_t payloadLength = static_cast<uint16_t>(4 + 1 + sizeof(name) - 1);
+        request.push_back(static_cast<char>(payloadLength & 0xFF));
+        request.push_back(static_cast<char>(payloadLength >> 8));
+        request.push_back(20); request.push_back(0);    // max_rate_hz
+        request.push_back(1);  request.push_back(0);    // count
+        request.push_back(static_cast<char>(sizeof(name) - 1));
+        request.insert(request.end(), name, name + sizeof(name) - 1);
+        send(client, request.data(), static_cast<int>(request.size()), 0);
+
+        // Simulated source: 500 changes of two refs, 1 ms apart where the timer allows. At the
+        // default 15.6 ms timer resolution this takes several seconds, so the rate check
+        // below uses the measured time.
+        auto publishStart = std::chrono::steady_clock::now();
+        for (int32_t i = 1; i <= 500; ++i) {
+            ProSimFanout_PublishDouble(fanout, "Sim.Altitude", 1000.0 + i);
+            ProSimFanout_PublishInt(fanout, "Sim.Other", i);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        double publishSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - publishStart).count();
+
+        std::vector<unsigned char> stream(1 << 16);
+        size_t received = 0;
+        u_long nonBlocking = 1;
+        ioctlsocket(client, FIONBIO, &nonBlocking);
+        int chunk;
+        while ((chunk = recv(client, reinterpret_cast<char*>(stream.data()) + received,
+                             static_cast<int>(stream.size() - received), 0)) > 0) {
+            received += static_cast<size_t>(chunk);
+        }
+
+        int32_t definitions = 0, deltas = 0, foreign = 0;
+        double lastAltitude = 0.0;
+        for (size_t offset = 0; offset + 3 <= received;) {
+            uint8_t type = stream[offset];
+            size_t length = stream[offset + 1] | (stream[offset + 2] << 8);
+            const unsigned char* payload = &stream[offset + 3];
+            if (type == FANOUT_MSG_DEFINE) {
+                ++definitions;
+            }
+            else if (type == FANOUT_MSG_DELTA) {
+                ++deltas;
+                uint16_t count = static_cast<uint16_t>(payload[0] | (payload[1] << 8));
+                const unsigned char* record = payload + 2;
+                for (uint16_t i = 0; i < count; ++i) {
+                    if (record[2] == DATAREF_TYPE_DOUBLE) {
+                        memcpy(&lastAltitude, record + 3, sizeof(double));
+                        record += 3 + sizeof(double);
+                    }
+                    else {
+                        ++foreign;
+                        break;
+                    }
+                }
+            }
+            offset += 3 + length;
+        }
+        closesocket(client);
+
+        // At most 20 deltas per second of publishing, plus one for the first tick
+        int32_t maxDeltas = static_cast<int32_t>(publishSeconds * 20.0) + 1;
+        FanoutStats stats;
+        ProSimFanout_GetStats(fanout, &stats);
+        printf("%zu bytes, %d definitions, %d deltas (at most %d in %.2f s), last altitude %.0f, %d unsubscribed values (%s)\n",
+               received, definitions, deltas, maxDeltas, publishSeconds, lastAltitude, foreign,
+               (definitions == 1 && deltas >= 5 && deltas <= maxDeltas && lastAltitude == 1500.0 && foreign == 0) ? "PASS" : "FAIL");
+        printf("Server: %d refs, %llu publishes\n", stats.refs, static_cast<unsigned long long>(stats.publishes));
+        ProSimFanout_Destroy(fanout);
+    }
+
+    printf("Checking wire format round trip, fuzzing and throughput...\n");
+    {
+        const uint32_t slots = 1024;
+        const int32_t recordCount = 1000;
+        void* encoder = ProSimWire_CreateEncoder(slots);
+        void* decoder = ProSimWire_CreateDecoder(slots);
+        std::vector<WireRecord> records(recordCount), decoded(recordCount);
+        std::vector<uint8_t> frame(64 * 1024);
+        const char* modes[] = { "OFF", "STANDBY", "TA ONLY", "TA/RA" };
+
+        // One ref per slot: a quarter each of doubles, ints, bools and strings
+        unsigned int seed = 4242;
+        int32_t mismatches = 0;
+        auto sameRecord = [](const WireRecord& a, const WireRecord& b) {
+            return a.slot == b.slot && a.type == b.type &&
+                (a.type != DATAREF_TYPE_DOUBLE || a.double_value == b.double_value) &&
+                (a.type != DATAREF_TYPE_INT || a.int_value == b.int_value) &&
+                (a.type != DATAREF_TYPE_BOOL || a.bool_value == b.bool_value) &&
+                (a.type != DATAREF_TYPE_STRING || (a.string_length == b.string_length &&
+                    memcmp(a.string_value, b.string_value, a.string_length) == 0));
+        };
+        for (int32_t f = 0; f < 200; ++f) {
+            for (int32_t i = 0; i < recordCount; ++i) {
+                WireRecord& r = records[i];
+                seed = seed * 1103515245u + 12345u;
+                r.slot = static_cast<uint32_t>(i);
+                r.type = (i % 4 == 0) ? DATAREF_TYPE_DOUBLE : (i % 4 == 1) ? DATAREF_TYPE_INT
+                       : (i % 4 == 2) ? DATAREF_TYPE_BOOL : DATAREF_TYPE_STRING;
+                r.double_value = (f == 0) ? i * 100.0 : r.double_value + (seed % 5) * 0.125;
+                r.int_value = (seed >> 8) % 2000 - 1000;
+                r.bool_value = (seed >> 4) & 1;
+                r.string_value = modes[(seed >> 12) % 4];
+                r.string_length = static_cast<int32_t>(strlen(r.string_value));
+            }
+            int32_t size = 0, count = 0;
+            ProSimWire_Encode(encoder, records.data(), recordCount, f == 0, frame.data(),
+                              static_cast<int32_t>(frame.size()), &size);
+            if (ProSimWire_Decode(decoder, frame.data(), size, decoded.data(), recordCount, &count, NULL) != BRIDGE_OK ||
+                count != recordCount) {
+                ++mismatches;
+                continue;
+            }
+            for (int32_t i = 0; i < recordCount; ++i) {
+                if (!sameRecord(records[i], decoded[i])) ++mismatches;
+            }
+        }
+        printf("Round trip: %d mismatches (%s)\n", mismatches, mismatches == 0 ? "PASS" : "FAIL");
+
+        // Fuzz: flip bits in and truncate valid frames; the decoder must reject or decode
+        // them without reading out of bounds, and recover at the next keyframe
+        void* fuzzDecoder = ProSimWire_CreateDecoder(slots);
+        int32_t rejected = 0;
+        for (int32_t f = 0; f < 20000; ++f) {
+            int32_t size = 0, count = 0;
+            seed = seed * 1103515245u + 12345u;
+            ProSimWire_Encode(encoder, records.data(), 1 + seed % 64, (seed >> 8) % 4 == 0, frame.data(),
+                              static_cast<int32_t>(frame.size()), &size);
+            for (int32_t flips = 1 + (seed >> 12) % 4; flips > 0; --flips) {
+                seed = seed * 1103515245u + 12345u;
+                frame[(seed >> 8) % size] ^= static_cast<uint8_t>(1u << (seed % 8));
+            }
+            if ((seed >> 16) % 5 == 0) size = 1 + (seed >> 4) % size;
+            if (ProSimWire_Decode(fuzzDecoder, frame.data(), size, decoded.data(), recordCount, &count, NULL) != BRIDGE_OK) {
+                ++rejected;
+            }
+        }
+
+        // After all that damage a clean keyframe must still decode exactly
+        int32_t keySize = 0, keyCount = 0;
+        bool recovered = ProSimWire_Encode(encoder, records.data(), recordCount, true, frame.data(),
+                                           static_cast<int32_t>(frame.size()), &keySize) == BRIDGE_OK &&
+                         ProSimWire_Decode(fuzzDecoder, frame.data(), keySize, decoded.data(), recordCount,
+                                           &keyCount, NULL) == BRIDGE_OK &&
+                         keyCount == recordCount;
+        for (int32_t i = 0; recovered && i < recordCount; ++i) {
+            recovered = sameRecord(records[i], decoded[i]);
+        }
+        printf("Fuzz: %d of 20000 damaged frames rejected, clean keyframe %s afterwards (%s)\n",
+               rejected, recovered ? "decoded exactly" : "NOT recovered", recovered ? "PASS" : "FAIL");
+        ProSimWire_DestroyDecoder(fuzzDecoder);
+
+        // Throughput: doubles and ints changing every frame, as a sim stream does
+        for (int32_t i = 0; i < recordCount; ++i) {
+            records[i].type = (i % 4 == 0) ? DATAREF_TYPE_INT : DATAREF_TYPE_DOUBLE;
+        }
+        const int32_t frames = 5000;
+        long long encodedBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int32_t f = 0; f < frames; ++f) {
+            for (int32_t i = 0; i < recordCount; ++i) {
+                records[i].double_value += 0.25 * ((f + i) % 7);
+                records[i].int_value += (f + i) % 3;
+            }
+            int32_t size = 0, count = 0;
+            ProSimWire_Encode(encoder, records.data(), recordCount, f == 0, frame.data(),
+                              static_cast<int32_t>(frame.size()), &size);
+            ProSimWire_Decode(decoder, frame.data(), size, decoded.data(), recordCount, &count, NULL);
+            encodedBytes += size;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("Throughput: %.1f M records/s encode+decode, %.0f bytes per frame of %d records\n",
+               frames * static_cast<double>(recordCount) / seconds / 1e6,
+               static_cast<double>(encodedBytes) / frames, recordCount);
+        // The goal is over 1 GB/s of native records through encode and decode on one core
+        double recordBytesPerSecond = frames * static_cast<double>(recordCount) * sizeof(WireRecord) / seconds;
+        printf("Throughput: %.2f GB/s of records, goal > 1 GB/s (%s)\n",
+               recordBytesPerSecond / 1e9, recordBytesPerSecond > 1e9 ? "PASS" : "FAIL");
+
+        ProSimWire_DestroyDecoder(decoder);
+        ProSimWire_DestroyEncoder(encoder);
+    }
+
     // Create a ProSim connection instance
     void* prosim = ProSim_Create();
     if (!prosim) {
@@ -126,6 +479,11 @@ int main() {
         DataRefHandle headingRef = DataRef_Create("Aircraft.Heading", 100, prosim, true);
         if (headingRef) {
             printf("Created DataRef: Aircraft.Heading\n");
+
+            int32_t valueType = DATAREF_TYPE_UNKNOWN;
+            if (DataRef_GetValueType(headingRef, &valueType) == BRIDGE_OK) {
+                printf("Heading value type: %d\n", valueType);
+            }
             
             // Get current heading as double
             double hdg = 0.0;
@@ -231,6 +589,16 @@ int main() {
                 printf("Error: %s\n", ProSim_GetLastError());
             }
 
+            // Poll only for changes (no copy while the value is unchanged)
+            uint32_t typeVersion = 0;
+            result = DataRef_GetStringIfChanged(aircraftTypeRef, typeBuffer, sizeof(typeBuffer), &typeVersion);
+            if (result == BRIDGE_OK) {
+                printf("Aircraft type (version %u): %s\n", typeVersion, typeBuffer);
+                uint32_t previous = typeVersion;
+                DataRef_GetStringIfChanged(aircraftTypeRef, typeBuffer, sizeof(typeBuffer), &typeVersion);
+                printf("Unchanged on second poll: %s\n", previous == typeVersion ? "yes" : "no");
+            }
+
             DataRef_Destroy(aircraftTypeRef);
             printf("DataRef destroyed\n");
         } else {
@@ -251,7 +619,24 @@ int main() {
                 printf("Error: %s\n", ProSim_GetLastError());
             }
 
+            // Name ids: the same name always maps to the same id on this connection
+            uint32_t speedId = 0, internedId = 0;
+            const char* internedName = NULL;
+            DataRef_GetNameId(speedRef, &speedId);
+            ProSim_InternName(prosim, "Aircraft.Speed", &internedId);
+            ProSim_GetInternedName(prosim, speedId, &internedName);
+            printf("Name id %u, interned id %u, name by id: %s (%s)\n", speedId, internedId,
+                   internedName ? internedName : "(none)", speedId == internedId ? "PASS" : "FAIL");
+
             DataRef_Destroy(speedRef);
+
+            DataRefHandle speedById = DataRef_CreateById(speedId, 100, prosim, true);
+            if (speedById) {
+                printf("DataRef created by name id\n");
+                DataRef_Destroy(speedById);
+            }
+            uint32_t unusedId = 0xFFFFFFFF;
+            printf("Unknown id rejected: %s\n", DataRef_CreateById(unusedId, 100, prosim, true) ? "NO" : "yes");
         }
 
         // Example 6: Delayed registration
@@ -410,6 +795,68 @@ int main() {
             printf("Speed monitor destroyed\n");
         }
 
+        // Example 4: Callbacks on a worker pool, so a slow callback does not hold up others
+        printf("\n--- Callback Dispatch Example ---\n");
+        CallbackDispatchOptions dispatchOptions = { 2, 0, 0 };
+        result = ProSim_SetCallbackDispatch(prosim, &dispatchOptions);
+        if (result == BRIDGE_OK) {
+            // Both callbacks run on pool threads while main reads the counts
+            std::atomic<int> slowCalls(0), fastCalls(0);
+            DataRefHandle slowRef = DataRef_Create("Aircraft.Altitude", 100, prosim, true);
+            DataRefHandle fastRef = DataRef_Create("Aircraft.Speed", 100, prosim, true);
+            if (slowRef && fastRef) {
+                DataRef_SetOnDataChange(slowRef, [](DataRefHandle handle, void* userData) {
+                    ++*static_cast<std::atomic<int>*>(userData);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                }, &slowCalls);
+                DataRef_SetOnDataChange(fastRef, [](DataRefHandle handle, void* userData) {
+                    ++*static_cast<std::atomic<int>*>(userData);
+                }, &fastCalls);
+
+                DataRef_SetInt(slowRef, 12000);
+                for (int i = 0; i < 5; ++i) {
+                    DataRef_SetDouble(fastRef, 210.0 + i);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+                }
+                printf("Speed callbacks while the altitude callback was busy: %d\n", fastCalls.load());
+            }
+            if (slowRef) DataRef_Destroy(slowRef);    // waits for its running callback
+            if (fastRef) DataRef_Destroy(fastRef);
+            printf("Altitude callbacks: %d\n", slowCalls);
+            ProSim_SetCallbackDispatch(prosim, NULL);
+        }
+        else {
+            printf("Callback dispatch not available: %s\n", ProSim_GetLastError());
+        }
+
+        // Example 5: One callback per update cycle with every changed value inline
+        printf("\n--- Batched Change Callback Example ---\n");
+        struct CycleStats {
+            int cycles;
+            int values;
+        };
+        CycleStats cycleStats = { 0, 0 };
+        DataRefHandle batchAlt = DataRef_Create("Aircraft.Altitude", 100, prosim, true);
+        DataRefHandle batchSpeed = DataRef_Create("Aircraft.Speed", 100, prosim, true);
+        result = ProSim_SetOnDataRefsUpdated(prosim, [](const DataRefHandle* changed, const double* values,
+                                                        int32_t count, void* userData) {
+            CycleStats* stats = static_cast<CycleStats*>(userData);
+            ++stats->cycles;
+            stats->values += count;
+            for (int32_t i = 0; i < count; ++i) {
+                printf("*** CYCLE %d: DataRef %p = %.2f ***\n", stats->cycles, changed[i], values[i]);
+            }
+        }, &cycleStats);
+        if (result == BRIDGE_OK && batchAlt && batchSpeed) {
+            DataRef_SetInt(batchAlt, 11000);
+            DataRef_SetDouble(batchSpeed, 220.0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            printf("Update cycles: %d, values delivered: %d\n", cycleStats.cycles, cycleStats.values);
+        }
+        ProSim_SetOnDataRefsUpdated(prosim, NULL, NULL);
+        if (batchAlt) DataRef_Destroy(batchAlt);
+        if (batchSpeed) DataRef_Destroy(batchSpeed);
+
         printf("\n========================================\n");
         printf("Callback System Examples Complete\n");
         printf("========================================\n");
@@ -526,11 +973,7 @@ int main() {
 
         // Example 4: Combined Advanced Features
         printf("\n--- Combined Advanced Features Example ---\n");
-        printf("Demonstrating priority mode with aircraft state changes...\n");
-        
-        // Enable priority mode for critical updates
-        ProSim_SetPriorityMode(prosim, true);
-        printf("Priority mode enabled for critical updates\n");
+        printf("Demonstrating high-priority writes with aircraft state changes...\n");
 
         // Create multiple DataRefs for coordinated updates
         DataRefHandle altRef = DataRef_Create("Aircraft.Altitude", 50, prosim, true);
@@ -539,20 +982,445 @@ int main() {
         if (altRef && spdRef) {
             printf("\nPerforming coordinated altitude and speed changes...\n");
             
-            // Set cruise altitude and speed
-            DataRef_SetInt(altRef, 35000);
-            DataRef_SetDouble(spdRef, 450.0);
+            // High-priority writes run ahead of queued routine writes; the bridge enables
+            // SDK priority mode only while they are being sent
+            WriteToken altToken = WRITE_TOKEN_INVALID;
+            WriteToken spdToken = WRITE_TOKEN_INVALID;
+            DataRef_SetIntAsync(altRef, 35000, WRITE_PRIORITY_HIGH, &altToken);
+            DataRef_SetDoubleAsync(spdRef, 450.0, WRITE_PRIORITY_HIGH, &spdToken);
+            ProSim_WaitWrite(prosim, altToken, 1000, NULL);
+            ProSim_WaitWrite(prosim, spdToken, 1000, NULL);
             
             printf("Set cruise parameters: 35,000 ft at 450 knots\n");
-            printf("Priority mode ensures these updates take precedence\n");
+            printf("High priority ensures these updates take precedence\n");
 
             DataRef_Destroy(altRef);
             DataRef_Destroy(spdRef);
         }
 
-        // Disable priority mode when done
-        ProSim_SetPriorityMode(prosim, false);
-        printf("Priority mode disabled\n");
+        // Example 5: Write buffering
+        printf("\n--- Write Buffering Example ---\n");
+        DataRefHandle bufferedHdg = DataRef_Create("Aircraft.Heading", 100, prosim, true);
+        if (bufferedHdg) {
+            result = ProSim_SetWriteBuffering(prosim, true, 20);
+            if (result == BRIDGE_OK) {
+                printf("Write buffering enabled (20 ms flush)\n");
+
+                // Simulate a fast encoder: only the last value per tick reaches the SDK
+                for (int i = 0; i <= 100; ++i) {
+                    DataRef_SetDouble(bufferedHdg, 90.0 + i * 0.5);
+                }
+                result = ProSim_Flush(prosim);
+                printf("Flush result: %d\n", result);
+
+                double hdg = 0.0;
+                if (DataRef_GetDouble(bufferedHdg, &hdg) == BRIDGE_OK) {
+                    printf("Heading after flush: %.2f degrees (expected 140.00)\n", hdg);
+                }
+
+                ProSim_SetWriteBuffering(prosim, false, 0);
+                printf("Write buffering disabled\n");
+            } else {
+                printf("Failed to enable write buffering (error code: %d)\n", result);
+                printf("Error: %s\n", ProSim_GetLastError());
+            }
+
+            DataRef_Destroy(bufferedHdg);
+        }
+
+        // Example 6: Asynchronous writes
+        printf("\n--- Asynchronous Write Example ---\n");
+        DataRefHandle asyncAlt = DataRef_Create("Aircraft.Altitude", 100, prosim, true);
+        if (asyncAlt) {
+            WriteToken tokens[3];
+            int submitted = 0;
+            for (int i = 0; i < 3; ++i) {
+                result = DataRef_SetDoubleAsync(asyncAlt, 10000.0 + i * 500.0, WRITE_PRIORITY_NORMAL, &tokens[i]);
+                if (result != BRIDGE_OK) {
+                    printf("Failed to queue write %d (error code: %d)\n", i, result);
+                    break;
+                }
+                ++submitted;
+            }
+            printf("Queued %d writes\n", submitted);
+
+            for (int i = 0; i < submitted; ++i) {
+                BridgeResult writeResult = BRIDGE_OK;
+                result = ProSim_WaitWrite(prosim, tokens[i], 1000, &writeResult);
+                if (result == BRIDGE_OK) {
+                    printf("Write %d completed with %d\n", i, writeResult);
+                    if (writeResult != BRIDGE_OK) {
+                        char message[256];
+                        ProSim_GetWriteError(prosim, tokens[i], message, sizeof(message));
+                        printf("Error: %s\n", message);
+                    }
+                } else {
+                    printf("Wait for write %d failed (error code: %d)\n", i, result);
+                }
+            }
+
+            double alt = 0.0;
+            if (DataRef_GetDouble(asyncAlt, &alt) == BRIDGE_OK) {
+                printf("Altitude after async writes: %.0f ft (expected 11000)\n", alt);
+            }
+
+            // A high-priority write supersedes the normal writes still queued for the same
+            // DataRef, so its value wins even though it was submitted last; each normal write
+            // either ran before it or completes as superseded without being sent
+            WriteToken normalTokens[2];
+            WriteToken highToken = 0;
+            bool queuedAll = DataRef_SetDoubleAsync(asyncAlt, 12000.0, WRITE_PRIORITY_NORMAL, &normalTokens[0]) == BRIDGE_OK &&
+                             DataRef_SetDoubleAsync(asyncAlt, 12500.0, WRITE_PRIORITY_NORMAL, &normalTokens[1]) == BRIDGE_OK &&
+                             DataRef_SetDoubleAsync(asyncAlt, 9000.0, WRITE_PRIORITY_HIGH, &highToken) == BRIDGE_OK;
+            if (queuedAll) {
+                bool ordered = true;
+                int superseded = 0;
+                for (int i = 0; i < 2; ++i) {
+                    BridgeResult writeResult = BRIDGE_OK;
+                    if (ProSim_WaitWrite(prosim, normalTokens[i], 1000, &writeResult) != BRIDGE_OK ||
+                        (writeResult != BRIDGE_OK && writeResult != BRIDGE_ERR_SUPERSEDED)) {
+                        ordered = false;
+                    }
+                    superseded += (writeResult == BRIDGE_ERR_SUPERSEDED) ? 1 : 0;
+                }
+                BridgeResult highResult = BRIDGE_OK;
+                if (ProSim_WaitWrite(prosim, highToken, 1000, &highResult) != BRIDGE_OK || highResult != BRIDGE_OK) {
+                    ordered = false;
+                }
+                alt = 0.0;
+                ordered = ordered && DataRef_GetDouble(asyncAlt, &alt) == BRIDGE_OK && alt == 9000.0;
+                printf("High-priority write wins: %.0f ft, %d normal write(s) superseded (%s)\n",
+                       alt, superseded, ordered ? "PASS" : "FAIL");
+            } else {
+                printf("Failed to queue the priority writes: %s\n", ProSim_GetLastError());
+            }
+
+            DataRef_Destroy(asyncAlt);
+        }
+
+        // Example 7: Sample history
+        printf("\n--- Sample History Example ---\n");
+        DataRefHandle pitchRef = DataRef_Create("Aircraft.Pitch", 50, prosim, true);
+        if (pitchRef) {
+            // One second of 50 ms updates, extrapolating at most 100 ms past the newest sample
+            result = DataRef_EnableHistory(pitchRef, 20, 0.1);
+            if (result == BRIDGE_OK) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+                // Sample at a 144 Hz frame cadence over the last 50 ms
+                double now = 0.0;
+                ProSim_GetTime(&now);
+                for (int frame = 0; frame < 8; ++frame) {
+                    double t = now - 0.05 + frame / 144.0;
+                    double pitch = 0.0;
+                    if (DataRef_SampleAt(pitchRef, t, SAMPLE_MODE_EXTRAPOLATE, &pitch) == BRIDGE_OK) {
+                        printf("Pitch at t%+.3fs: %.3f degrees\n", t - now, pitch);
+                    }
+                }
+            } else {
+                printf("Failed to enable history (error code: %d)\n", result);
+                printf("Error: %s\n", ProSim_GetLastError());
+            }
+
+            DataRef_Destroy(pitchRef);
+        }
+
+        // Example 8: AI traffic
+        printf("\n--- AI Traffic Example ---\n");
+        int32_t trafficCount = 0;
+        if (ProSim_GetTrafficCount(prosim, &trafficCount) == BRIDGE_OK) {
+            printf("AI traffic targets: %d\n", trafficCount);
+        }
+
+        DataRefHandle latRef = DataRef_Create("Aircraft.Latitude", 100, prosim, true);
+        DataRefHandle lonRef = DataRef_Create("Aircraft.Longitude", 100, prosim, true);
+        if (latRef && lonRef) {
+            double ownLat = 0.0, ownLon = 0.0;
+            DataRef_GetDouble(latRef, &ownLat);
+            DataRef_GetDouble(lonRef, &ownLon);
+
+            TrafficTarget nearby[16];
+            int32_t total = 0;
+            result = ProSim_GetTrafficNear(prosim, ownLat, ownLon, 0.0, 40.0, 100000.0, nearby, 16, &total);
+            if (result == BRIDGE_OK) {
+                printf("Targets within 40 nm: %d\n", total);
+                for (int32_t i = 0; i < total && i < 16; ++i) {
+                    printf("  #%u: %.1f nm, %.0f ft, %.0f kt\n", nearby[i].object_id,
+                           nearby[i].distance_nm, nearby[i].altitude, nearby[i].ground_speed);
+                }
+            }
+        }
+        if (latRef) DataRef_Destroy(latRef);
+        if (lonRef) DataRef_Destroy(lonRef);
+
+        // Example 9: Failure catalog
+        printf("\n--- Failure Catalog Example ---\n");
+        result = ProSim_LoadFailureCatalog(prosim);
+        if (result == BRIDGE_OK) {
+            int32_t failureCount = 0, stringSize = 0;
+            uint32_t catalogVersion = 0;
+            ProSim_GetFailureCatalog(prosim, NULL, 0, NULL, 0, &failureCount, &stringSize, &catalogVersion);
+
+            std::vector<FailureRecord> failures(failureCount);
+            std::vector<char> failureStrings(stringSize);
+            result = ProSim_GetFailureCatalog(prosim, failures.data(), failureCount,
+                                              failureStrings.data(), stringSize,
+                                              &failureCount, &stringSize, &catalogVersion);
+            if (result == BRIDGE_OK) {
+                printf("Failures: %d (%d bytes of strings, version %u)\n", failureCount, stringSize, catalogVersion);
+                for (int32_t i = 0; i < failureCount && i < 5; ++i) {
+                    printf("  %s: %s\n", failureStrings.data() + failures[i].id_offset,
+                           failureStrings.data() + failures[i].name_offset);
+                }
+
+                FailureStateUpdate updates[32];
+                int32_t changed = 0;
+                if (ProSim_GetFailureUpdates(prosim, catalogVersion, updates, 32, &changed, &catalogVersion) == BRIDGE_OK) {
+                    printf("Armed-state changes since load: %d\n", changed);
+                }
+            }
+        }
+        else {
+            printf("Failure catalog not available: %s\n", ProSim_GetLastError());
+        }
+
+        // Example 10: Failure scenario (a bad id must arm nothing)
+        printf("\n--- Failure Scenario Example ---\n");
+        FailureScenarioResult scenarioResult;
+        result = ProSim_ArmFailureScenario(prosim,
+                                           "# validation only\n"
+                                           "arm NO_SUCH_FAILURE above 10000\n",
+                                           &scenarioResult);
+        printf("Unknown id rejected: %s (%s), armed %d\n",
+               result == BRIDGE_ERR_INVALID_ARGUMENT ? "yes" : "NO",
+               ProSim_GetLastError(), scenarioResult.armed_failures);
+
+        result = ProSim_ArmFailureScenario(prosim, "arm ENG1_FIRE above 10000 oops\n", &scenarioResult);
+        printf("Syntax error rejected: %s (%s)\n",
+               result == BRIDGE_ERR_INVALID_ARGUMENT ? "yes" : "NO", ProSim_GetLastError());
+
+        // Example 11: Memory accounting and limits
+        printf("\n--- Memory Accounting Example ---\n");
+        MemoryStats memory;
+        if (ProSim_GetMemoryStats(prosim, &memory) == BRIDGE_OK) {
+            printf("Native: wrappers %llu, names %llu, caches %llu, queues %llu, history %llu bytes\n",
+                   (unsigned long long)memory.wrapper_bytes, (unsigned long long)memory.name_bytes,
+                   (unsigned long long)memory.cache_bytes, (unsigned long long)memory.queue_bytes,
+                   (unsigned long long)memory.history_bytes);
+            printf("DataRefs %d, names %d, pending writes %d\n", memory.datarefs, memory.names, memory.pending_writes);
+            printf("Managed heap %llu bytes, collections %d/%d/%d\n",
+                   (unsigned long long)memory.managed_heap_bytes,
+                   memory.gen0_collections, memory.gen1_collections, memory.gen2_collections);
+
+            // Cap DataRefs at the current count; the next creation must fail
+            MemoryLimits limits = {};
+            limits.max_datarefs = memory.datarefs;
+            limits.max_history_bytes = 1024;
+            ProSim_SetMemoryLimits(prosim, &limits);
+            DataRefHandle overLimit = DataRef_Create("aircraft.altitude", 100, prosim, true);
+            printf("DataRef cap enforced: %s (%s)\n", overLimit ? "NO" : "yes", ProSim_GetLastError());
+            if (overLimit) DataRef_Destroy(overLimit);
+
+            limits.max_datarefs = 0;
+            ProSim_SetMemoryLimits(prosim, &limits);
+            DataRefHandle historyRef = DataRef_Create("aircraft.altitude", 100, prosim, true);
+            if (historyRef) {
+                result = DataRef_EnableHistory(historyRef, 1000, 0.0);  // 16000 bytes
+                printf("History cap enforced: %s (%s)\n",
+                       result == BRIDGE_ERR_LIMIT_EXCEEDED ? "yes" : "NO", ProSim_GetLastError());
+                DataRef_Destroy(historyRef);
+            }
+            ProSim_SetMemoryLimits(prosim, NULL);
+        }
+
+        // Example 12: Derived DataRefs
+        printf("\n--- Derived DataRef Example ---\n");
+        DataRefHandle totalFuel = DataRef_CreateDerived("derived.total_fuel",
+            "fuel.left + fuel.center + fuel.right", 100, prosim);
+        DataRefHandle lowFuel = DataRef_CreateDerived("derived.low_fuel",
+            "derived.total_fuel < 2000 ? 1 : 0", 100, prosim);
+        if (totalFuel && lowFuel) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            double total = 0.0, low = 0.0;
+            result = DataRef_GetDouble(totalFuel, &total);
+            if (result == BRIDGE_OK && DataRef_GetDouble(lowFuel, &low) == BRIDGE_OK) {
+                printf("Total fuel: %.1f, low fuel: %s\n", total, low != 0.0 ? "yes" : "no");
+            } else {
+                printf("Derived value not ready yet (error code: %d)\n", result);
+            }
+
+            result = DataRef_SetDouble(totalFuel, 1.0);
+            printf("Write rejected: %s\n", result == BRIDGE_ERR_INVALID_ARGUMENT ? "yes" : "NO");
+        } else {
+            printf("Failed to create derived DataRefs: %s\n", ProSim_GetLastError());
+        }
+        if (lowFuel) DataRef_Destroy(lowFuel);
+        if (totalFuel) DataRef_Destroy(totalFuel);
+
+        DataRefHandle badExpression = DataRef_CreateDerived("derived.bad", "fuel.left * (2 + ", 100, prosim);
+        printf("Bad expression rejected: %s (%s)\n", badExpression ? "NO" : "yes", ProSim_GetLastError());
+        if (badExpression) DataRef_Destroy(badExpression);
+
+        // Example 13: Trigger with hysteresis and an on-delay
+        printf("\n--- Trigger Example ---\n");
+        int transitions = 0;
+        TriggerOptions triggerOptions = {};
+        triggerOptions.condition = "aircraft.altitude < 1000";
+        triggerOptions.release = "aircraft.altitude > 1200";
+        triggerOptions.on_delay_ms = 200;
+        triggerOptions.interval = 100;
+        TriggerHandle lowAltitude = Trigger_Create(&triggerOptions, [](TriggerHandle trigger, bool active, void* userData) {
+            ++*static_cast<int*>(userData);
+            printf("*** TRIGGER: low altitude %s ***\n", active ? "ON" : "off");
+        }, &transitions, prosim);
+        if (lowAltitude) {
+            DataRefHandle triggerAlt = DataRef_Create("aircraft.altitude", 100, prosim, true);
+            if (triggerAlt) {
+                DataRef_SetInt(triggerAlt, 900);
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                DataRef_SetInt(triggerAlt, 1100);      // inside the hysteresis band: stays on
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                bool active = false;
+                Trigger_IsActive(lowAltitude, &active);
+                printf("Still active at 1100 ft: %s\n", active ? "yes" : "no");
+                DataRef_SetInt(triggerAlt, 1300);
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                DataRef_Destroy(triggerAlt);
+            }
+            printf("Transitions: %d\n", transitions);
+            Trigger_Destroy(lowAltitude);
+        } else {
+            printf("Failed to create trigger: %s\n", ProSim_GetLastError());
+        }
+
+        // Example 14: Lazy registration with idle unregistration
+        printf("\n--- Lazy Registration Example ---\n");
+        result = ProSim_SetLazyRegistration(prosim, true, 300);
+        if (result == BRIDGE_OK) {
+            DataRefHandle lazyRef = DataRef_Create("aircraft.flaps", 100, prosim, true);
+            if (lazyRef) {
+                double flaps = 0.0;
+                printf("Created without registering; first read registers it\n");
+                result = DataRef_GetDouble(lazyRef, &flaps);
+                printf("First read: %s\n", result == BRIDGE_OK ? "value" : "not ready yet");
+                std::this_thread::sleep_for(std::chrono::milliseconds(600));
+                printf("Idle for 600 ms: unregistered\n");
+                result = DataRef_GetDouble(lazyRef, &flaps);
+                printf("Read after idle re-registers (result %d)\n", result);
+                DataRef_Destroy(lazyRef);
+            }
+            ProSim_SetLazyRegistration(prosim, false, 0);
+        } else {
+            printf("Failed to enable lazy registration: %s\n", ProSim_GetLastError());
+        }
+
+        // Example 15: Adaptive polling intervals
+        printf("\n--- Adaptive Interval Example ---\n");
+        AdaptiveIntervalOptions adaptive = {};
+        adaptive.min_interval_ms = 50;
+        adaptive.max_interval_ms = 800;
+        adaptive.window_ms = 500;
+        result = ProSim_SetAdaptiveIntervals(prosim, &adaptive);
+        if (result == BRIDGE_OK) {
+            DataRefHandle cabinTemp = DataRef_Create("aircraft.cabin.temperature", 10, prosim, true);
+            if (cabinTemp) {
+                int32_t interval = 0;
+                DataRef_GetInterval(cabinTemp, &interval);
+                printf("Starting interval (10 ms clamped to the bounds): %d ms\n", interval);
+
+                // Never read: the interval should step towards the maximum
+                std::this_thread::sleep_for(std::chrono::milliseconds(1600));
+                DataRef_GetInterval(cabinTemp, &interval);
+                printf("Interval after 1.6 s unread: %d ms\n", interval);
+                DataRef_Destroy(cabinTemp);
+            }
+            ProSim_SetAdaptiveIntervals(prosim, NULL);
+        } else {
+            printf("Failed to enable adaptive intervals: %s\n", ProSim_GetLastError());
+        }
+
+        // Example 16: Handles for the same name share one SDK DataRef
+        printf("\n--- Shared DataRef Example ---\n");
+        DataRefHandle altitudePfd = DataRef_Create("aircraft.altitude", 250, prosim, true);
+        DataRefHandle altitudeGpws = DataRef_Create("aircraft.altitude", 50, prosim, true);
+        if (altitudePfd && altitudeGpws) {
+            int32_t interval = 0;
+            DataRef_GetInterval(altitudePfd, &interval);
+            printf("Shared interval with both handles: %d ms\n", interval);
+
+            // The faster consumer goes away; the remaining handle keeps working at its own rate
+            DataRef_Destroy(altitudeGpws);
+            altitudeGpws = NULL;
+            DataRef_GetInterval(altitudePfd, &interval);
+            printf("Shared interval after destroying the 50 ms handle: %d ms\n", interval);
+
+            double altitude = 0.0;
+            if (DataRef_GetDouble(altitudePfd, &altitude) == BRIDGE_OK) {
+                printf("Altitude: %.0f ft\n", altitude);
+            }
+        }
+        if (altitudeGpws) DataRef_Destroy(altitudeGpws);
+        if (altitudePfd) DataRef_Destroy(altitudePfd);
+
+        // Example 17: Snapshot and restore for a training reset
+        printf("\n--- Snapshot Example ---\n");
+        SnapshotHandle initial = ProSim_CaptureSnapshot(prosim);
+        if (initial) {
+            int32_t count = 0;
+            Snapshot_GetCount(initial, &count);
+            printf("Captured %d writable DataRefs\n", count);
+
+            result = Snapshot_Save(initial, "test_snapshot.psnap");
+            Snapshot_Destroy(initial);
+
+            SnapshotHandle reset = (result == BRIDGE_OK) ? Snapshot_Load("test_snapshot.psnap") : NULL;
+            if (reset) {
+                // Nothing has moved since the capture, so nearly everything should be skipped
+                SnapshotRestoreResult restored;
+                result = ProSim_RestoreSnapshot(prosim, reset, &restored);
+                printf("Restore: %d written, %d unchanged, %d failed (read %.1f ms, write %.1f ms)\n",
+                       restored.written, restored.unchanged, restored.failed,
+                       restored.read_ms, restored.write_ms);
+                if (result != BRIDGE_OK) {
+                    printf("Last restore error: %s\n", ProSim_GetLastError());
+                }
+                Snapshot_Destroy(reset);
+            } else {
+                printf("Failed to save or load snapshot: %s\n", ProSim_GetLastError());
+            }
+            remove("test_snapshot.psnap");
+        } else {
+            printf("Failed to capture snapshot: %s\n", ProSim_GetLastError());
+        }
+
+        // Example 18: Diff two checkpoints
+        printf("\n--- Snapshot Diff Example ---\n");
+        SnapshotHandle checkpointA = ProSim_CaptureSnapshot(prosim);
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        SnapshotHandle checkpointB = ProSim_CaptureSnapshot(prosim);
+        if (checkpointA && checkpointB) {
+            SnapshotDiffOptions tolerance = { 0.001, 0 };
+            SnapshotDiffHandle diff = Snapshot_Diff(checkpointA, checkpointB, &tolerance);
+            int32_t count = 0;
+            if (diff && SnapshotDiff_GetCount(diff, &count) == BRIDGE_OK) {
+                printf("%d DataRefs changed in 2 seconds\n", count);
+                for (int32_t i = 0; i < count && i < 10; ++i) {
+                    SnapshotDiffEntry entry;
+                    SnapshotDiff_GetEntry(diff, i, &entry);
+                    if (entry.after_string) {
+                        printf("  %s: \"%s\" -> \"%s\"\n", entry.name,
+                               entry.before_string ? entry.before_string : "", entry.after_string);
+                    } else {
+                        printf("  %s: %g -> %g\n", entry.name, entry.before_value, entry.after_value);
+                    }
+                }
+            } else {
+                printf("Failed to diff snapshots: %s\n", ProSim_GetLastError());
+            }
+            SnapshotDiff_Destroy(diff);
+        }
+        Snapshot_Destroy(checkpointA);
+        Snapshot_Destroy(checkpointB);
 
         printf("\n========================================\n");
         printf("Advanced Features Examples Complete\n");